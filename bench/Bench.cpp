@@ -0,0 +1,253 @@
+#include "jutta_proto/DiscCipher.hpp"
+#include "jutta_proto/JuttaCodec.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/LineFramer.hpp"
+#include "jutta_proto/StreamDecoder.hpp"
+#include "jutta_proto/WireCapture.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//---------------------------------------------------------------------------
+// Allocation counting:
+//---------------------------------------------------------------------------
+namespace {
+std::atomic<size_t> allocCount{0};
+}  // namespace
+
+// NOLINTNEXTLINE (cppcoreguidelines-no-malloc, hicpp-no-malloc)
+void* operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    // NOLINTNEXTLINE (cppcoreguidelines-no-malloc, hicpp-no-malloc)
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+// NOLINTNEXTLINE (cppcoreguidelines-no-malloc, hicpp-no-malloc)
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+// NOLINTNEXTLINE (cppcoreguidelines-no-malloc, hicpp-no-malloc)
+void operator delete(void* ptr, size_t /*size*/) noexcept { std::free(ptr); }
+
+//---------------------------------------------------------------------------
+namespace {
+//---------------------------------------------------------------------------
+struct BenchResult {
+    std::string name;
+    size_t iterations{0};
+    size_t bytesPerOp{0};
+    double nsPerOp{0};
+    double nsPerByte{0};
+    double allocsPerOp{0};
+};
+
+/**
+ * Prevents the compiler from optimizing away the given value.
+ **/
+template <typename T>
+inline void do_not_optimize(T const& value) {
+    // NOLINTNEXTLINE (hicpp-no-assembler)
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Runs the given operation until at least MIN_DURATION passed and returns the average cost per operation.
+ * bytesPerOp is the number of (decoded) bytes one operation processes and is used for calculating ns/byte.
+ **/
+BenchResult run(const std::string& name, size_t bytesPerOp, const std::function<void()>& op) {
+    constexpr std::chrono::milliseconds MIN_DURATION{250};
+
+    // Warm up caches and lazily initialized tables:
+    for (size_t i = 0; i < 16; i++) {
+        op();
+    }
+
+    size_t iterations = 1;
+    while (true) {
+        size_t allocsStart = allocCount.load(std::memory_order_relaxed);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            op();
+        }
+        std::chrono::nanoseconds duration = std::chrono::steady_clock::now() - start;
+        size_t allocs = allocCount.load(std::memory_order_relaxed) - allocsStart;
+        if (duration >= MIN_DURATION) {
+            BenchResult result;
+            result.name = name;
+            result.iterations = iterations;
+            result.bytesPerOp = bytesPerOp;
+            result.nsPerOp = static_cast<double>(duration.count()) / static_cast<double>(iterations);
+            result.nsPerByte = bytesPerOp > 0 ? result.nsPerOp / static_cast<double>(bytesPerOp) : 0;
+            result.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(iterations);
+            std::cerr << name << ": " << result.nsPerOp << " ns/op, " << result.nsPerByte << " ns/byte, " << result.allocsPerOp << " allocs/op\n";
+            return result;
+        }
+        iterations *= 2;
+    }
+}
+
+std::string to_json(const std::vector<BenchResult>& results) {
+    std::ostringstream sstream;
+    sstream << "{\n";
+    sstream << "  \"context\": {\"simd_decoder\": " << (jutta_proto::has_simd_decoder() ? "true" : "false") << "},\n";
+    sstream << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        sstream << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations << ", \"bytes_per_op\": " << r.bytesPerOp;
+        sstream << ", \"ns_per_op\": " << r.nsPerOp << ", \"ns_per_byte\": " << r.nsPerByte << ", \"allocs_per_op\": " << r.allocsPerOp << "}";
+        sstream << ((i + 1 < results.size()) ? ",\n" : "\n");
+    }
+    sstream << "  ]\n}\n";
+    return sstream.str();
+}
+
+std::vector<uint8_t> make_payload(size_t size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = static_cast<uint8_t>((i * 131) + 7);
+    }
+    return data;
+}
+
+/**
+ * A typical debug mode stream ("FN:89") with the expected response at the very end.
+ **/
+std::vector<uint8_t> make_debug_stream() {
+    std::string s;
+    while (s.size() < 1024) {
+        s += "ku:0A2B3C4D5E6F708192A3B4C5D6E7F8\r\nKu:0102030405060708\r\n";
+    }
+    s += "ok:\r\n";
+    return {s.begin(), s.end()};
+}
+
+// Keep alive frame from protocol_snoops/snoop_keep_alive.txt:
+constexpr std::array<uint8_t, 22> KEEP_ALIVE_FRAME = {0x26, 0x52, 0x9E, 0x4B, 0xB8, 0x15, 0x8A, 0x5E, 0x8F, 0xC1, 0xCA, 0x72, 0xAB, 0xD2, 0xD8, 0x9B, 0xCC, 0x1D, 0x43, 0xBD, 0x0D, 0x0A};
+//---------------------------------------------------------------------------
+}  // namespace
+//---------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    using namespace jutta_proto;
+    std::vector<BenchResult> results;
+
+    // Codec:
+    const std::vector<uint8_t> data = make_payload(1024);
+    std::vector<uint8_t> wire(data.size() * WIRE_QUAD_SIZE);
+    encode_block(data, wire);
+    std::vector<uint8_t> decoded(data.size());
+
+    results.push_back(run("encode_table", data.size(), [&] {
+        for (size_t i = 0; i < data.size(); i++) {
+            do_not_optimize(encode_table(data[i]));
+        }
+    }));
+    results.push_back(run("encode_block", data.size(), [&] {
+        do_not_optimize(encode_block(data, wire));
+    }));
+    results.push_back(run("decode_table", data.size(), [&] {
+        for (size_t i = 0; i < wire.size(); i += WIRE_QUAD_SIZE) {
+            do_not_optimize(decode_table(&wire[i]));
+        }
+    }));
+    results.push_back(run("decode_block_table", data.size(), [&] {
+        do_not_optimize(decode_block_table(wire, decoded));
+    }));
+    results.push_back(run("decode_block_simd", data.size(), [&] {
+        do_not_optimize(decode_block_simd(wire, decoded));
+    }));
+
+    // Stream decoder fed with 4 byte chunks like they arrive from the UART:
+    StreamDecoder decoder;
+    decoded.reserve(data.size());
+    results.push_back(run("stream_decoder_feed", data.size(), [&] {
+        decoded.clear();
+        for (size_t i = 0; i < wire.size(); i += WIRE_QUAD_SIZE) {
+            decoder.feed(std::span<const uint8_t>(wire).subspan(i, WIRE_QUAD_SIZE), decoded);
+        }
+        do_not_optimize(decoded.data());
+    }));
+    // Stream decoder fed with 64 byte reads (a typical response), without and with the wire capture recording every read:
+    constexpr size_t READ_SIZE = 64;
+    results.push_back(run("stream_decoder_feed_reads", data.size(), [&] {
+        decoded.clear();
+        for (size_t i = 0; i < wire.size(); i += READ_SIZE) {
+            decoder.feed(std::span<const uint8_t>(wire).subspan(i, READ_SIZE), decoded);
+        }
+        do_not_optimize(decoded.data());
+    }));
+    WireCapture capture;
+    results.push_back(run("stream_decoder_feed_reads_captured", data.size(), [&] {
+        decoded.clear();
+        for (size_t i = 0; i < wire.size(); i += READ_SIZE) {
+            std::span<const uint8_t> read = std::span<const uint8_t>(wire).subspan(i, READ_SIZE);
+            const size_t appended = decoder.feed(read, decoded);
+            const uint64_t timestamp = WireCapture::now();
+            capture.record(capture_direction_t::RX, capture_layer_t::WIRE, read, timestamp);
+            capture.record(capture_direction_t::RX, capture_layer_t::DECODED, std::span<const uint8_t>(decoded).last(appended), timestamp);
+        }
+        do_not_optimize(decoded.data());
+        do_not_optimize(capture.drain([](const CaptureRecord& /*rec*/) {}));
+    }));
+
+    // Strings and framing:
+    const std::vector<uint8_t> line = make_payload(64);
+    results.push_back(run("vec_to_string", line.size(), [&] {
+        do_not_optimize(JuttaConnection::vec_to_string(line));
+    }));
+    const std::vector<uint8_t> debugStream = make_debug_stream();
+    // Debug stream split into frames, appended in 64 byte reads like from the stream decoder:
+    LineFramer framer;
+    results.push_back(run("line_framer_debug_stream", debugStream.size(), [&] {
+        size_t frames = 0;
+        for (size_t i = 0; i < debugStream.size(); i += READ_SIZE) {
+            const std::span<const uint8_t> read = std::span<const uint8_t>(debugStream).subspan(i, std::min(READ_SIZE, debugStream.size() - i));
+            std::vector<uint8_t>& input = framer.input();
+            input.insert(input.end(), read.begin(), read.end());
+            for (std::optional<std::string_view> frame = framer.next(); frame; frame = framer.next()) {
+                frames++;
+            }
+        }
+        do_not_optimize(frames);
+    }));
+
+    // '&' frame cipher:
+    std::array<uint8_t, KEEP_ALIVE_FRAME.size()> frame{};
+    results.push_back(run("disc_cipher_decrypt_frame", KEEP_ALIVE_FRAME.size(), [&] {
+        frame = KEEP_ALIVE_FRAME;
+        do_not_optimize(DiscCipher::decrypt_frame(frame));
+    }));
+    frame = KEEP_ALIVE_FRAME;
+    const size_t plainLen = DiscCipher::decrypt_frame(frame);
+    const std::array<uint8_t, KEEP_ALIVE_FRAME.size()> plain = frame;
+    std::array<uint8_t, (2 * KEEP_ALIVE_FRAME.size()) + 5> encrypted{};
+    results.push_back(run("disc_cipher_encrypt_frame", plainLen, [&] {
+        do_not_optimize(DiscCipher::encrypt_frame(0x52, std::span<const uint8_t>(plain).first(plainLen), encrypted));
+    }));
+
+    const std::string json = to_json(results);
+    if (argc > 1) {
+        std::ofstream file(argv[1]);
+        file << json;
+    } else {
+        std::cout << json;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "EventLoop.hpp"
+#include "serial/LinkProfile.hpp"
+#include "serial/SerialConnection.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Non blocking counterpart of the JuttaConnection.
+ * All methods queue the command and return right away, either with a std::future or by taking a callback.
+ * A single owned I/O thread (running an EventLoop) serializes the commands on the wire in the order they got submitted
+ * and completes each one with its response or a timeout.
+ *
+ * Callbacks get invoked from the I/O thread, so they should not block.
+ * All methods are [Thread Safe].
+ **/
+class AsyncJuttaConnection {
+ public:
+    using ResponseCallback = EventLoop::ResponseCallback;
+    /**
+     * Gets invoked with true on success and false in case of a timeout or error.
+     **/
+    using ResultCallback = std::function<void(bool)>;
+
+ private:
+    EventLoop loop{};
+    EventLoop::MachineId machine;
+    std::thread ioThread{};
+
+ public:
+    /**
+     * Opens and initializes the given serial device and starts the I/O thread.
+     * Throws a exception in case something goes wrong.
+     **/
+    explicit AsyncJuttaConnection(std::string&& device, const serial::LinkProfile& profile = serial::LinkProfile::legacy());
+    /**
+     * Takes an already initialized connection (e.g. a serial::PtyConnection) and starts the I/O thread.
+     **/
+    explicit AsyncJuttaConnection(std::shared_ptr<serial::SerialConnection> connection);
+    AsyncJuttaConnection(const AsyncJuttaConnection&) = delete;
+    AsyncJuttaConnection& operator=(const AsyncJuttaConnection&) = delete;
+    AsyncJuttaConnection(AsyncJuttaConnection&&) = delete;
+    AsyncJuttaConnection& operator=(AsyncJuttaConnection&&) = delete;
+    /**
+     * Stops the I/O thread. All commands still pending complete with nullptr/false.
+     **/
+    ~AsyncJuttaConnection();
+
+    /**
+     * Writes the given data to the coffee maker and then waits for any response with an optional timeout.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * The result is nullptr in case a timeout occurred or writing failed.
+     **/
+    [[nodiscard]] std::future<std::shared_ptr<std::string>> write_decoded_with_response(const std::string& data, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    void write_decoded_with_response(const std::string& data, ResponseCallback&& callback, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and then waits for the given response with an optional timeout.
+     * The response has to include the "\r\n" at the end of a message.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * The result is false in case a timeout occurred or writing failed.
+     **/
+    [[nodiscard]] std::future<bool> write_decoded_wait_for(const std::string& data, const std::string& response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    void write_decoded_wait_for(const std::string& data, const std::string& response, ResultCallback&& callback, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Waits until the coffee maker responded with a "ok:\r\n", after all previously submitted commands completed.
+     * Also picks up a "ok:\r\n" that arrived after the last command got written, but before this got submitted.
+     * To disable the timeout, set the timeout to 0 seconds.
+     **/
+    [[nodiscard]] std::future<bool> wait_for_ok(const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Encodes each character into 4 JUTTA bytes and writes them to the coffee maker without waiting for a response.
+     * The result is true once everything has been written.
+     **/
+    [[nodiscard]] std::future<bool> write_decoded(const std::string& data);
+
+    /**
+     * Returns the event loop running on the I/O thread, e.g. for adding timers via post().
+     **/
+    [[nodiscard]] EventLoop& get_event_loop();
+    [[nodiscard]] EventLoop::MachineId get_machine() const;
+
+ private:
+    void start();
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -6,7 +6,10 @@
 #include <string>
 #include <vector>
 
+#include "CoroutineConnection.hpp"
+#include "JuttaCommands.hpp"
 #include "JuttaConnection.hpp"
+#include "Task.hpp"
 
 //---------------------------------------------------------------------------
 namespace jutta_proto {
@@ -56,6 +59,11 @@ class CoffeeMaker {
      **/
     bool locked{false};
 
+    /**
+     * Runs the brew sequence on the blocking connection.
+     **/
+    class BlockingConnection;
+
  public:
     /**
      * Takes an initialized JuttaConnection.
@@ -85,6 +93,12 @@ class CoffeeMaker {
      * In case it changes from true to false, the coffee maker will cancel brewing and will reset the coffee maker to it's default state before returning.
      **/
     void brew_custom_coffee(const bool* cancel, const std::chrono::milliseconds& grindTime = std::chrono::milliseconds{3600}, const std::chrono::milliseconds& waterTime = std::chrono::milliseconds{40000});
+    /**
+     * Coroutine version of brew_custom_coffee().
+     * Does not block any thread while waiting, so many of them can run on a single EventLoop thread.
+     * The CoffeeMaker, connection and cancel have to outlive the coroutine.
+     **/
+    Task<void> brew_custom_coffee(CoroutineConnection& connection, const bool* cancel, std::chrono::milliseconds grindTime = std::chrono::milliseconds{3600}, std::chrono::milliseconds waterTime = std::chrono::milliseconds{40000});
     /**
      * Simulates a button press of the given button.
      **/
@@ -106,17 +120,25 @@ class CoffeeMaker {
      **/
     [[nodiscard]] jutta_button_t get_button_num(coffee_t coffee) const;
     /**
-     * Writes the given string to the coffee maker and waits for an "ok:\r\n"
+     * Writes the given command to the coffee maker and waits for an "ok:\r\n"
+     **/
+    [[nodiscard]] bool write_and_wait(jutta_command_t command) const;
+    /**
+     * The brew sequence of brew_custom_coffee(), shared by the blocking and the coroutine version.
+     * Connection has to provide awaitable write_command(command) and sleep_cancelable(time, cancel) methods
+     * like CoroutineConnection.
      **/
-    [[nodiscard]] bool write_and_wait(const std::string& s) const;
+    template <typename Connection>
+    static Task<void> brew_custom_coffee_steps(Connection& connection, const bool* cancel, std::chrono::milliseconds grindTime, std::chrono::milliseconds waterTime);
     /**
      * Turns on the water pump and heater for the given amount of time.
      * As long as cancel is set to true, the process will continue.
      * In case it changes from true to false, the coffee maker will cancel pumping returns.
      *
-     * Returns true in case pumping was successfull and has not returned early.
+     * Results in true in case pumping was successfull and has not returned early.
      **/
-    bool pump_hot_water(const std::chrono::milliseconds& waterTime, const bool* cancel) const;
+    template <typename Connection>
+    static Task<bool> pump_hot_water(Connection& connection, std::chrono::milliseconds waterTime, const bool* cancel);
 
     /**
      * Tries to sleep the given amount of milliseconds before returning.
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Mutex that lets a waiting priority holder (e.g. a due keep-alive) go next, ahead of all regular waiters.
+ * Regular waiters arriving while a priority holder waits, have to wait until it released the lock again.
+ * This way background traffic slots in between two commands instead of waiting until no command is queued at all.
+ * Satisfies the Lockable requirements, so it can be used with std::unique_lock.
+ * [Thread Safe]
+ **/
+class CommandLock {
+ private:
+    std::mutex mutex{};
+    std::condition_variable condition{};
+    bool locked{false};
+    size_t priorityWaiters{0};
+
+ public:
+    /**
+     * Blocks until the lock is free and no priority holder is waiting for it.
+     **/
+    void lock();
+    /**
+     * Blocks until the lock is free, overtaking all regular waiters.
+     **/
+    void lock_priority();
+    /**
+     * Returns false right away in case the lock is taken or a priority holder is waiting for it.
+     **/
+    bool try_lock();
+    void unlock();
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
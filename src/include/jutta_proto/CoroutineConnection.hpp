@@ -0,0 +1,156 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "EventLoop.hpp"
+#include "JuttaCommands.hpp"
+#include "Task.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Awaitable (C++20 coroutine) interface for a single coffee maker driven by an EventLoop.
+ * While a coroutine waits for a response or sleeps, no thread is blocked.
+ * This way any number of brew and monitoring flows can run on the single thread executing EventLoop::run().
+ *
+ * Coroutines get resumed from the thread executing EventLoop::run().
+ * Example:
+ * Task<void> flow(CoroutineConnection& connection) {
+ *     std::shared_ptr<std::string> type = co_await connection.write_decoded_with_response("TY:\r\n");
+ *     co_await connection.sleep(std::chrono::seconds{1});
+ * }
+ * spawn(flow(connection));
+ **/
+class CoroutineConnection {
+ public:
+    /**
+     * Submits a command once awaited and resumes the coroutine once it completed.
+     * Results in the response (R = std::shared_ptr<std::string>, nullptr on timeout) or whether it succeeded (R = bool).
+     **/
+    template <typename R>
+    class CommandAwaitable {
+     private:
+        EventLoop& loop;
+        EventLoop::MachineId machine;
+        /**
+         * Set in case a command from the catalog gets send instead of data.
+         **/
+        std::optional<jutta_command_t> command{};
+        std::string data;
+        std::string response;
+        std::chrono::milliseconds timeout;
+        bool expectResponse;
+        std::shared_ptr<std::string> result{nullptr};
+
+     public:
+        CommandAwaitable(EventLoop& loop, EventLoop::MachineId machine, std::string&& data, std::string&& response, const std::chrono::milliseconds& timeout, bool expectResponse) : loop(loop), machine(machine), data(std::move(data)), response(std::move(response)), timeout(timeout), expectResponse(expectResponse) {}
+        CommandAwaitable(EventLoop& loop, EventLoop::MachineId machine, jutta_command_t command, const std::chrono::milliseconds& timeout) : loop(loop), machine(machine), command(command), timeout(timeout), expectResponse(true) {}
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            EventLoop::ResponseCallback callback = [this, handle](std::shared_ptr<std::string> line) {
+                result = std::move(line);
+                handle.resume();
+            };
+            if (command) {
+                loop.submit_command(machine, *command, std::move(callback), timeout);
+            } else if (expectResponse) {
+                loop.submit_wait_for(machine, data, response, std::move(callback), timeout);
+            } else {
+                loop.submit_write(machine, data, std::move(callback));
+            }
+        }
+        R await_resume() {
+            if constexpr (std::is_same_v<R, bool>) {
+                return result != nullptr;
+            } else {
+                return std::move(result);
+            }
+        }
+    };
+
+    /**
+     * Resumes the coroutine after the given time.
+     **/
+    class SleepAwaitable {
+     private:
+        EventLoop& loop;
+        std::chrono::nanoseconds duration;
+
+     public:
+        SleepAwaitable(EventLoop& loop, const std::chrono::nanoseconds& duration) : loop(loop), duration(duration) {}
+
+        [[nodiscard]] bool await_ready() const noexcept { return duration.count() <= 0; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            // Timers may only be added from inside the loop:
+            loop.post([this, handle]() { loop.add_timer(duration, [handle]() { handle.resume(); }); });
+        }
+        void await_resume() const noexcept {}
+    };
+
+ private:
+    EventLoop& loop;
+    EventLoop::MachineId machine;
+
+ public:
+    CoroutineConnection(EventLoop& loop, EventLoop::MachineId machine);
+
+    /**
+     * Writes the given data to the coffee maker and then waits for any response with an optional timeout.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Results in nullptr in case a timeout occurred or writing failed.
+     **/
+    [[nodiscard]] CommandAwaitable<std::shared_ptr<std::string>> write_decoded_with_response(std::string data, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and then waits for the given response with an optional timeout.
+     * The response has to include the "\r\n" at the end of a message.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Results in false in case a timeout occurred or writing failed.
+     **/
+    [[nodiscard]] CommandAwaitable<bool> write_decoded_wait_for(std::string data, std::string response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and waits for an "ok:\r\n".
+     **/
+    [[nodiscard]] CommandAwaitable<bool> write_and_wait(std::string data, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given command, encoded at compile time, to the coffee maker and waits for the response it gets acknowledged with
+     * (e.g. "ok:\r\n", see CommandInfo::response).
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Results in false in case a timeout occurred or writing failed.
+     **/
+    [[nodiscard]] CommandAwaitable<bool> write_command(jutta_command_t command, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Waits until the coffee maker responded with a "ok:\r\n".
+     * Also picks up a "ok:\r\n" that arrived after the last command got written, but before this got awaited.
+     * To disable the timeout, set the timeout to 0 seconds.
+     **/
+    [[nodiscard]] CommandAwaitable<bool> wait_for_ok(const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker without waiting for a response.
+     * Results in true once everything has been written.
+     **/
+    [[nodiscard]] CommandAwaitable<bool> write_decoded(std::string data);
+    /**
+     * Suspends the coroutine for the given time without blocking any thread.
+     **/
+    [[nodiscard]] SleepAwaitable sleep(const std::chrono::nanoseconds& duration);
+    /**
+     * Suspends the coroutine for the given time.
+     * In case cancel will be set to true, it returns after roughly 100ms, since the check happens every <= 100ms.
+     * Results in true in case the sleep was successfull and has not returned early.
+     **/
+    [[nodiscard]] Task<bool> sleep_cancelable(std::chrono::milliseconds time, const bool* cancel);
+
+    [[nodiscard]] EventLoop& get_event_loop() const;
+    [[nodiscard]] EventLoop::MachineId get_machine() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
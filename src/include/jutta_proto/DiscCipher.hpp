@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * The disc based cipher used for '&' prefixed frames.
+ * Every data nibble gets pushed through the two substitution discs depending on the key and its nibble position inside the frame.
+ * The cipher is an involution, so encrypting and decrypting are the same operation.
+ *
+ * A frame on the wire looks like: '&' <key> <encrypted data> '\r' '\n'
+ * Bytes inside the frame, that would collide with the framing, are escaped as 0x1B followed by the byte XOR 0x80.
+ *
+ * Example (keep alive frame, see protocol_snoops/snoop_keep_alive.txt):
+ * & 0x52 9E 4B B8 15 8A 5E 8F C1 CA 72 AB D2 D8 9B CC 1D 43 BD \r \n -> @TF:400000000800\r\n
+ **/
+class DiscCipher {
+ public:
+    static constexpr uint8_t FRAME_START = '&';
+    static constexpr uint8_t ESCAPE = 0x1B;
+    static constexpr uint8_t ESCAPE_XOR = 0x80;
+
+ private:
+    static constexpr std::array<uint8_t, 16> DISC_1 = {0x08, 0x0E, 0x0C, 0x04, 0x03, 0x0D, 0x0A, 0x0B, 0x00, 0x0F, 0x06, 0x07, 0x02, 0x05, 0x01, 0x09};
+    static constexpr std::array<uint8_t, 16> DISC_2 = {0x04, 0x0B, 0x0D, 0x0A, 0x00, 0x07, 0x0F, 0x05, 0x09, 0x08, 0x03, 0x01, 0x0E, 0x02, 0x0C, 0x06};
+
+ public:
+    /**
+     * The result of the disc shuffle for nibble d at nibble position n with key nibbles kl and kr only depends on two values:
+     * a = (n + kl) % 16
+     * c = (kr + (n / 16) - n - kl) % 16
+     * So one 16 entry substitution row per (a, c) combination covers all keys and nibble positions.
+     * The table is indexed by (a << 4) | c.
+     **/
+    static constexpr std::array<std::array<uint8_t, 16>, 256> SUBSTITUTION = [] {
+        std::array<std::array<uint8_t, 16>, 256> table{};
+        for (size_t a = 0; a < 16; a++) {
+            for (size_t c = 0; c < 16; c++) {
+                for (size_t d = 0; d < 16; d++) {
+                    const uint8_t t1 = DISC_1[(d + a) & 0x0F];
+                    const uint8_t t2 = DISC_2[(t1 + c) & 0x0F];
+                    const uint8_t t3 = DISC_1[(t2 - c) & 0x0F];
+                    table[(a << 4) | c][d] = (t3 - a) & 0x0F;
+                }
+            }
+        }
+        return table;
+    }();
+
+ private:
+    uint8_t key{0};
+    /**
+     * The SUBSTITUTION row for each nibble position.
+     * The nibble counter is a single byte on the coffee maker, so positions repeat after 256 nibbles.
+     **/
+    std::array<uint8_t, 256> rows{};
+
+ public:
+    DiscCipher() = default;
+    /**
+     * Precomputes the substitution rows for all nibble positions of the given key.
+     **/
+    explicit DiscCipher(uint8_t key);
+
+    /**
+     * Returns the precomputed cipher for the given key.
+     * All 256 keys get precomputed once on first use.
+     * [Thread Safe]
+     **/
+    static const DiscCipher& for_key(uint8_t key);
+
+    /**
+     * Encrypts the given (unescaped) data in place.
+     * nibbleOffset is the nibble position of the first data byte inside the frame.
+     **/
+    void encrypt(std::span<uint8_t> data, size_t nibbleOffset = 0) const;
+    /**
+     * Decrypts the given (unescaped) data in place.
+     * nibbleOffset is the nibble position of the first data byte inside the frame.
+     **/
+    void decrypt(std::span<uint8_t> data, size_t nibbleOffset = 0) const;
+
+    /**
+     * Decrypts the given '&' frame in place.
+     * Removes the escaping and the key and stores the plain text at the beginning of the given buffer.
+     * Decryption stops at the unencrypted '\r' terminating the frame or at the end of the buffer.
+     * Returns the plain text length or 0 in case the given data is no valid '&' frame.
+     **/
+    static size_t decrypt_frame(std::span<uint8_t> frame);
+    /**
+     * Decrypts all given '&' frames in place and stores the resulting plain text lengths in lengths.
+     * Frames that are invalid get a length of 0.
+     * Returns the number of frames processed (min(frames.size(), lengths.size())).
+     **/
+    static size_t decrypt_frames(std::span<const std::span<uint8_t>> frames, std::span<size_t> lengths);
+    /**
+     * Encrypts the given plain text with the given key and writes the complete (escaped) '&' frame including the "\r\n" into out.
+     * In the worst case, out has to hold (2 * plain.size()) + 5 bytes.
+     * Returns the frame length or 0 in case out is too small.
+     **/
+    static size_t encrypt_frame(uint8_t key, std::span<const uint8_t> plain, std::span<uint8_t> out);
+
+    [[nodiscard]] uint8_t get_key() const;
+
+ private:
+    void apply(std::span<uint8_t> data, size_t nibbleOffset) const;
+    /**
+     * Returns true for all bytes that have to be escaped inside a frame.
+     **/
+    static constexpr bool needs_escape(uint8_t b) { return b == '\r' || b == '\n' || b == ESCAPE || b == FRAME_START; }
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "FrameRouter.hpp"
+#include "JuttaCommands.hpp"
+#include "LineFramer.hpp"
+#include "LinkSupervisor.hpp"
+#include "StreamDecoder.hpp"
+#include "TransmitPacer.hpp"
+#include "WireCapture.hpp"
+#include "serial/SerialConnection.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Drives any number of coffee makers from a single thread.
+ * All serial file descriptors are multiplexed with epoll. Quad pacing, response timeouts and user timers share one timerfd,
+ * which always gets armed for the earliest deadline. So the thread only wakes up in case there is something to do.
+ *
+ * Each machine has its own command pipeline: commands get send one after another, each waiting for its response.
+ * Machines are completely independent of each other.
+ *
+ * Each machine has its own LinkSupervisor. Once the link goes down (I/O error, hangup or too many consecutive timeouts),
+ * all pending commands fail right away and the connection gets reopened with exponential backoff.
+ * A "TY:" probe has to succeed before the machine accepts commands again. Until then, submitted commands fail right away.
+ *
+ * Received lines, that are no response to the command being executed (e.g. '&' keep alive frames),
+ * get dispatched to the subscribers of the per machine FrameRouter.
+ * Solicited lines received while no command waits for a response, get additionally kept for a following command that does
+ * not write anything (e.g. wait_for_ok() after write_decoded()), so a fast response does not get lost.
+ *
+ * All callbacks get invoked from the thread executing run().
+ **/
+class EventLoop {
+ public:
+    using MachineId = size_t;
+    using TimerId = uint64_t;
+    /**
+     * Gets invoked with the received response (including the "\r\n") or nullptr in case of a timeout or error.
+     **/
+    using ResponseCallback = std::function<void(std::shared_ptr<std::string>)>;
+    using TimerCallback = std::function<void()>;
+
+    /**
+     * In case no new data arrives for this time, the coffee maker finished sending.
+     **/
+    static constexpr std::chrono::milliseconds LINE_QUIET_TIME{50};
+    /**
+     * How long to wait for the response to "TY:\r\n" after reopening a connection.
+     **/
+    static constexpr std::chrono::milliseconds RECONNECT_PROBE_TIMEOUT{1000};
+    /**
+     * The maximum number of lines kept for a following command, that does not write anything.
+     **/
+    static constexpr size_t MAX_EARLY_LINES = 8;
+
+ private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Command {
+        std::vector<uint8_t> wire{};
+        /**
+         * The response to wait for. Empty in case any response completes the command.
+         **/
+        std::string response{};
+        std::chrono::milliseconds timeout{0};
+        ResponseCallback callback{};
+        /**
+         * False in case the command is done, once all quads have been written.
+         **/
+        bool expectResponse{true};
+    };
+
+    enum class MachineState { IDLE,
+                              TRANSMITTING,
+                              WAITING,
+                              FAILED };
+
+    struct Machine {
+        std::shared_ptr<serial::SerialConnection> connection;
+        StreamDecoder decoder{};
+        TransmitPacer pacer{};
+        /**
+         * Splits the decoded bytes into lines.
+         **/
+        LineFramer framer{};
+        std::deque<Command> queue{};
+        MachineState state{MachineState::IDLE};
+        size_t nextQuad{0};
+        TimePoint messageStart{};
+        TimePoint nextRelease{};
+        TimePoint responseDeadline{TimePoint::max()};
+        TimePoint lastRx{};
+        FrameRouter router{};
+        /**
+         * Solicited lines received while no command waited for a response.
+         * Cleared once the next command gets written, since they can not be the response to it.
+         **/
+        std::deque<std::string> earlyLines{};
+        LinkSupervisor supervisor{};
+        /**
+         * True while waiting for the response to the "TY:" probe after reopening the connection.
+         **/
+        bool reconnecting{false};
+        /**
+         * Records all traffic of this machine in case set.
+         **/
+        std::shared_ptr<WireCapture> capture{};
+    };
+
+    int epollFd{-1};
+    /**
+     * eventfd used for waking up the loop from other threads.
+     **/
+    int wakeFd{-1};
+    int timerFd{-1};
+    /**
+     * The deadline timerFd is currently armed for.
+     **/
+    TimePoint armedDeadline{TimePoint::max()};
+
+    std::vector<std::unique_ptr<Machine>> machines{};
+    std::map<std::pair<TimePoint, TimerId>, TimerCallback> timers{};
+    std::unordered_map<TimerId, TimePoint> timerDeadlines{};
+    TimerId nextTimerId{1};
+
+    /**
+     * Only set by stop() and never reset, so a stop() issued before run() got entered does not get lost.
+     **/
+    std::atomic<bool> stopRequested{false};
+    /**
+     * Tasks posted from other threads that should be executed inside the loop.
+     **/
+    std::mutex inboxLock{};
+    std::vector<std::function<void()>> inbox{};
+
+ public:
+    /**
+     * Throws a exception in case epoll, eventfd or timerfd can not be created.
+     **/
+    EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    EventLoop(EventLoop&&) = delete;
+    EventLoop& operator=(EventLoop&&) = delete;
+    ~EventLoop();
+
+    /**
+     * Opens and initializes the given serial device with the given profile and adds it to the loop.
+     * Throws a exception in case something goes wrong.
+     * Has to be called before run().
+     **/
+    MachineId add_machine(std::string&& device, const serial::LinkProfile& profile = serial::LinkProfile::legacy());
+    /**
+     * Adds the given, already initialized connection (e.g. a serial::PtyConnection) to the loop.
+     * Has to be called before run().
+     **/
+    MachineId add_machine(std::shared_ptr<serial::SerialConnection> connection);
+    [[nodiscard]] size_t get_machine_count() const;
+    /**
+     * Returns the router of the given machine for subscribing to lines, that are no response to a command.
+     * Subscribers get invoked from the thread executing run().
+     * [Thread Safe]
+     **/
+    [[nodiscard]] FrameRouter& get_router(MachineId machine);
+    /**
+     * Sets the stall detection and reconnect backoff configuration for the given machine.
+     * Has to be called before run().
+     **/
+    void set_link_config(MachineId machine, const LinkSupervisor::Config& config);
+    /**
+     * Returns the link statistics (timeouts, errors, reconnects, recovery time, ...) of the given machine.
+     * Not thread safe! Call it from inside a callback or use post().
+     **/
+    [[nodiscard]] const LinkSupervisor::Stats& get_link_stats(MachineId machine) const;
+    /**
+     * Starts recording the traffic of the given machine (encoded quads in both directions and decoded received bytes)
+     * into the given capture. The loop is the only producer of the capture, so use one capture per machine.
+     * nullptr stops recording.
+     * Not thread safe! Call it before run(), from inside a callback or use post().
+     **/
+    void set_capture(MachineId machine, std::shared_ptr<WireCapture> capture);
+
+    /**
+     * Queues the given data for the given machine. The callback gets invoked with the first line received afterwards.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * [Thread Safe]
+     **/
+    void submit(MachineId machine, const std::string& data, ResponseCallback&& callback, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Queues the given data for the given machine. The callback gets invoked with the first line containing the given response.
+     * The response has to include the "\r\n" at the end of a message.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * [Thread Safe]
+     **/
+    void submit_wait_for(MachineId machine, const std::string& data, const std::string& response, ResponseCallback&& callback, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Queues the given command, encoded at compile time, for the given machine.
+     * The callback gets invoked with the first line containing the response the command gets acknowledged with (see CommandInfo::response).
+     * To disable the timeout, set the timeout to 0 seconds.
+     * [Thread Safe]
+     **/
+    void submit_command(MachineId machine, jutta_command_t command, ResponseCallback&& callback, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Queues the given data for the given machine without waiting for a response.
+     * The callback gets invoked with an empty string once all quads have been written or nullptr in case writing failed.
+     * [Thread Safe]
+     **/
+    void submit_write(MachineId machine, const std::string& data, ResponseCallback&& callback);
+    /**
+     * Executes the given function inside the loop.
+     * [Thread Safe]
+     **/
+    void post(std::function<void()>&& task);
+
+    /**
+     * Invokes the given callback once after the given delay.
+     * Not thread safe! Call it from inside a callback or use post().
+     **/
+    TimerId add_timer(const std::chrono::nanoseconds& delay, TimerCallback&& callback);
+    /**
+     * Returns true in case the timer was still pending.
+     * Not thread safe! Call it from inside a callback or use post().
+     **/
+    bool cancel_timer(TimerId timer);
+
+    /**
+     * Runs the loop until stop() gets called.
+     * Returns right away in case stop() got called before.
+     **/
+    void run();
+    /**
+     * Waits for at maximum the given timeout for events and processes them.
+     * A negative timeout waits until the next event.
+     **/
+    void run_once(const std::chrono::milliseconds& timeout);
+    /**
+     * Makes run() return, also in case it did not get entered yet.
+     * [Thread Safe]
+     **/
+    void stop();
+    /**
+     * Executes all posted tasks and fails all pending commands (the callbacks get invoked with nullptr).
+     * Call it after run() returned, e.g. before destroying the loop, so nobody waits for a command that never completes.
+     * Not thread safe!
+     **/
+    void cancel_all();
+
+ private:
+    [[nodiscard]] static Command make_command(const std::string& data, const std::string& response, ResponseCallback&& callback, const std::chrono::milliseconds& timeout);
+    [[nodiscard]] static Command make_command(jutta_command_t command, ResponseCallback&& callback, const std::chrono::milliseconds& timeout);
+    void wake() const;
+    void drain_inbox();
+    void enqueue(MachineId machine, Command&& command);
+    /**
+     * Reads and decodes everything available and dispatches complete lines.
+     **/
+    void on_readable(MachineId id, Machine& machine);
+    void on_line(MachineId id, Machine& machine, std::string_view line);
+    /**
+     * Advances the command pipeline of the given machine (starting commands, releasing due quads, timeouts).
+     **/
+    void service(MachineId id, Machine& machine, TimePoint now);
+    void complete(Machine& machine, std::shared_ptr<std::string>&& response);
+    /**
+     * Takes the link down, fails all pending commands and schedules a reconnect attempt.
+     **/
+    void fail(MachineId id, Machine& machine);
+    void schedule_reconnect(MachineId id);
+    /**
+     * Reopens the connection and sends the "TY:" probe.
+     **/
+    void reconnect(MachineId id);
+    void fire_timers(TimePoint now);
+    [[nodiscard]] TimePoint next_deadline(const Machine& machine) const;
+    /**
+     * Arms the timerfd for the earliest pending deadline.
+     **/
+    void arm_timer();
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * String with a fixed capacity of N characters stored inline.
+ * Used for returning responses without allocating on the heap.
+ **/
+template <size_t N>
+class FixedString {
+ private:
+    std::array<char, N> storage{};
+    size_t length{0};
+
+ public:
+    constexpr FixedString() = default;
+
+    /**
+     * Replaces the content with the given string.
+     * Returns false and leaves the content unchanged in case it does not fit.
+     **/
+    constexpr bool assign(std::string_view str) {
+        if (str.size() > N) {
+            return false;
+        }
+        std::copy(str.begin(), str.end(), storage.begin());
+        length = str.size();
+        return true;
+    }
+    /**
+     * Returns the whole storage for writing into it directly. Call resize() afterwards.
+     **/
+    [[nodiscard]] constexpr std::span<char, N> buffer() { return storage; }
+    constexpr void resize(size_t size) {
+        assert(size <= N);
+        length = size;
+    }
+
+    [[nodiscard]] constexpr std::string_view view() const { return std::string_view(storage.data(), length); }
+    [[nodiscard]] constexpr const char* data() const { return storage.data(); }
+    [[nodiscard]] constexpr size_t size() const { return length; }
+    [[nodiscard]] static constexpr size_t capacity() { return N; }
+    [[nodiscard]] constexpr bool empty() const { return length <= 0; }
+
+    // NOLINTNEXTLINE (google-explicit-constructor, hicpp-explicit-conversions)
+    constexpr operator std::string_view() const { return view(); }
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
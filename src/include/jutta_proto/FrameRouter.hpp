@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Routes complete ("\r\n" terminated) frames received from the coffee maker.
+ * Replies get matched against the outstanding command. Everything else (e.g. the '&' keep alive frames
+ * or "ku:"/"Ku:" debug streams) gets dispatched to the subscribers registered for its prefix instead of being dropped.
+ *
+ * Handlers get invoked without holding any lock, so they may (un)subscribe.
+ * [Thread Safe]
+ **/
+class FrameRouter {
+ public:
+    /**
+     * Gets invoked with the complete frame (including the "\r\n").
+     * The view is only valid during the call.
+     **/
+    using Handler = std::function<void(std::string_view)>;
+    using SubscriptionId = size_t;
+
+    struct Stats {
+        /**
+         * Frames matched as reply to the outstanding command.
+         **/
+        size_t replies{0};
+        /**
+         * Frames handed to at least one subscriber.
+         **/
+        size_t dispatched{0};
+        /**
+         * Frames no subscriber was interested in.
+         **/
+        size_t unrouted{0};
+    };
+
+    /**
+     * Frames starting with one of these prefixes are pushed by the coffee maker on its own and never count as reply,
+     * in case a command waits for any response.
+     **/
+    static constexpr std::array<std::string_view, 3> DEFAULT_UNSOLICITED_PREFIXES{"&", "ku:", "Ku:"};
+
+ private:
+    struct Subscription {
+        SubscriptionId id;
+        std::string prefix;
+        Handler handler;
+    };
+    using Subscriptions = std::vector<Subscription>;
+
+    mutable std::mutex lock{};
+    /**
+     * Copy on write, so dispatching only has to grab the current list.
+     **/
+    std::shared_ptr<const Subscriptions> subscriptions{std::make_shared<const Subscriptions>()};
+    std::vector<std::string> unsolicitedPrefixes{DEFAULT_UNSOLICITED_PREFIXES.begin(), DEFAULT_UNSOLICITED_PREFIXES.end()};
+    SubscriptionId nextId{1};
+    Stats stats{};
+
+ public:
+    /**
+     * Registers the given handler for all frames starting with the given prefix. An empty prefix matches all frames.
+     * Returns the id required for unsubscribing.
+     **/
+    SubscriptionId subscribe(std::string prefix, Handler&& handler);
+    /**
+     * Returns true in case the subscription existed.
+     **/
+    bool unsubscribe(SubscriptionId id);
+    /**
+     * Replaces the prefixes of frames that are never considered a reply to commands waiting for any response.
+     **/
+    void set_unsolicited_prefixes(std::vector<std::string>&& prefixes);
+
+    /**
+     * Returns true in case the given frame is the reply for the outstanding command.
+     * A frame is a reply in case it contains the expected response or, for an empty expected response, is no unsolicited frame.
+     * Otherwise the frame gets dispatched to the subscribers and false is returned.
+     **/
+    bool route(std::string_view frame, std::string_view expected);
+    /**
+     * Hands the given frame to all subscribers with a matching prefix.
+     * Returns the number of subscribers invoked.
+     **/
+    size_t dispatch(std::string_view frame);
+    [[nodiscard]] bool is_unsolicited(std::string_view frame) const;
+
+    [[nodiscard]] Stats get_stats() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
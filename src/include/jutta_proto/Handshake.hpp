@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ResponseParser.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+enum class handshake_state_t : uint8_t {
+    /**
+     * Not started yet.
+     **/
+    IDLE,
+    /**
+     * "@T1" got send, waiting for "@t1".
+     **/
+    WAIT_START,
+    /**
+     * Waiting for the coffee maker to send "@T2:<key>".
+     **/
+    WAIT_KEY_EXCHANGE,
+    /**
+     * "@t2:..." got send, waiting for "@T3:...".
+     **/
+    WAIT_END,
+    /**
+     * "@t3" got send, the handshake is complete.
+     **/
+    DONE,
+    /**
+     * A step did not complete before its deadline.
+     **/
+    FAILED
+};
+
+/**
+ * The "@T1" ... "@t3" key exchange between the dongle and the coffee maker as explicit state machine:
+ * Dongle: @T1      Coffee maker: @t1
+ *                  Coffee maker: @T2:<key>
+ * Dongle: @t2:...  Coffee maker: @T3:<token><machine type>
+ * Dongle: @t3
+ *
+ * Pure bookkeeping without any I/O, so it can be driven by the blocking JuttaConnection (see perform_handshake())
+ * as well as by the EventLoop: feed it all received frames and the current time, send what it returns
+ * and call on_tick() once get_deadline() passed.
+ * Each step has its own deadline, so the handshake never waits forever.
+ * Not thread safe!
+ **/
+class Handshake {
+ public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Config {
+        /**
+         * Time the coffee maker has for answering "@T1" with "@t1".
+         **/
+        std::chrono::milliseconds startTimeout{1000};
+        /**
+         * Time the coffee maker has for sending "@T2:..." after "@t1".
+         **/
+        std::chrono::milliseconds keyExchangeTimeout{2000};
+        /**
+         * Time the coffee maker has for answering "@t2:..." with "@T3:...".
+         **/
+        std::chrono::milliseconds endTimeout{2000};
+        /**
+         * The response to the key exchange request. Its meaning is unknown, the default one has been captured from a JURA dongle.
+         **/
+        std::string keyExchangeResponse{"@t2:8120000000\r\n"};
+    };
+
+    /**
+     * Duration of each phase. Zero for phases that did not complete.
+     **/
+    struct Timing {
+        /**
+         * "@T1" until "@t1".
+         **/
+        std::chrono::microseconds start{0};
+        /**
+         * "@t1" until "@T2:...".
+         **/
+        std::chrono::microseconds keyExchange{0};
+        /**
+         * "@t2:..." until "@T3:...".
+         **/
+        std::chrono::microseconds end{0};
+        /**
+         * "@T1" until the handshake completed or failed.
+         **/
+        std::chrono::microseconds total{0};
+    };
+
+    /**
+     * The result of feeding a frame into the handshake.
+     **/
+    struct Step {
+        /**
+         * True in case the frame belonged to the handshake. All other frames should be handled as usual (e.g. dispatched).
+         **/
+        bool consumed{false};
+        /**
+         * Data (including the "\r\n") to send to the coffee maker right away. Empty in case there is nothing to send.
+         **/
+        std::string_view send{};
+    };
+
+    static constexpr std::string_view START_REQUEST = "@T1\r\n";
+    static constexpr std::string_view END_RESPONSE = "@t3\r\n";
+
+ private:
+    Config config;
+    handshake_state_t state{handshake_state_t::IDLE};
+    /**
+     * The state the handshake was in when it failed.
+     **/
+    handshake_state_t failedIn{handshake_state_t::IDLE};
+    TimePoint started{};
+    TimePoint phaseStarted{};
+    TimePoint deadline{TimePoint::max()};
+    Timing timing{};
+    std::optional<KeyExchangeResponse> keyExchange{};
+    std::optional<std::array<uint8_t, 2>> token{};
+
+ public:
+    Handshake();
+    explicit Handshake(Config config);
+
+    /**
+     * (Re)starts the handshake.
+     * Returns the data to send ("@T1\r\n").
+     **/
+    [[nodiscard]] std::string_view start(TimePoint now);
+    /**
+     * Feeds the given received frame into the handshake.
+     **/
+    [[nodiscard]] Step on_frame(std::string_view frame, TimePoint now);
+    /**
+     * Fails the handshake in case the deadline of the current step passed.
+     * Returns true in case it failed.
+     **/
+    bool on_tick(TimePoint now);
+
+    [[nodiscard]] handshake_state_t get_state() const;
+    /**
+     * Returns the state the handshake was in when it failed or IDLE in case it did not fail.
+     **/
+    [[nodiscard]] handshake_state_t get_failed_state() const;
+    [[nodiscard]] bool is_done() const;
+    /**
+     * True once the handshake completed or failed.
+     **/
+    [[nodiscard]] bool is_finished() const;
+    /**
+     * The deadline of the current step. TimePoint::max() in case the handshake is not running.
+     **/
+    [[nodiscard]] TimePoint get_deadline() const;
+    [[nodiscard]] const Timing& get_timing() const;
+    [[nodiscard]] const Config& get_config() const;
+    /**
+     * The key received with "@T2:...". std::nullopt until received.
+     **/
+    [[nodiscard]] const std::optional<KeyExchangeResponse>& get_key_exchange() const;
+    /**
+     * The token received with "@T3:...". std::nullopt until received.
+     **/
+    [[nodiscard]] const std::optional<std::array<uint8_t, 2>>& get_token() const;
+
+    [[nodiscard]] static std::string_view to_string(handshake_state_t state);
+
+ private:
+    /**
+     * Finishes the current phase, stores its duration and moves on to the given state.
+     **/
+    void advance(handshake_state_t next, std::chrono::microseconds Timing::*phase, const std::chrono::milliseconds& timeout, TimePoint now);
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
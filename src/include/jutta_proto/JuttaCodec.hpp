@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * The base bit layout for all encoded (wire) bytes.
+ * Only bit 2 and 5 carry actual data, all other bits are fixed.
+ **/
+constexpr uint8_t WIRE_BASE = 0b01011011;
+/**
+ * Mask for the two data carrying bits of an encoded (wire) byte.
+ **/
+constexpr uint8_t WIRE_DATA_MASK = 0b00100100;
+/**
+ * Number of encoded (wire) bytes that represent a single data byte.
+ **/
+constexpr size_t WIRE_QUAD_SIZE = 4;
+
+/**
+ * Returns true in case the given byte matches the base bit layout of an encoded (wire) byte.
+ **/
+constexpr bool is_wire_byte(uint8_t b) { return (b & static_cast<uint8_t>(~WIRE_DATA_MASK)) == WIRE_BASE; }
+
+/**
+ * Encodes the given byte into four bytes that the coffee maker understands.
+ * Reference implementation (bit by bit) used for generating and verifying the lookup tables.
+ * Based on: http://protocoljura.wiki-site.com/index.php/Protocol_to_coffeemaker
+ *
+ * A full documentation of the process can be found here:
+ * https://github.com/Jutta-Proto/protocol-cpp#deobfuscating
+ **/
+constexpr std::array<uint8_t, 4> encode_scalar(uint8_t decData) {
+    // 1111 0000 -> 0000 1111:
+    uint8_t tmp = ((decData & 0xF0) >> 4) | ((decData & 0x0F) << 4);
+
+    // 1100 1100 -> 0011 0011:
+    tmp = ((tmp & 0xC0) >> 2) | ((tmp & 0x30) << 2) | ((tmp & 0x0C) >> 2) | ((tmp & 0x03) << 2);
+
+    std::array<uint8_t, 4> encData{};
+    encData[0] = WIRE_BASE | ((tmp & 0b10000000) >> 2);
+    encData[0] |= ((tmp & 0b01000000) >> 4);
+
+    encData[1] = WIRE_BASE | (tmp & 0b00100000);
+    encData[1] |= ((tmp & 0b00010000) >> 2);
+
+    encData[2] = WIRE_BASE | ((tmp & 0b00001000) << 2);
+    encData[2] |= (tmp & 0b00000100);
+
+    encData[3] = WIRE_BASE | ((tmp & 0b00000010) << 4);
+    encData[3] |= ((tmp & 0b00000001) << 2);
+
+    return encData;
+}
+
+/**
+ * Decodes the given four bytes read from the coffee maker into on byte.
+ * Reference implementation (bit by bit) used for generating and verifying the lookup tables.
+ * Based on: http://protocoljura.wiki-site.com/index.php/Protocol_to_coffeemaker
+ *
+ * A full documentation of the process can be found here:
+ * https://github.com/Jutta-Proto/protocol-cpp#deobfuscating
+ **/
+constexpr uint8_t decode_scalar(const std::array<uint8_t, 4>& encData) {
+    // Bit mask for the 2. bit from the left:
+    constexpr uint8_t B2_MASK = (0b10000000 >> 2);
+    // Bit mask for the 5. bit from the left:
+    constexpr uint8_t B5_MASK = (0b10000000 >> 5);
+
+    uint8_t decData = 0;
+    decData |= (encData[0] & B2_MASK) << 2;
+    decData |= (encData[0] & B5_MASK) << 4;
+
+    decData |= (encData[1] & B2_MASK);
+    decData |= (encData[1] & B5_MASK) << 2;
+
+    decData |= (encData[2] & B2_MASK) >> 2;
+    decData |= (encData[2] & B5_MASK);
+
+    decData |= (encData[3] & B2_MASK) >> 4;
+    decData |= (encData[3] & B5_MASK) >> 2;
+
+    // 1111 0000 -> 0000 1111:
+    decData = ((decData & 0xF0) >> 4) | ((decData & 0x0F) << 4);
+
+    // 1100 1100 -> 0011 0011:
+    decData = ((decData & 0xC0) >> 2) | ((decData & 0x30) << 2) | ((decData & 0x0C) >> 2) | ((decData & 0x03) << 2);
+
+    return decData;
+}
+
+/**
+ * Lookup table mapping every data byte to its four encoded (wire) bytes.
+ **/
+inline constexpr std::array<std::array<uint8_t, 4>, 256> ENCODE_TABLE = [] {
+    std::array<std::array<uint8_t, 4>, 256> table{};
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = encode_scalar(static_cast<uint8_t>(i));
+    }
+    return table;
+}();
+
+/**
+ * Lookup table mapping every encoded (wire) byte to the two data bits it carries.
+ * All the bit shuffling of the decoding process boils down to the wire byte at quad position i
+ * contributing bits (2 * i + 1, 2 * i) of the resulting data byte.
+ * So decoding a quad is: T[q0] | T[q1] << 2 | T[q2] << 4 | T[q3] << 6
+ **/
+inline constexpr std::array<uint8_t, 256> DECODE_TABLE = [] {
+    std::array<uint8_t, 256> table{};
+    for (size_t i = 0; i < table.size(); i++) {
+        table[i] = decode_scalar({static_cast<uint8_t>(i), WIRE_BASE, WIRE_BASE, WIRE_BASE}) & 0b11;
+    }
+    return table;
+}();
+
+/**
+ * Encodes the given byte into four bytes that the coffee maker understands by using the ENCODE_TABLE.
+ **/
+constexpr std::array<uint8_t, 4> encode_table(uint8_t decData) { return ENCODE_TABLE[decData]; }
+
+/**
+ * Decodes the given four bytes read from the coffee maker into one byte by using the DECODE_TABLE.
+ **/
+constexpr uint8_t decode_table(const uint8_t* encData) {
+    return static_cast<uint8_t>(DECODE_TABLE[encData[0]] | (DECODE_TABLE[encData[1]] << 2) | (DECODE_TABLE[encData[2]] << 4) | (DECODE_TABLE[encData[3]] << 6));
+}
+
+/**
+ * Encodes all given data bytes into wire bytes in one pass.
+ * Stops once either all data bytes have been encoded or there is no space left in out for a whole quad.
+ * Returns the number of wire bytes written to out (always a multiple of 4).
+ **/
+size_t encode_block(std::span<const uint8_t> data, std::span<uint8_t> out);
+/**
+ * Encodes all given data bytes into a newly allocated vector of wire bytes.
+ **/
+[[nodiscard]] std::vector<uint8_t> encode_block(std::span<const uint8_t> data);
+/**
+ * Decodes all complete quads of the given wire bytes in one pass.
+ * Uses the SIMD (SSE2/NEON) decoder in case it is available for the current target.
+ * Trailing wire bytes, that do not form a complete quad are ignored.
+ * Stops once either all quads have been decoded or there is no space left in out.
+ * Returns the number of data bytes written to out.
+ **/
+size_t decode_block(std::span<const uint8_t> wire, std::span<uint8_t> out);
+/**
+ * Same as decode_block, but always uses the portable, table based decoder.
+ **/
+size_t decode_block_table(std::span<const uint8_t> wire, std::span<uint8_t> out);
+/**
+ * Same as decode_block, but uses the SIMD decoder for all full vectors and the table based decoder for the rest.
+ * Falls back to the table based decoder entirely in case no SIMD decoder is available for the current target.
+ **/
+size_t decode_block_simd(std::span<const uint8_t> wire, std::span<uint8_t> out);
+/**
+ * Returns true in case a SIMD (SSE2/NEON) decoder has been compiled in.
+ **/
+constexpr bool has_simd_decoder() {
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    return true;
+#else
+    return false;
+#endif
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -1,34 +1,229 @@
 #pragma once
 
-#include <string>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "JuttaCodec.hpp"
 
 //---------------------------------------------------------------------------
 namespace jutta_proto {
 //---------------------------------------------------------------------------
-const std::string JUTTA_POWER_OFF = "AN:01\r\n";
-const std::string JUTTA_TEST_MODE_ON = "AN:20\r\n";
-const std::string JUTTA_TEST_MODE_OFF = "AN:21\r\n";
-
-const std::string JUTTA_GET_TYPE = "TY:\r\n";
-
-const std::string JUTTA_BUTTON_1 = "FA:04\r\n";
-const std::string JUTTA_BUTTON_2 = "FA:05\r\n";
-const std::string JUTTA_BUTTON_3 = "FA:06\r\n";
-const std::string JUTTA_BUTTON_4 = "FA:07\r\n";
-const std::string JUTTA_BUTTON_5 = "FA:08\r\n";
-const std::string JUTTA_BUTTON_6 = "FA:09\r\n";
-
-const std::string JUTTA_BREW_GROUP_TO_BREWING_POSITION = "FN:22\r\n";
-const std::string JUTTA_BREW_GROUP_RESET = "FN:0D\r\n";
-
-const std::string JUTTA_GRINDER_ON = "FN:07\r\n";
-const std::string JUTTA_GRINDER_OFF = "FN:08\r\n";
-const std::string JUTTA_COFFEE_PRESS_ON = "FN:0B\r\n";
-const std::string JUTTA_COFFEE_PRESS_OFF = "FN:0C\r\n";
-const std::string JUTTA_COFFEE_WATER_HEATER_ON = "FN:03\r\n";
-const std::string JUTTA_COFFEE_WATER_HEATER_OFF = "FN:04\r\n";
-const std::string JUTTA_COFFEE_WATER_PUMP_ON = "FN:01\r\n";
-const std::string JUTTA_COFFEE_WATER_PUMP_OFF = "FN:02\r\n";
+/**
+ * All commands listed in the command table of the README.
+ * Unknown commands are named after their code.
+ **/
+enum class jutta_command_t : uint8_t {
+    AN_01,
+    POWER_OFF,
+    ERASE_EEPROM,
+    TEST_UCHI,
+    TEST_MODE_ON,
+    TEST_MODE_OFF,
+    AN_40,
+    AN_AA,
+    GET_TYPE,
+    FA_01,
+    BUTTON_1,
+    BUTTON_2,
+    BUTTON_3,
+    BUTTON_4,
+    BUTTON_5,
+    BUTTON_6,
+    COFFEE_WATER_PUMP_ON,
+    COFFEE_WATER_PUMP_OFF,
+    COFFEE_WATER_HEATER_ON,
+    COFFEE_WATER_HEATER_OFF,
+    GRINDER_ON,
+    GRINDER_OFF,
+    BREW_GROUP_UNKNOWN_ON,
+    BREW_GROUP_UNKNOWN_OFF,
+    COFFEE_PRESS_ON,
+    COFFEE_PRESS_OFF,
+    BREW_GROUP_RESET,
+    BREW_GROUP_TO_OPEN_POSITION,
+    BREW_GROUP_TO_GRINDING_POSITION,
+    BREW_GROUP_TO_POSITION_13,
+    BREW_GROUP_TO_POSITION_1B,
+    BREW_GROUP_TO_THROW_OUT_POSITION,
+    BREW_GROUP_TO_BREWING_POSITION,
+    FN_24,
+    FN_25,
+    FN_26,
+    FN_27,
+    FN_44,
+    FN_45,
+    FN_50,
+    POWER_OFF_FN,
+    FN_54,
+    FN_55,
+    FN_60,
+    FN_61,
+    FN_62,
+    FN_63,
+    FN_64,
+    FN_65,
+    FN_66,
+    FN_67,
+    FN_70,
+    FN_71,
+    FN_72,
+    FN_73,
+    FN_80,
+    FN_81,
+    FN_88,
+    DEBUG_MODE_ON,
+    FN_90,
+    FN_99
+};
+
+struct CommandInfo {
+    jutta_command_t command;
+    /**
+     * The command including the "\r\n".
+     **/
+    std::string_view data;
+    /**
+     * The response the coffee maker acknowledges the command with. Empty in case it is unknown.
+     **/
+    std::string_view response;
+    std::string_view description;
+};
+
+/**
+ * The command catalog, indexed by jutta_command_t.
+ **/
+inline constexpr std::array COMMANDS{
+    CommandInfo{jutta_command_t::AN_01, "AN:01\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::POWER_OFF, "AN:02\r\n", "ok:\r\n", "Turns off the coffee maker."},
+    CommandInfo{jutta_command_t::ERASE_EEPROM, "AN:0A\r\n", "", "Untested! Erases the EEPROM. Do not use."},
+    CommandInfo{jutta_command_t::TEST_UCHI, "AN:0C\r\n", "ok:\r\n", "Tests the UCHI steam plate."},
+    CommandInfo{jutta_command_t::TEST_MODE_ON, "AN:20\r\n", "ok:\r\n", "Turns on the test mode."},
+    CommandInfo{jutta_command_t::TEST_MODE_OFF, "AN:21\r\n", "ok:\r\n", "Turns off the test mode."},
+    CommandInfo{jutta_command_t::AN_40, "AN:40\r\n", "an:40\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::AN_AA, "AN:AA\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::GET_TYPE, "TY:\r\n", "ty:", "Returns the type of the machine (e.g. \"ty:EF532M V02.03\")."},
+    CommandInfo{jutta_command_t::FA_01, "FA:01\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::BUTTON_1, "FA:04\r\n", "ok:\r\n", "Simulates the button 1 press (left top)."},
+    CommandInfo{jutta_command_t::BUTTON_2, "FA:05\r\n", "ok:\r\n", "Simulates the button 2 press (left center)."},
+    CommandInfo{jutta_command_t::BUTTON_3, "FA:06\r\n", "ok:\r\n", "Simulates the button 3 press (left bottom)."},
+    CommandInfo{jutta_command_t::BUTTON_4, "FA:07\r\n", "ok:\r\n", "Simulates the button 4 press (right top)."},
+    CommandInfo{jutta_command_t::BUTTON_5, "FA:08\r\n", "ok:\r\n", "Simulates the button 5 press (right center)."},
+    CommandInfo{jutta_command_t::BUTTON_6, "FA:09\r\n", "ok:\r\n", "Simulates the button 6 press (right bottom)."},
+    CommandInfo{jutta_command_t::COFFEE_WATER_PUMP_ON, "FN:01\r\n", "ok:\r\n", "Turns on the coffee pump."},
+    CommandInfo{jutta_command_t::COFFEE_WATER_PUMP_OFF, "FN:02\r\n", "ok:\r\n", "Turns off the coffee pump."},
+    CommandInfo{jutta_command_t::COFFEE_WATER_HEATER_ON, "FN:03\r\n", "ok:\r\n", "Turns on the coffee heater."},
+    CommandInfo{jutta_command_t::COFFEE_WATER_HEATER_OFF, "FN:04\r\n", "ok:\r\n", "Turns off the coffee heater."},
+    CommandInfo{jutta_command_t::GRINDER_ON, "FN:07\r\n", "ok:\r\n", "Turns on the coffee grinder."},
+    CommandInfo{jutta_command_t::GRINDER_OFF, "FN:08\r\n", "ok:\r\n", "Turns off the coffee grinder."},
+    CommandInfo{jutta_command_t::BREW_GROUP_UNKNOWN_ON, "FN:09\r\n", "ok:\r\n", "Turns something in relation to the brew group on."},
+    CommandInfo{jutta_command_t::BREW_GROUP_UNKNOWN_OFF, "FN:0A\r\n", "ok:\r\n", "Turns something in relation to the brew group off."},
+    CommandInfo{jutta_command_t::COFFEE_PRESS_ON, "FN:0B\r\n", "ok:\r\n", "Turns on the coffee press."},
+    CommandInfo{jutta_command_t::COFFEE_PRESS_OFF, "FN:0C\r\n", "ok:\r\n", "Turns off the coffee press."},
+    CommandInfo{jutta_command_t::BREW_GROUP_RESET, "FN:0D\r\n", "ok:\r\n", "Initializes the brew group and throws out the old coffee grain."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_OPEN_POSITION, "FN:0E\r\n", "ok:\r\n", "Moves the brew group into the open position."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_GRINDING_POSITION, "FN:0F\r\n", "ok:\r\n", "Moves the brew group into the grinding position."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_POSITION_13, "FN:13\r\n", "ok:\r\n", "Moves the brew group into a currently unknown position."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_POSITION_1B, "FN:1B\r\n", "ok:\r\n", "Moves the brew group into a currently unknown position."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_THROW_OUT_POSITION, "FN:1C\r\n", "ok:\r\n", "Moves the brew group into the (probably) throw out position."},
+    CommandInfo{jutta_command_t::BREW_GROUP_TO_BREWING_POSITION, "FN:22\r\n", "ok:\r\n", "Moves the brew group into the brewing position."},
+    CommandInfo{jutta_command_t::FN_24, "FN:24\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_25, "FN:25\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_26, "FN:26\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_27, "FN:27\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_44, "FN:44\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_45, "FN:45\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_50, "FN:50\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::POWER_OFF_FN, "FN:51\r\n", "ok:\r\n", "Turns off the coffee maker."},
+    CommandInfo{jutta_command_t::FN_54, "FN:54\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_55, "FN:55\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_60, "FN:60\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_61, "FN:61\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_62, "FN:62\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_63, "FN:63\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_64, "FN:64\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_65, "FN:65\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_66, "FN:66\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_67, "FN:67\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_70, "FN:70\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_71, "FN:71\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_72, "FN:72\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_73, "FN:73\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_80, "FN:80\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_81, "FN:81\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_88, "FN:88\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::DEBUG_MODE_ON, "FN:89\r\n", "ku:", "Enables the debug mode. Sends \"ku:\", \"Ku:\", ... continuously until the coffee maker gets disconnected from power."},
+    CommandInfo{jutta_command_t::FN_90, "FN:90\r\n", "ok:\r\n", "Unknown."},
+    CommandInfo{jutta_command_t::FN_99, "FN:99\r\n", "ok:\r\n", "Unknown."}};
+
+/**
+ * The longest command including the "\r\n".
+ **/
+constexpr size_t MAX_COMMAND_SIZE = 7;
+
+/**
+ * A command encoded into wire bytes.
+ **/
+struct EncodedCommand {
+    std::array<uint8_t, MAX_COMMAND_SIZE * WIRE_QUAD_SIZE> wire{};
+    size_t size{0};
+
+    [[nodiscard]] constexpr std::span<const uint8_t> get() const { return std::span<const uint8_t>(wire).first(size); }
+};
+
+constexpr EncodedCommand encode_command(std::string_view data) {
+    EncodedCommand result{};
+    for (char c : data) {
+        const std::array<uint8_t, 4> quad = encode_table(static_cast<uint8_t>(c));
+        for (uint8_t b : quad) {
+            result.wire[result.size++] = b;
+        }
+    }
+    return result;
+}
+
+/**
+ * All commands encoded at compile time, indexed by jutta_command_t.
+ **/
+inline constexpr std::array<EncodedCommand, COMMANDS.size()> ENCODED_COMMANDS = [] {
+    std::array<EncodedCommand, COMMANDS.size()> result{};
+    for (size_t i = 0; i < COMMANDS.size(); i++) {
+        result[i] = encode_command(COMMANDS[i].data);
+    }
+    return result;
+}();
+
+static_assert([] {
+    for (size_t i = 0; i < COMMANDS.size(); i++) {
+        if (static_cast<size_t>(COMMANDS[i].command) != i || COMMANDS[i].data.size() > MAX_COMMAND_SIZE) {
+            return false;
+        }
+    }
+    return true;
+}(),
+              "COMMANDS has to be ordered like jutta_command_t and no command may exceed MAX_COMMAND_SIZE.");
+
+constexpr const CommandInfo& get_command_info(jutta_command_t command) { return COMMANDS[static_cast<size_t>(command)]; }
+
+/**
+ * Returns the command with the given data (including the "\r\n") or std::nullopt in case it is not part of the catalog.
+ **/
+constexpr std::optional<jutta_command_t> find_command(std::string_view data) {
+    for (const CommandInfo& info : COMMANDS) {
+        if (info.data == data) {
+            return info.command;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * Returns the wire bytes of the given command, ready for transmitting them without encoding at runtime.
+ **/
+constexpr std::span<const uint8_t> get_encoded_command(jutta_command_t command) { return ENCODED_COMMANDS[static_cast<size_t>(command)].get(); }
 //---------------------------------------------------------------------------
 }  // namespace jutta_proto
 //---------------------------------------------------------------------------
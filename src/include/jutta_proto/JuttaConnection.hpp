@@ -1,31 +1,151 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "CommandLock.hpp"
+#include "FixedString.hpp"
+#include "FrameRouter.hpp"
+#include "Handshake.hpp"
+#include "JuttaCommands.hpp"
+#include "KeepAliveScheduler.hpp"
+#include "LineFramer.hpp"
+#include "LinkSupervisor.hpp"
+#include "Metrics.hpp"
+#include "RttEstimator.hpp"
+#include "StreamDecoder.hpp"
+#include "TransmitPacer.hpp"
+#include "WireCapture.hpp"
 #include "serial/SerialConnection.hpp"
+#include "serial/Transport.hpp"
 
 //---------------------------------------------------------------------------
 namespace jutta_proto {
 //---------------------------------------------------------------------------
-class JuttaConnection {
+/**
+ * The JUTTA protocol on top of the given transport (e.g. serial::SerialConnection, serial::PtyConnection or serial::LoopbackConnection).
+ * The transport is a template parameter, so there is no virtual dispatch on the hot path.
+ * Instantiated for all transports of the serial library inside JuttaConnection.cpp.
+ **/
+template <serial::Transport T>
+class BasicJuttaConnection {
+ public:
+    /**
+     * Capacity of a Response. Enough for all regular responses, including "rt:" with its 64 hex characters.
+     **/
+    static constexpr size_t RESPONSE_CAPACITY = 128;
+    /**
+     * A single response (including the "\r\n") stored inline, so receiving it does not require a heap allocation.
+     **/
+    using Response = FixedString<RESPONSE_CAPACITY>;
+    /**
+     * Pass it as timeout to any of the write_*_wait_for() or write_*_with_response() methods to wait for the deadline
+     * learned from the round trip times measured for the command (see RttEstimator).
+     **/
+    static constexpr std::chrono::milliseconds ADAPTIVE_TIMEOUT{-1};
+
  private:
     /**
      * Mutex that prevents multiple threads from accessing the serial connection at the same time.
      * Usefull, when using 'wait_for_ok()' to prevent other threads from manipulating the result.
+     * Due keep-alives overtake waiting commands via lock_priority().
+     **/
+    CommandLock actionLock{};
+    T serial;
+    /**
+     * Keeps partial quads between reads and realigns the wire byte stream in case we lost or gained bytes.
+     **/
+    StreamDecoder decoder{};
+    /**
+     * Data bytes already decoded, but not yet handed out, split into "\r\n" terminated frames.
+     **/
+    LineFramer framer{};
+    /**
+     * In case no new data arrives for this time, the coffee maker finished sending.
+     * The coffee maker makes a 8ms break between each byte it sends.
+     **/
+    static constexpr std::chrono::milliseconds LINE_QUIET_TIME{50};
+    /**
+     * Releases encoded quads against absolute deadlines.
+     **/
+    TransmitPacer pacer{};
+    /**
+     * Reused buffer holding the encoded version of the message currently being send.
+     **/
+    std::vector<uint8_t> txBuffer{};
+    /**
+     * Detects broken and stalled links and schedules reconnect attempts.
+     **/
+    LinkSupervisor supervisor{};
+    /**
+     * How long to wait for the response to "TY:\r\n" after reopening the connection.
      **/
-    std::mutex actionLock{};
-    serial::SerialConnection serial;
+    static constexpr std::chrono::milliseconds RECONNECT_PROBE_TIMEOUT{1000};
+    /**
+     * Matches received lines against the outstanding command and hands all others (e.g. '&' keep alive frames) to its subscribers.
+     **/
+    FrameRouter router{};
+    /**
+     * Learns the response deadline per command from the measured round trip times.
+     **/
+    RttEstimator rtt{};
+    /**
+     * Per command counters and latency histograms, readable without taking the actionLock.
+     **/
+    MetricsRegistry metrics{};
+    /**
+     * Records all traffic in case set.
+     **/
+    std::shared_ptr<WireCapture> capture{};
+
+ public:
+    /**
+     * Fills the given (cleared) buffer with the next keep-alive frame, including the "\r\n" at the end.
+     * The buffer gets reused between keep-alives, so filling it does not allocate once it is large enough.
+     **/
+    using KeepAliveSource = std::function<void(std::vector<uint8_t>& frame)>;
+
+ private:
+    /**
+     * Protects the keep-alive scheduler and the stop flag.
+     **/
+    std::mutex keepAliveMutex{};
+    std::condition_variable keepAliveCondition{};
+    KeepAliveScheduler keepAlive{};
+    KeepAliveSource keepAliveSource{};
+    std::vector<uint8_t> keepAliveFrame{};
+    /**
+     * Copy of pacer.get_period(), so the keep-alive thread can estimate the air time of a keep-alive without the actionLock.
+     **/
+    std::atomic<std::chrono::nanoseconds> quadPeriod{pacer.get_period()};
+    bool keepAliveStop{false};
+    std::thread keepAliveThread{};
 
  public:
     /**
-     * Initializes a new Jutta (UART) connection.
+     * Initializes a new Jutta connection.
+     * All arguments get forwarded to the constructor of the transport (e.g. the device path for a serial::SerialConnection).
+     **/
+    template <typename... Args>
+    explicit BasicJuttaConnection(Args&&... args) : serial(std::forward<Args>(args)...) {}
+    BasicJuttaConnection(const BasicJuttaConnection&) = delete;
+    BasicJuttaConnection& operator=(const BasicJuttaConnection&) = delete;
+    /**
+     * Stops the keep-alive thread in case it is running.
      **/
-    explicit JuttaConnection(std::string&& device);
+    ~BasicJuttaConnection();
 
     /**
      * Tries to initializes the Jutta serial (UART) connection.
@@ -34,6 +154,34 @@ class JuttaConnection {
      **/
     void init();
 
+    /**
+     * Returns the underlying transport.
+     * Useful for e.g. accessing the peer side of a serial::PtyConnection or serial::LoopbackConnection.
+     **/
+    [[nodiscard]] T& get_transport() { return serial; }
+    /**
+     * Returns the router for subscribing to frames, that are no response to a command (e.g. '&' keep alive frames).
+     * Subscribers get invoked from the thread that received the frame while it holds the connection,
+     * so they must not call back into this connection.
+     * [Thread Safe]
+     **/
+    [[nodiscard]] FrameRouter& get_router() { return router; }
+    /**
+     * Reads everything currently available without blocking and hands all complete frames to the subscribers of the router.
+     * Use it to receive unsolicited frames while no command is being executed.
+     * Returns the number of frames dispatched.
+     * [Thread Safe]
+     **/
+    size_t dispatch_pending();
+    /**
+     * Performs the "@T1" ... "@t3" key exchange by driving the given handshake until it completed or a step missed its deadline.
+     * Blocks inside poll() while waiting, so it neither spins nor waits longer than the deadlines of the handshake.
+     * All other frames received in the meantime get dispatched by the router.
+     * Returns true in case the handshake completed. The handshake holds the timing of each phase and the exchanged key.
+     * [Thread Safe]
+     **/
+    bool perform_handshake(Handshake& handshake);
+
     /**
      * Tries to read a single decoded byte.
      * This requires reading 4 JUTTA bytes and converting them to a single actual data byte.
@@ -48,6 +196,89 @@ class JuttaConnection {
      * [Thread Safe]
      **/
     bool read_decoded(std::vector<uint8_t>& data);
+    /**
+     * Closes and reopens the connection and waits until the coffee maker responds to "TY:\r\n" again.
+     * Usually not required, since all other operations reconnect on their own,
+     * once the link went down (I/O error or too many consecutive timeouts) and the next reconnect attempt is due.
+     * Until then, they fail right away.
+     * Returns true on success.
+     * [Thread Safe]
+     **/
+    bool reconnect();
+    /**
+     * Returns false in case the link is down and waiting for the next reconnect attempt.
+     * [Thread Safe]
+     **/
+    bool is_link_up();
+    /**
+     * Returns the link statistics (timeouts, errors, reconnects, recovery time, ...).
+     * [Thread Safe]
+     **/
+    LinkSupervisor::Stats get_link_stats();
+    /**
+     * Returns the round trip time statistics (replies, slow replies, timeouts, late replies, percentile, deadline, ...) of the given command.
+     * std::nullopt returns the statistics of all data that does not match a known command.
+     * [Thread Safe]
+     **/
+    RttEstimator::CommandStats get_rtt_stats(std::optional<jutta_command_t> command);
+    /**
+     * Replaces the round trip time estimator configuration and discards all samples measured so far.
+     * [Thread Safe]
+     **/
+    void set_rtt_config(const RttEstimator::Config& config);
+    /**
+     * Returns the current metrics (wire counters, decoder realignments, per command counters and latency histograms).
+     * Lock-free, so it does not wait for a command being executed. Feed it into a PrometheusExporter for exporting it.
+     * [Thread Safe]
+     **/
+    [[nodiscard]] MetricsSnapshot get_metrics() const;
+    /**
+     * Starts recording all traffic (encoded quads and decoded bytes in both directions) into the given capture.
+     * The connection is the only producer of the capture, so do not share it with other connections.
+     * nullptr stops recording.
+     * [Thread Safe]
+     **/
+    void set_capture(std::shared_ptr<WireCapture> capture);
+    /**
+     * Starts a background thread sending the frames of the given source every config.interval.
+     * A due keep-alive goes out right after the command currently being executed, ahead of all waiting commands,
+     * as long as its air time stays within config.maxCommandDelay. It never waits for a response.
+     * Keep-alives are skipped (counted as failed) while the link is down, reconnecting is left to the commands.
+     * Replaces a running keep-alive and resets its statistics.
+     * [Thread Safe]
+     **/
+    void start_keep_alive(const KeepAliveScheduler::Config& config, KeepAliveSource&& source);
+    /**
+     * Stops the keep-alive thread and waits for it to exit.
+     * [Thread Safe]
+     **/
+    void stop_keep_alive();
+    /**
+     * Returns the keep-alive statistics including the number of missed deadlines.
+     * [Thread Safe]
+     **/
+    [[nodiscard]] KeepAliveScheduler::Stats get_keep_alive_stats();
+    /**
+     * Replaces the link supervisor configuration (stall detection and reconnect backoff) and resets its statistics.
+     * [Thread Safe]
+     **/
+    void set_link_config(const LinkSupervisor::Config& config);
+    /**
+     * Returns the statistics (decoded quads, realignments, discarded bytes, ...) of the wire stream decoder.
+     * [Thread Safe]
+     **/
+    StreamDecoder::Stats get_decoder_stats();
+    /**
+     * Sets the gap between two quads being send.
+     * The default is 8ms.
+     * [Thread Safe]
+     **/
+    void set_inter_quad_gap(const std::chrono::nanoseconds& gap);
+    /**
+     * Returns the transmit statistics including the measured pacing jitter.
+     * [Thread Safe]
+     **/
+    TransmitPacer::Stats get_pacing_stats();
     /**
      * Waits until the coffee maker responded with a "ok:\r\n".
      * The default timeout for this operation is 5 seconds.
@@ -77,6 +308,17 @@ class JuttaConnection {
      * [Thread Safe]
      **/
     bool write_decoded_wait_for(const std::string& data, const std::string& response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and then waits for the given response with an optional timeout.
+     * The response has to include the "\r\n" at the end of a message.
+     * Does not allocate on the heap.
+     * The default timeout for this operation is 5 seconds.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns true on success.
+     * Returns false when a timeout occurred or writing failed.
+     * [Thread Safe]
+     **/
+    bool write_decoded_wait_for(std::span<const uint8_t> data, std::string_view response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
 
     /**
      * Writes the given data to the coffee maker and then waits for any response with an optional timeout.
@@ -96,6 +338,51 @@ class JuttaConnection {
      * [Thread Safe]
      **/
     std::shared_ptr<std::string> write_decoded_with_response(const std::string& data, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and then waits for any response with an optional timeout.
+     * The response (including the "\r\n") gets copied into the given buffer. Does not allocate on the heap.
+     * The default timeout for this operation is 5 seconds.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns the length of the response on success.
+     * Returns std::nullopt when a timeout occurred, writing failed or the response does not fit into the given buffer.
+     * [Thread Safe]
+     **/
+    std::optional<size_t> write_decoded_with_response(std::span<const uint8_t> data, std::span<char> response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+    /**
+     * Writes the given data to the coffee maker and then waits for any response with an optional timeout.
+     * Does not allocate on the heap.
+     * The default timeout for this operation is 5 seconds.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns the response on success.
+     * Returns std::nullopt when a timeout occurred, writing failed or the response is longer than RESPONSE_CAPACITY.
+     * [Thread Safe]
+     **/
+    std::optional<Response> write_decoded_with_fixed_response(std::span<const uint8_t> data, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
+
+    /**
+     * Writes the given command, encoded at compile time, to the coffee maker.
+     * [Thread Safe]
+     **/
+    bool write_command(jutta_command_t command);
+    /**
+     * Writes the given command to the coffee maker and then waits for the response the command gets acknowledged with
+     * (e.g. "ok:\r\n", see CommandInfo::response). Does not encode or allocate at runtime.
+     * By default, the deadline gets derived from the round trip times measured for this command (see ADAPTIVE_TIMEOUT).
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns true on success.
+     * Returns false when a timeout occurred or writing failed.
+     * [Thread Safe]
+     **/
+    bool write_command_wait_for(jutta_command_t command, const std::chrono::milliseconds& timeout = ADAPTIVE_TIMEOUT);
+    /**
+     * Writes the given command to the coffee maker and then waits for any response with an optional timeout.
+     * Does not encode or allocate at runtime.
+     * By default, the deadline gets derived from the round trip times measured for this command (see ADAPTIVE_TIMEOUT).
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns std::nullopt when a timeout occurred, writing failed or the response is longer than RESPONSE_CAPACITY.
+     * [Thread Safe]
+     **/
+    std::optional<Response> write_command_with_response(jutta_command_t command, const std::chrono::milliseconds& timeout = ADAPTIVE_TIMEOUT);
 
     /**
      * Encodes the given byte into 4 JUTTA bytes and writes them to the coffee maker.
@@ -139,10 +426,12 @@ class JuttaConnection {
 
     /**
      * Runs the encode and decode test.
-     * Ensures encoding and decoding is reversable.
+     * Ensures encoding and decoding is reversable and exhaustively checks,
+     * that the reference, table based and SIMD implementation produce the same results.
      * Should be run at least once per session to ensure proper functionality.
+     * Returns true in case all implementations agree.
      **/
-    static void run_encode_decode_test();
+    [[nodiscard]] static bool run_encode_decode_test();
 
     /**
      * Converts the given binary vector to a string and returns it.
@@ -152,36 +441,74 @@ class JuttaConnection {
  private:
     /**
      * Encodes the given byte into four bytes that the coffee maker understands.
-     * Based on: http://protocoljura.wiki-site.com/index.php/Protocol_to_coffeemaker
-     *
-     * A full documentation of the process can be found here:
-     * https://github.com/Jutta-Proto/protocol-cpp#deobfuscating
+     * Uses the ENCODE_TABLE from JuttaCodec.hpp.
      **/
     static std::array<uint8_t, 4> encode(const uint8_t& decData);
     /**
      * Decodes the given four bytes read from the coffee maker into on byte.
-     * Based on: http://protocoljura.wiki-site.com/index.php/Protocol_to_coffeemaker
-     *
-     * A full documentation of the process can be found here:
-     * https://github.com/Jutta-Proto/protocol-cpp#deobfuscating
+     * Uses the DECODE_TABLE from JuttaCodec.hpp.
      **/
     static uint8_t decode(const std::array<uint8_t, 4>& encData);
     /**
-     * Writes four bytes of encoded data to the coffee maker and then waits 8ms.
+     * Returns true in case the link is usable.
+     * In case the link is down, tries to reconnect if the next attempt is due and returns false otherwise (fast failure).
+     * Not thread safe!
      **/
-    [[nodiscard]] bool write_encoded_unsafe(const std::array<uint8_t, 4>& encData) const;
+    [[nodiscard]] bool ensure_link_unsafe();
     /**
-     * Reads four bytes of encoded data which represent one byte of actual data.
-     * Returns true on success.
+     * Same as ensure_link_unsafe(), but additionally drains all complete frames received so far before a command gets send.
+     * Responses among them arrived too late for the previous command. Otherwise the next command would take them as its own.
+     * Not thread safe!
+     **/
+    [[nodiscard]] bool begin_command_unsafe();
+    /**
+     * Reopens the connection and replays "TY:\r\n".
+     * Returns true in case the coffee maker responded.
+     * Not thread safe!
+     **/
+    [[nodiscard]] bool reconnect_unsafe();
+    /**
+     * Reports I/O errors, that occurred during the last operation, to the link supervisor.
+     * Not thread safe!
+     **/
+    void check_link_unsafe();
+    /**
+     * Reports the outcome of the last operation that waited for a response to the link supervisor.
+     * Too many consecutive timeouts move the connection into SC_ERROR.
      * Not thread safe!
      **/
-    [[nodiscard]] bool read_encoded_unsafe(std::array<uint8_t, 4>& buffer) const;
+    void on_response_unsafe(bool received);
     /**
-     * Reads multiples of four bytes. Every four bytes represent one actual byte.
-     * Returns the number of 4 byte tuples read.
+     * Writes the given command, encoded at compile time, to the coffee maker.
      * Not thread safe!
      **/
-    [[nodiscard]] size_t read_encoded_unsafe(std::vector<std::array<uint8_t, 4>>& data) const;
+    [[nodiscard]] bool write_command_unsafe(jutta_command_t command);
+    /**
+     * Writes the given encoded data quad by quad to the coffee maker.
+     * Quads get released against absolute deadlines with the configured gap (8ms by default) in between.
+     * Not thread safe!
+     **/
+    [[nodiscard]] bool write_encoded_unsafe(std::span<const uint8_t> wire);
+    /**
+     * Reads all encoded data that is currently available without blocking and decodes it into the framer.
+     * Usually this requires a single read syscall.
+     * Returns the number of encoded bytes read.
+     * Not thread safe!
+     **/
+    size_t read_available_unsafe();
+    /**
+     * Drives the given handshake until it completed, failed or the link went down.
+     * Not thread safe!
+     **/
+    [[nodiscard]] bool perform_handshake_unsafe(Handshake& handshake);
+    /**
+     * Blocks until a complete "\r\n" terminated line is available or the timeout occurred.
+     * Wakes up as soon as new data arrives instead of polling.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns a view of the line (including the "\r\n"), valid until the next read, or std::nullopt in case a timeout occurred.
+     * Not thread safe!
+     **/
+    [[nodiscard]] std::optional<std::string_view> wait_for_line_unsafe(const std::chrono::milliseconds& timeout);
     /**
      * Tries to read a single decoded byte.
      * This requires reading 4 JUTTA bytes and converting them to a single actual data byte.
@@ -189,24 +516,24 @@ class JuttaConnection {
      * Returns true on success.
      * Not thread safe!
      **/
-    [[nodiscard]] bool read_decoded_unsafe(uint8_t* byte) const;
+    [[nodiscard]] bool read_decoded_unsafe(uint8_t* byte);
     /**
      * Reads as many data bytes, as there are availabel.
      * Each data byte consists of 4 JUTTA bytes which will be decoded into a single data byte.
      * Not thread safe!
      **/
-    [[nodiscard]] bool read_decoded_unsafe(std::vector<uint8_t>& data) const;
+    [[nodiscard]] bool read_decoded_unsafe(std::vector<uint8_t>& data);
 
     /**
      * Encodes the given byte into 4 JUTTA bytes and writes them to the coffee maker.
      * Not thread safe!
      **/
-    [[nodiscard]] bool write_decoded_unsafe(const uint8_t& byte) const;
+    [[nodiscard]] bool write_decoded_unsafe(const uint8_t& byte);
     /**
      * Encodes each byte of the given bytes into 4 JUTTA bytes and writes them to the coffee maker.
      * Not thread safe!
      **/
-    [[nodiscard]] bool write_decoded_unsafe(const std::vector<uint8_t>& data) const;
+    [[nodiscard]] bool write_decoded_unsafe(const std::vector<uint8_t>& data);
     /**
      * Encodes each character into 4 JUTTA bytes and writes them to the coffee maker.
      *
@@ -214,8 +541,21 @@ class JuttaConnection {
      * This would request the device type from the coffee maker.
      * Not thread safe!
      **/
-    [[nodiscard]] bool write_decoded_unsafe(const std::string& data) const;
+    [[nodiscard]] bool write_decoded_unsafe(const std::string& data);
+    /**
+     * Encodes all given bytes in one pass into JUTTA bytes and writes them to the coffee maker.
+     * Not thread safe!
+     **/
+    [[nodiscard]] bool write_decoded_unsafe(std::span<const uint8_t> data);
 
+    /**
+     * Waits until a complete line matching the given expected response (any response in case it is empty) got received.
+     * All lines received in the meantime get dispatched by the router.
+     * To disable the timeout, set the timeout to 0 seconds.
+     * Returns a view of the reply (including the "\r\n"), valid until the next read, or std::nullopt in case a timeout occurred.
+     * Not thread safe!
+     **/
+    [[nodiscard]] std::optional<std::string_view> wait_for_reply_unsafe(std::string_view expected, const std::chrono::milliseconds& timeout);
     /**
      * Waits until the coffee maker responded with the given response.
      * The response has to include the "\r\n" at the end of a message.
@@ -225,17 +565,28 @@ class JuttaConnection {
      * Returns false when a timeout occurred.
      * Not thread safe!
      **/
-    [[nodiscard]] bool wait_for_response_unsafe(const std::string& response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000}) const;
-
+    [[nodiscard]] bool wait_for_response_unsafe(std::string_view response, const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000});
     /**
-     * Waits for any response with an optional timeout.
-     * The default timeout for this operation is 5 seconds.
-     * To disable the timeout, set the timeout to 0 seconds.
-     * Returns the string on success.
+     * Same as wait_for_reply_unsafe(), but feeds the round trip time (or the timeout) into the estimator for the given command.
+     * Has to be called right after the command has been written.
+     * ADAPTIVE_TIMEOUT waits for the deadline learned for the command.
      * Not thread safe!
      **/
-    [[nodiscard]] std::shared_ptr<std::string> wait_for_str_unsafe(const std::chrono::milliseconds& timeout = std::chrono::milliseconds{5000}) const;
+    [[nodiscard]] std::optional<std::string_view> await_reply_unsafe(std::optional<jutta_command_t> command, std::string_view expected, const std::chrono::milliseconds& timeout);
+    /**
+     * Returns the catalog command the given data represents or std::nullopt in case it is none.
+     **/
+    [[nodiscard]] static std::optional<jutta_command_t> command_of(std::span<const uint8_t> data);
+    /**
+     * Body of the keep-alive thread. Sends keep-alives until stop_keep_alive() gets called.
+     **/
+    void keep_alive_loop();
 };
+
+/**
+ * The JUTTA protocol on top of a real serial (UART) connection.
+ **/
+using JuttaConnection = BasicJuttaConnection<serial::SerialConnection>;
 //---------------------------------------------------------------------------
 }  // namespace jutta_proto
 //---------------------------------------------------------------------------
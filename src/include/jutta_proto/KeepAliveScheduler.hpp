@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Decides when the next periodic keep-alive frame is due and keeps track of how punctual they went out.
+ * Pure bookkeeping without any I/O, like the LinkSupervisor.
+ *
+ * A keep-alive never interrupts a command. Once due, it goes out right after the command currently being executed,
+ * ahead of all commands waiting for it, as long as its air time stays within maxCommandDelay.
+ * Longer keep-alives wait until they get the connection without overtaking anyone.
+ * Keep-alives going out later than maxLateness after their due time count as missed.
+ * Not thread safe!
+ **/
+class KeepAliveScheduler {
+ public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Config {
+        /**
+         * Time between two keep-alive frames.
+         **/
+        std::chrono::milliseconds interval{5000};
+        /**
+         * Keep-alives going out later than this after they were due count as missed.
+         **/
+        std::chrono::milliseconds maxLateness{1000};
+        /**
+         * The maximum time a keep-alive may delay commands waiting for the connection (its air time).
+         **/
+        std::chrono::milliseconds maxCommandDelay{300};
+    };
+
+    struct Stats {
+        size_t sent{0};
+        /**
+         * Number of keep-alives that went out later than maxLateness after they were due.
+         **/
+        size_t missed{0};
+        /**
+         * Number of keep-alives that could not be send since writing failed or the link was down.
+         **/
+        size_t failed{0};
+        /**
+         * Number of keep-alives that did not overtake waiting commands since their air time exceeds maxCommandDelay.
+         **/
+        size_t yielded{0};
+        std::chrono::microseconds lastLateness{0};
+        std::chrono::microseconds maxLateness{0};
+        /**
+         * Time it took to transmit the last keep-alive. The maximum delay it caused for commands.
+         **/
+        std::chrono::microseconds lastAirTime{0};
+    };
+
+ private:
+    Config config;
+    Stats stats{};
+    TimePoint nextDue{TimePoint::max()};
+
+ public:
+    KeepAliveScheduler();
+    explicit KeepAliveScheduler(const Config& config);
+
+    /**
+     * Schedules the first keep-alive one interval from now.
+     **/
+    void start(TimePoint now);
+    [[nodiscard]] TimePoint get_next_due() const;
+    [[nodiscard]] bool is_due(TimePoint now) const;
+    /**
+     * Returns true in case the due keep-alive with the given (estimated) air time may go out ahead of waiting commands.
+     * Counts it as yielded otherwise.
+     **/
+    [[nodiscard]] bool may_overtake(std::chrono::microseconds airTime);
+    /**
+     * The due keep-alive went out at the given time and took the given time to transmit.
+     * Schedules the next one.
+     * Returns true in case it missed its deadline.
+     **/
+    bool on_sent(TimePoint sentAt, std::chrono::microseconds airTime);
+    /**
+     * The due keep-alive could not be send. Schedules the next one.
+     **/
+    void on_failed(TimePoint now);
+
+    [[nodiscard]] const Stats& get_stats() const;
+    [[nodiscard]] const Config& get_config() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Splits the decoded byte stream into "\r\n" terminated frames.
+ * Remembers how far it already scanned, so each byte gets looked at only once, no matter how often next() gets called
+ * while a (long) frame is still incomplete.
+ * Frames are handed out as views into a reusable buffer. Only the incomplete tail gets moved to the front
+ * before new data gets appended, so there is no allocation per frame.
+ * An incomplete frame exceeding the maximum frame size gets dropped, including the rest of it up to the next "\r\n".
+ * Not thread safe!
+ **/
+class LineFramer {
+ public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+ private:
+    std::vector<uint8_t> buffer{};
+    size_t maxFrameSize;
+    /**
+     * Start of the first byte not yet handed out.
+     **/
+    size_t head{0};
+    /**
+     * Everything in front of this position has already been searched for the "\n" of the terminator.
+     **/
+    size_t scanned{0};
+    /**
+     * StreamDecoder::feed() takes back up to StreamDecoder::MAX_TAKEN_BACK already appended bytes after realigning.
+     * So the last bytes in front of scanned have to be searched again.
+     **/
+    static constexpr size_t RESCAN_SIZE = 2;
+    /**
+     * True while the rest of a dropped frame has not been received completely.
+     **/
+    bool discarding{false};
+    /**
+     * Number of frames dropped for exceeding maxFrameSize. Does not get reset by clear().
+     **/
+    uint64_t droppedFrames{0};
+
+ public:
+    explicit LineFramer(size_t capacity = DEFAULT_CAPACITY, size_t maxFrameSize = DEFAULT_CAPACITY);
+
+    /**
+     * Returns the buffer new decoded bytes should be appended to (e.g. by StreamDecoder::feed()).
+     * Drops the incomplete frame in case next() already scanned it and it exceeds the maximum frame size.
+     * Invalidates all views handed out before.
+     **/
+    [[nodiscard]] std::vector<uint8_t>& input();
+    /**
+     * Returns the next complete frame (including the "\r\n") and removes it from the framer.
+     * The view stays valid until the next call to input() or clear().
+     * Returns std::nullopt in case there is no complete frame yet.
+     **/
+    [[nodiscard]] std::optional<std::string_view> next();
+    /**
+     * Returns all bytes not handed out yet, including an incomplete frame.
+     **/
+    [[nodiscard]] std::span<const uint8_t> pending() const;
+    /**
+     * Removes the first count pending bytes.
+     **/
+    void consume(size_t count);
+    /**
+     * Removes all pending bytes.
+     **/
+    void clear();
+    [[nodiscard]] bool empty() const;
+    /**
+     * Returns the number of frames dropped for exceeding the maximum frame size.
+     **/
+    [[nodiscard]] uint64_t get_dropped_frames() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Decides when a link to a coffee maker is considered down and when to try reconnecting.
+ * Pure bookkeeping without any I/O, so it can be shared by the blocking JuttaConnection and the EventLoop.
+ *
+ * A link goes down on the first I/O error or after a number of consecutive command timeouts (stall).
+ * The first reconnect attempt happens right away, every failed attempt doubles the delay until the next one up to a maximum.
+ * Not thread safe!
+ **/
+class LinkSupervisor {
+ public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Config {
+        /**
+         * Number of consecutive commands without response until the link is considered stalled.
+         **/
+        size_t maxConsecutiveTimeouts{3};
+        std::chrono::milliseconds initialBackoff{50};
+        std::chrono::milliseconds maxBackoff{5000};
+    };
+
+    struct Stats {
+        size_t timeouts{0};
+        size_t errors{0};
+        /**
+         * How often the link went down.
+         **/
+        size_t linkDowns{0};
+        size_t reconnectAttempts{0};
+        size_t reconnects{0};
+        /**
+         * Time from the link going down until it was usable again for the last successful reconnect.
+         **/
+        std::chrono::milliseconds lastRecoveryTime{0};
+    };
+
+ private:
+    Config config;
+    Stats stats{};
+    size_t consecutiveTimeouts{0};
+    /**
+     * True in case an I/O error got reported since the link went down last time. Used for logging the cause.
+     **/
+    bool errorPending{false};
+    bool down{false};
+    TimePoint downSince{};
+    TimePoint nextAttempt{};
+    std::chrono::milliseconds backoff{0};
+
+ public:
+    LinkSupervisor();
+    explicit LinkSupervisor(const Config& config);
+
+    /**
+     * A command got its response.
+     **/
+    void on_success();
+    /**
+     * A command did not get a response in time.
+     * Returns true in case this stalled the link. Call link_down() in this case.
+     **/
+    [[nodiscard]] bool on_timeout();
+    /**
+     * An I/O error occurred. Call link_down() afterwards.
+     **/
+    void on_error();
+
+    /**
+     * Marks the link as down. The first reconnect attempt is due right away.
+     * Logs the cause (I/O error, stall or neither, e.g. a requested reconnect).
+     * Does nothing in case the link is already down.
+     **/
+    void link_down(TimePoint now);
+    [[nodiscard]] bool is_down() const;
+    /**
+     * Returns true in case the link is down and the next reconnect attempt is due.
+     **/
+    [[nodiscard]] bool attempt_due(TimePoint now) const;
+    /**
+     * The point in time the next reconnect attempt is due.
+     **/
+    [[nodiscard]] TimePoint get_next_attempt() const;
+    /**
+     * Schedules the next reconnect attempt with exponential backoff.
+     **/
+    void on_reconnect_failed(TimePoint now);
+    /**
+     * The link is up again.
+     **/
+    void on_reconnected(TimePoint now);
+
+    [[nodiscard]] const Stats& get_stats() const;
+    [[nodiscard]] const Config& get_config() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "JuttaCommands.hpp"
+#include "StreamDecoder.hpp"
+#include "serial/WireCounters.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Latency histogram with logarithmic buckets: bucket i counts latencies up to 2^i µs, the last one everything above.
+ * This covers 1µs up to 8.4s with a relative error of at most a factor of two per bucket.
+ * Recording and reading are lock-free.
+ * [Thread Safe]
+ **/
+class LatencyHistogram {
+ public:
+    /**
+     * 24 bounded buckets (1µs ... 2^23µs) plus the overflow bucket.
+     **/
+    static constexpr size_t BUCKET_COUNT = 25;
+
+    struct Snapshot {
+        /**
+         * Number of latencies per bucket (not cumulative).
+         **/
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        uint64_t count{0};
+        std::chrono::microseconds sum{0};
+    };
+
+ private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumUs{0};
+
+ public:
+    void record(std::chrono::microseconds latency);
+    /**
+     * Each value gets read atomically, but not all of them at the same point in time.
+     **/
+    [[nodiscard]] Snapshot get_snapshot() const;
+
+    /**
+     * Returns the inclusive upper bound of the given bucket or std::nullopt for the overflow bucket.
+     **/
+    [[nodiscard]] static std::optional<std::chrono::microseconds> upper_bound(size_t bucket);
+    [[nodiscard]] static size_t bucket_of(std::chrono::microseconds latency);
+};
+
+/**
+ * The metrics of a single connection at one point in time.
+ **/
+struct MetricsSnapshot {
+    struct Command {
+        /**
+         * std::nullopt for all data that does not match a command of the catalog.
+         **/
+        std::optional<jutta_command_t> command{};
+        /**
+         * Number of times the command got send.
+         **/
+        uint64_t sent{0};
+        /**
+         * Number of times no response arrived in time.
+         **/
+        uint64_t timeouts{0};
+        /**
+         * Time between writing the command and receiving its response.
+         **/
+        LatencyHistogram::Snapshot latency{};
+    };
+
+    serial::WireCounters::Snapshot wire{};
+    /**
+     * Number of times the decoder had to realign itself to the quad boundaries.
+     **/
+    uint64_t realignments{0};
+    /**
+     * Number of wire bytes the decoder had to throw away.
+     **/
+    uint64_t discardedBytes{0};
+    /**
+     * Number of frames the framer dropped for exceeding the maximum frame size.
+     **/
+    uint64_t droppedFrames{0};
+    /**
+     * Only commands that have been send at least once.
+     **/
+    std::vector<Command> commands{};
+};
+
+/**
+ * Collects the per command counters and latency histograms of a connection.
+ * Gets updated by the thread owning the connection, all reads are lock-free,
+ * so taking a snapshot never waits for a command being executed.
+ * [Thread Safe]
+ **/
+class MetricsRegistry {
+ private:
+    struct CommandMetrics {
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> timeouts{0};
+        LatencyHistogram latency{};
+    };
+
+    /**
+     * Indexed by jutta_command_t, the last entry is shared by all other commands.
+     **/
+    std::array<CommandMetrics, COMMANDS.size() + 1> entries{};
+    std::atomic<uint64_t> realignments{0};
+    std::atomic<uint64_t> discardedBytes{0};
+    std::atomic<uint64_t> droppedFrames{0};
+    /**
+     * The framer statistics published last. Only accessed by the thread publishing them.
+     **/
+    uint64_t lastDroppedFrames{0};
+    /**
+     * The decoder statistics published last. Only accessed by the thread publishing them.
+     **/
+    StreamDecoder::Stats lastDecoderStats{};
+
+ public:
+    void on_sent(std::optional<jutta_command_t> command);
+    void on_reply(std::optional<jutta_command_t> command, std::chrono::microseconds latency);
+    void on_timeout(std::optional<jutta_command_t> command);
+    /**
+     * Adds the growth of the decoder statistics since they got published last.
+     * The exported counters are monotonic, even though the decoder statistics start over with every reset.
+     * Only call it from a single thread at a time.
+     **/
+    void on_decoder_stats(const StreamDecoder::Stats& stats);
+    /**
+     * The decoder got reset, so its statistics start over from 0.
+     * Publish the statistics right before resetting, so nothing gets lost.
+     * Only call it from a single thread at a time.
+     **/
+    void on_decoder_reset();
+    /**
+     * Adds the growth of the number of frames dropped by the framer (LineFramer::get_dropped_frames()) since it got published last.
+     * Only call it from a single thread at a time.
+     **/
+    void on_framer_stats(uint64_t droppedFrames);
+
+    /**
+     * Returns the current metrics combined with the given wire counters of the transport.
+     **/
+    [[nodiscard]] MetricsSnapshot get_snapshot(const serial::WireCounters& wire) const;
+
+ private:
+    [[nodiscard]] static size_t index_of(std::optional<jutta_command_t> command);
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Finds serial ports a coffee maker is connected to.
+ * All candidates returned by serial::SerialConnection::get_available_ports() get probed concurrently by sending "TY:\r\n".
+ * The whole discovery is bounded by a single timeout, no matter how many ports there are.
+ *
+ * Results for stable /dev/serial/by-id paths get cached in a file (optional),
+ * so the next discovery (e.g. after a reboot) can skip probing them.
+ **/
+class PortDiscovery {
+ public:
+    struct Port {
+        /**
+         * The path to open (e.g. /dev/serial/by-id/usb-FTDI_FT232R_USB_UART_A5047JSK-if00-port0).
+         **/
+        std::string path{};
+        /**
+         * The machine type as reported in response to "TY:" (e.g. "EF532M V02.03").
+         **/
+        std::string machineType{};
+        /**
+         * The time from starting to send "TY:\r\n" until the response was received.
+         * For cached ports this is the latency measured when they got probed.
+         **/
+        std::chrono::microseconds latency{0};
+        /**
+         * True in case the port has been taken from the cache without probing.
+         **/
+        bool cached{false};
+    };
+
+    static constexpr std::chrono::milliseconds DEFAULT_TIMEOUT{1500};
+
+ private:
+    /**
+     * Path to the cache file. Empty to disable caching.
+     **/
+    std::string cachePath;
+    std::chrono::milliseconds timeout;
+
+ public:
+    explicit PortDiscovery(std::string&& cachePath = "", const std::chrono::milliseconds& timeout = DEFAULT_TIMEOUT);
+
+    /**
+     * Returns all ports a coffee maker responded on (or cached ones that still exist), ordered by latency.
+     * Blocks at most for the configured timeout.
+     **/
+    [[nodiscard]] std::vector<Port> discover() const;
+    /**
+     * Removes all cached ports, e.g. in case a cached port did not work.
+     **/
+    void clear_cache() const;
+
+    /**
+     * Opens the given port, sends "TY:\r\n" and waits until the given deadline for the response.
+     * Returns std::nullopt in case the port could not be opened or nothing responded in time.
+     **/
+    [[nodiscard]] static std::optional<Port> probe(const std::string& path, const std::chrono::steady_clock::time_point& deadline);
+
+ private:
+    [[nodiscard]] std::vector<Port> load_cache() const;
+    void store_cache(const std::vector<Port>& ports) const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Metrics.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Renders the metrics snapshots of any number of coffee makers in the Prometheus text exposition format
+ * and writes them to a file (e.g. for the node_exporter textfile collector) or a local unix socket.
+ * Each coffee maker gets identified by the "machine" label.
+ *
+ * Exported metrics:
+ * jutta_wire_bytes_total{direction}, jutta_wire_reads_total, jutta_wire_short_reads_total, jutta_wire_writes_total,
+ * jutta_wire_short_writes_total, jutta_wire_errors_total, jutta_decoder_realignments_total, jutta_decoder_discarded_bytes_total,
+ * jutta_commands_total{command}, jutta_command_timeouts_total{command} and the histogram jutta_command_latency_seconds{command}.
+ * Not thread safe!
+ **/
+class PrometheusExporter {
+ private:
+    std::vector<std::pair<std::string, MetricsSnapshot>> machines{};
+
+ public:
+    /**
+     * Adds the snapshot of the coffee maker with the given name.
+     **/
+    void add(std::string&& machine, MetricsSnapshot&& snapshot);
+    /**
+     * Removes all added snapshots, so the exporter can be reused for the next scrape.
+     **/
+    void clear();
+
+    [[nodiscard]] std::string render() const;
+    /**
+     * Renders all snapshots and atomically replaces the given file with them (written to "<path>.tmp" first and renamed),
+     * so readers never see a partially written file.
+     * Returns false in case writing failed.
+     **/
+    [[nodiscard]] bool write_file(const std::string& path) const;
+    /**
+     * Renders all snapshots and sends them to the unix stream socket listening at the given path.
+     * Returns false in case connecting or sending failed.
+     **/
+    [[nodiscard]] bool write_socket(const std::string& path) const;
+
+    /**
+     * Returns the value of the "command" label for the given command (its data without the "\r\n", e.g. "TY:").
+     * "other" for all data that does not match a command of the catalog.
+     **/
+    [[nodiscard]] static std::string_view command_label(std::optional<jutta_command_t> command);
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
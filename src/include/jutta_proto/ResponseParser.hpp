@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <variant>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * All frames the coffee maker is known to send.
+ **/
+enum class response_kind_t : uint8_t {
+    UNKNOWN,
+    /**
+     * "ok:"
+     **/
+    OK,
+    /**
+     * "ty:EF532M V02.03"
+     **/
+    TYPE,
+    /**
+     * "@t1", the response to "@T1".
+     **/
+    HANDSHAKE_START,
+    /**
+     * "@T2:010001B228", the key exchange request.
+     **/
+    KEY_EXCHANGE,
+    /**
+     * "@T3:3BDEEF532M V02.03", the end of the key exchange.
+     **/
+    HANDSHAKE_END,
+    /**
+     * "ku:..." and "Ku:..." send continuously while the debug mode is active.
+     **/
+    DEBUG,
+    /**
+     * '&' frames encrypted with the DiscCipher.
+     **/
+    ENCRYPTED,
+};
+
+struct UnknownResponse {
+    std::string_view frame;
+};
+
+struct OkResponse {};
+
+struct TypeResponse {
+    /**
+     * E.g. "EF532M".
+     **/
+    std::string_view model;
+    /**
+     * E.g. "V02.03". Empty in case the response contains no firmware version.
+     **/
+    std::string_view firmware;
+};
+
+struct HandshakeStartResponse {};
+
+struct KeyExchangeResponse {
+    static constexpr size_t MAX_KEY_SIZE = 16;
+    /**
+     * The hex encoded bytes following "@T2:" (e.g. 01 00 01 B2 28).
+     **/
+    std::array<uint8_t, MAX_KEY_SIZE> key{};
+    size_t keySize{0};
+};
+
+struct HandshakeEndResponse {
+    /**
+     * The two hex encoded bytes following "@T3:" (e.g. 3B DE). Their meaning is unknown.
+     **/
+    std::array<uint8_t, 2> token{};
+    TypeResponse type{};
+};
+
+struct DebugResponse {
+    /**
+     * True for "Ku:" and false for "ku:".
+     **/
+    bool upper{false};
+    std::string_view payload;
+};
+
+struct EncryptedResponse {
+    /**
+     * The complete frame, including the '&' and the key. Decrypt it with DiscCipher::decrypt_frame().
+     **/
+    std::string_view frame;
+};
+
+/**
+ * A parsed frame. All views point into the frame passed to parse_response().
+ **/
+using ParsedResponse = std::variant<UnknownResponse, OkResponse, TypeResponse, HandshakeStartResponse, KeyExchangeResponse, HandshakeEndResponse, DebugResponse, EncryptedResponse>;
+
+/**
+ * Classifies the given frame by its prefix.
+ * The three character prefixes are looked up in a table indexed by a perfect hash, that gets computed at compile time.
+ * So this is O(1), independent of the number of known prefixes, and allocation free.
+ * A trailing "\r\n" is allowed.
+ **/
+response_kind_t classify_response(std::string_view frame);
+/**
+ * Classifies the given frame and parses its fields.
+ * Malformed frames (e.g. "@T2:" with invalid hex characters) result in an UnknownResponse.
+ * Allocation free, all views point into the given frame.
+ **/
+ParsedResponse parse_response(std::string_view frame);
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
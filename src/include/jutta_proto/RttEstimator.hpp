@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "JuttaCommands.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Learns the round trip time (end of transmitting a command until its response arrived) of each command
+ * and derives response deadlines from it.
+ * The deadline is a percentile of the recent round trip times times a safety factor, clamped to a floor and a ceiling.
+ * Until enough samples have been collected, the ceiling gets used.
+ * A timeout records the time waited as sample, since the round trip time was at least that long.
+ * So in case the round trip time grows past the deadline, repeated timeouts raise the deadline until it covers it again.
+ *
+ * All commands of the catalog have their own statistics. Everything else shares one entry.
+ * Pure bookkeeping without any I/O and allocations.
+ * Not thread safe!
+ **/
+class RttEstimator {
+ public:
+    struct Config {
+        /**
+         * Deadlines never get shorter than this. Covers the quiet time between two bytes the coffee maker sends.
+         **/
+        std::chrono::milliseconds floor{250};
+        /**
+         * Deadlines never get longer than this. Used as long as there are not enough samples.
+         **/
+        std::chrono::milliseconds ceiling{5000};
+        /**
+         * The percentile of the recent round trip times, the deadline gets derived from.
+         **/
+        double percentile{0.95};
+        /**
+         * Safety factor applied to the percentile.
+         **/
+        double multiplier{2.0};
+        /**
+         * Number of samples required before deriving deadlines.
+         **/
+        size_t minSamples{8};
+    };
+
+    struct CommandStats {
+        /**
+         * Number of responses received in time.
+         **/
+        size_t replies{0};
+        /**
+         * Number of responses that arrived in time, but slower than the learned percentile.
+         **/
+        size_t slowReplies{0};
+        /**
+         * Number of times no response arrived before the deadline.
+         **/
+        size_t timeouts{0};
+        /**
+         * Number of responses that arrived after the deadline, but before the next command got send.
+         **/
+        size_t lateReplies{0};
+        std::chrono::microseconds lastRtt{0};
+        std::chrono::microseconds minRtt{0};
+        std::chrono::microseconds maxRtt{0};
+        /**
+         * The configured percentile of the recent round trip times. 0 in case there are not enough samples.
+         **/
+        std::chrono::microseconds percentileRtt{0};
+        /**
+         * The deadline currently used for the command.
+         **/
+        std::chrono::milliseconds deadline{0};
+    };
+
+    /**
+     * Number of recent round trip times kept per command.
+     **/
+    static constexpr size_t WINDOW_SIZE = 32;
+
+ private:
+    struct Entry {
+        /**
+         * Ring of the most recent round trip times in µs.
+         **/
+        std::array<uint32_t, WINDOW_SIZE> window{};
+        size_t samples{0};
+        CommandStats stats{};
+    };
+
+    Config config;
+    /**
+     * Indexed by jutta_command_t, the last entry is shared by all other commands.
+     **/
+    std::array<Entry, COMMANDS.size() + 1> entries{};
+    /**
+     * The entry of the last command that timed out, as long as no other command got send since then.
+     **/
+    std::optional<size_t> lastTimeout{std::nullopt};
+
+ public:
+    RttEstimator();
+    explicit RttEstimator(const Config& config);
+
+    /**
+     * Returns the deadline for the given command (std::nullopt for commands not part of the catalog).
+     **/
+    [[nodiscard]] std::chrono::milliseconds get_deadline(std::optional<jutta_command_t> command) const;
+    /**
+     * Records the round trip time of a response received in time.
+     * Returns true in case it was slower than the learned percentile.
+     **/
+    bool on_reply(std::optional<jutta_command_t> command, std::chrono::microseconds rtt);
+    /**
+     * Records that no response arrived within the given time.
+     **/
+    void on_timeout(std::optional<jutta_command_t> command, std::chrono::microseconds waited);
+    /**
+     * Records a response that arrived after the last command timed out, but before the next one got send.
+     * Returns false in case there is no timed out command it belongs to.
+     **/
+    bool on_late_reply();
+    /**
+     * A new command got send, so remaining responses can not be attributed to the last timed out command any more.
+     **/
+    void on_sent();
+
+    [[nodiscard]] CommandStats get_stats(std::optional<jutta_command_t> command) const;
+    [[nodiscard]] const Config& get_config() const;
+
+ private:
+    [[nodiscard]] static size_t index_of(std::optional<jutta_command_t> command);
+    /**
+     * Returns the configured percentile of the recent round trip times or std::nullopt in case there are not enough samples.
+     **/
+    [[nodiscard]] std::optional<std::chrono::microseconds> percentile_of(const Entry& entry) const;
+    static void add_sample(Entry& entry, std::chrono::microseconds rtt);
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "JuttaCodec.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Incremental decoder for the encoded (wire) byte stream received from the coffee maker.
+ * Consumes arbitrary sized chunks of wire bytes and keeps partial quads between calls.
+ *
+ * All wire bytes share the same base bit layout (WIRE_BASE), so bytes not matching it are detected as line noise.
+ * The position inside a quad can not be derived from a single byte, but every message ends with "\r\n".
+ * In case the encoded "\r\n" shows up in the stream without ending on a quad boundary, we lost (or gained) bytes
+ * and realign to the terminator. This way a dropped byte only garbles the message it occurred in and not every following one.
+ **/
+class StreamDecoder {
+ public:
+    /**
+     * The maximum number of decoded bytes feed() removes from the end of out after realigning.
+     **/
+    static constexpr size_t MAX_TAKEN_BACK = 2;
+
+    struct Stats {
+        /**
+         * Number of successfully decoded quads (data bytes).
+         **/
+        size_t quads{0};
+        /**
+         * Number of times the decoder had to realign itself to the quad boundaries.
+         **/
+        size_t realignments{0};
+        /**
+         * Number of wire bytes that got thrown away (partial or corrupted quads).
+         **/
+        size_t discardedBytes{0};
+        /**
+         * Number of wire bytes not matching the WIRE_BASE bit layout.
+         **/
+        size_t invalidBytes{0};
+    };
+
+ private:
+    /**
+     * "\r\n" encoded into eight wire bytes and packed into an integer (first byte in the most significant byte).
+     **/
+    static constexpr uint64_t TERMINATOR_WIRE = [] {
+        uint64_t result = 0;
+        for (uint8_t c : {static_cast<uint8_t>('\r'), static_cast<uint8_t>('\n')}) {
+            for (uint8_t b : encode_scalar(c)) {
+                result = (result << 8) | b;
+            }
+        }
+        return result;
+    }();
+    static constexpr size_t TERMINATOR_WIRE_SIZE = 2 * WIRE_QUAD_SIZE;
+
+    std::array<uint8_t, 4> quad{};
+    size_t quadLen{0};
+    /**
+     * False in case the current (partial) quad contains a byte not matching the WIRE_BASE bit layout.
+     **/
+    bool quadValid{true};
+    /**
+     * The last (up to) eight valid wire bytes used for detecting the encoded terminator.
+     **/
+    uint64_t window{0};
+    size_t windowLen{0};
+    /**
+     * One bit per completed quad (last quad in the least significant bit), set in case it got decoded into a data byte.
+     * Used for taking back the garbage bytes decoded from a misaligned terminator.
+     **/
+    uint8_t emitted{0};
+
+    Stats stats{};
+
+ public:
+    /**
+     * Feeds the given chunk of wire bytes into the decoder.
+     * All decoded data bytes get appended to out.
+     * In case of a misaligned terminator, the (up to MAX_TAKEN_BACK) garbage bytes decoded from it get removed from the end of out again.
+     * Since the terminator can be split across two calls, out has to be either empty or still end with the bytes appended
+     * by the previous call (e.g. LineFramer::input()). In case it is empty, garbage from the previous call stays part of the message.
+     * Returns the number of data bytes appended.
+     **/
+    size_t feed(std::span<const uint8_t> wire, std::vector<uint8_t>& out);
+    /**
+     * Should be called once the line went quiet.
+     * Since the coffee maker only pauses between messages, a partial quad at this point means we are out of sync.
+     * Discards the partial quad and starts over aligned.
+     **/
+    void on_idle();
+    /**
+     * Resets the decoder state and its statistics.
+     **/
+    void reset();
+
+    /**
+     * Returns the number of wire bytes buffered in the current partial quad.
+     **/
+    [[nodiscard]] size_t buffered() const;
+    [[nodiscard]] const Stats& get_stats() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
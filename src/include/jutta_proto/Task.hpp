@@ -0,0 +1,135 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+template <typename T>
+class Task;
+
+namespace detail {
+struct TaskPromiseBase {
+    /**
+     * The coroutine awaiting this task. Gets resumed once the task finished.
+     **/
+    std::coroutine_handle<> continuation{};
+    std::exception_ptr exception{};
+
+    struct FinalAwaiter {
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+    [[nodiscard]] FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value{};
+
+    Task<T> get_return_object();
+    void return_value(T value) { this->value = std::move(value); }
+    T result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() const {}
+    void result() const {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+/**
+ * Fire and forget coroutine used by spawn(). Destroys itself once done.
+ **/
+struct DetachedTask {
+    struct promise_type {
+        [[nodiscard]] DetachedTask get_return_object() const { return {}; }
+        [[nodiscard]] std::suspend_never initial_suspend() const noexcept { return {}; }
+        [[nodiscard]] std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const {}
+        [[noreturn]] void unhandled_exception() const { std::terminate(); }
+    };
+};
+}  // namespace detail
+
+/**
+ * Lazily started coroutine returning a T.
+ * Starts once it gets awaited (co_await) and resumes the awaiting coroutine once done.
+ * Exceptions get rethrown at the co_await.
+ * Use spawn() for starting a top level task.
+ **/
+template <typename T = void>
+class Task {
+ public:
+    using promise_type = detail::TaskPromise<T>;
+
+ private:
+    std::coroutine_handle<promise_type> handle;
+
+ public:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    [[nodiscard]] bool await_ready() const noexcept { return !handle || handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+    T await_resume() { return handle.promise().result(); }
+};
+
+namespace detail {
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() { return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this)); }
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this)); }
+
+inline DetachedTask run_detached(Task<void> task) { co_await task; }
+}  // namespace detail
+
+/**
+ * Starts the given task right away on the calling thread. It runs until its first suspension point.
+ * The task owns itself afterwards and gets destroyed once done.
+ * An exception escaping the task terminates the program, just like for a std::thread.
+ **/
+inline void spawn(Task<void>&& task) { static_cast<void>(detail::run_detached(std::move(task))); }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
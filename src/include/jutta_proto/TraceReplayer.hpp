@@ -0,0 +1,116 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "JuttaConnection.hpp"
+#include "WireCapture.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+enum class replay_mode_t {
+    /**
+     * Keeps the gaps between the recorded events.
+     **/
+    ORIGINAL_TIMING,
+    /**
+     * Feeds the next event as soon as the previous one got processed.
+     **/
+    AS_FAST_AS_POSSIBLE
+};
+
+/**
+ * A single chunk of recorded traffic.
+ **/
+struct TraceEvent {
+    /**
+     * Time since the first event of the trace.
+     **/
+    std::chrono::nanoseconds offset{0};
+    capture_direction_t direction{capture_direction_t::RX};
+    /**
+     * The encoded bytes as they went over the wire.
+     **/
+    std::vector<uint8_t> wire{};
+};
+
+/**
+ * Reproduces recorded traffic by feeding it into a JuttaConnection running on top of a serial::LoopbackConnection.
+ * Received data goes through the whole stack (decoding, framing and dispatching to the subscribers of the router),
+ * so subscribers see the exact same frames as during the recording.
+ * Transmitted data only gets counted, since the replayed connection does not execute any commands.
+ *
+ * Traces can be loaded from binary capture files (see WireCapture) and from the text snoops inside protocol_snoops/.
+ * Feeding the next event only after the previous one got dispatched makes the replay deterministic,
+ * independent of the replay mode.
+ **/
+class TraceReplayer {
+ public:
+    struct Stats {
+        /**
+         * Number of received events fed into the connection.
+         **/
+        size_t rxEvents{0};
+        /**
+         * Number of transmitted events skipped.
+         **/
+        size_t txEvents{0};
+        /**
+         * Number of received wire bytes fed into the connection.
+         **/
+        size_t rxBytes{0};
+        /**
+         * Number of frames dispatched by the connection.
+         **/
+        size_t frames{0};
+        /**
+         * Time the replay took.
+         **/
+        std::chrono::nanoseconds elapsed{0};
+    };
+
+ private:
+    std::vector<TraceEvent> events;
+
+ public:
+    explicit TraceReplayer(std::vector<TraceEvent>&& events);
+
+    /**
+     * Loads the given binary capture file (see WireCapture).
+     * Uses the wire records. Captures only containing decoded records (e.g. converted ones) get encoded again.
+     * Throws a exception in case the file can not be read.
+     **/
+    [[nodiscard]] static TraceReplayer from_capture(const std::string& path);
+    /**
+     * Imports the given text snoop. Supported are the bit dumps ("0 1 0 1 0 1 0 0 -> 84 54 T") separated by
+     * "Dongle:" (send) and "Coffee-Maker:" (received) headers, the received frames of snoop_keep_alive.txt ("22B 00100110 ...")
+     * and transcripts like keyexchange.md ("[D]: TY:\r\n" send, "[C]: ty:...\r\n" received).
+     * Snoops have no timestamps, so the original timing gets derived from the default quad pacing.
+     * Throws a exception in case the file can not be read or contains no traffic.
+     **/
+    [[nodiscard]] static TraceReplayer from_snoop(const std::string& path);
+    /**
+     * Loads the given file as binary capture in case it starts with WireCapture::FILE_MAGIC, else as text snoop.
+     **/
+    [[nodiscard]] static TraceReplayer load(const std::string& path);
+
+    /**
+     * Feeds all received events into the given (initialized) connection.
+     * Blocks until the whole trace got replayed.
+     **/
+    Stats replay(BasicJuttaConnection<serial::LoopbackConnection>& connection, replay_mode_t mode) const;
+
+    [[nodiscard]] const std::vector<TraceEvent>& get_events() const;
+    /**
+     * Returns the offset of the last event.
+     **/
+    [[nodiscard]] std::chrono::nanoseconds get_duration() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
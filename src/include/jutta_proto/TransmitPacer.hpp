@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "JuttaCodec.hpp"
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+/**
+ * Emits encoded quads against absolute deadlines.
+ * Quad i of a message gets released at start + i * (quad air time + inter quad gap).
+ * Since all deadlines are absolute (CLOCK_MONOTONIC and clock_nanosleep with TIMER_ABSTIME),
+ * delays caused by the write syscall or the scheduler do not accumulate over the message.
+ **/
+class TransmitPacer {
+ public:
+    struct Stats {
+        size_t messages{0};
+        size_t quads{0};
+        /**
+         * How late quads got released compared to their deadline.
+         **/
+        std::chrono::nanoseconds maxJitter{0};
+        std::chrono::nanoseconds totalJitter{0};
+        /**
+         * Duration from releasing the first until releasing the last quad of the last message.
+         **/
+        std::chrono::nanoseconds lastMessageDuration{0};
+
+        [[nodiscard]] std::chrono::nanoseconds mean_jitter() const { return quads > 0 ? totalJitter / static_cast<int64_t>(quads) : std::chrono::nanoseconds{0}; }
+    };
+
+    static constexpr std::chrono::milliseconds DEFAULT_INTER_QUAD_GAP{8};
+    static constexpr uint32_t DEFAULT_BAUD_RATE = 9600;
+
+ private:
+    std::chrono::nanoseconds interQuadGap{DEFAULT_INTER_QUAD_GAP};
+    /**
+     * The time it takes to shift out one quad (4 * (1 start + 8 data + 1 stop bit)) at the configured baud rate.
+     **/
+    std::chrono::nanoseconds quadAirTime{};
+    /**
+     * The earliest point in time the next quad may be released.
+     * Ensures back to back messages keep the gap as well.
+     **/
+    std::chrono::steady_clock::time_point nextRelease{};
+    Stats stats{};
+
+ public:
+    explicit TransmitPacer(std::chrono::nanoseconds interQuadGap = DEFAULT_INTER_QUAD_GAP, uint32_t baudRate = DEFAULT_BAUD_RATE);
+
+    /**
+     * Releases the given encoded (wire) bytes quad by quad to the given write function.
+     * write gets called with a std::span<const uint8_t> of four bytes and has to return true on success.
+     * Continues in case writing a quad fails, but returns false in this case.
+     **/
+    template <typename WriteFn>
+    bool transmit(std::span<const uint8_t> wire, WriteFn&& write) {
+        bool result = true;
+        const std::chrono::steady_clock::time_point start = begin_message();
+        std::chrono::steady_clock::time_point deadline = start;
+        for (size_t i = 0; i + WIRE_QUAD_SIZE <= wire.size(); i += WIRE_QUAD_SIZE) {
+            sleep_until(deadline);
+            deadline = release_quad(deadline);
+            if (!write(wire.subspan(i, WIRE_QUAD_SIZE))) {
+                result = false;
+            }
+        }
+        end_message(start, deadline);
+        return result;
+    }
+
+    /**
+     * Non blocking interface for event loops, transmit() is built on top of it:
+     * 1. begin_message() returns the deadline of the first quad.
+     * 2. Once the deadline is reached, call release_quad(deadline) to get the deadline of the next quad and write the quad.
+     * 3. Once all quads are written, call end_message() with the start and the last returned deadline.
+     **/
+    [[nodiscard]] std::chrono::steady_clock::time_point begin_message() const;
+    [[nodiscard]] std::chrono::steady_clock::time_point release_quad(std::chrono::steady_clock::time_point deadline);
+    void end_message(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point nextDeadline);
+    /**
+     * The time between releasing two quads (quad air time + inter quad gap).
+     **/
+    [[nodiscard]] std::chrono::nanoseconds get_period() const;
+
+    void set_inter_quad_gap(std::chrono::nanoseconds gap);
+    [[nodiscard]] std::chrono::nanoseconds get_inter_quad_gap() const;
+    void set_baud_rate(uint32_t baudRate);
+
+    [[nodiscard]] const Stats& get_stats() const;
+    void reset_stats();
+
+    /**
+     * Sleeps until the given absolute point in time by using clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME).
+     * Continues sleeping when getting interrupted by a signal.
+     **/
+    static void sleep_until(std::chrono::steady_clock::time_point deadline);
+
+ private:
+    /**
+     * Updates the jitter statistics for a quad released now that was due at the given deadline.
+     **/
+    void record_release(std::chrono::steady_clock::time_point deadline);
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+enum class capture_direction_t : uint8_t {
+    /**
+     * Received from the coffee maker.
+     **/
+    RX = 0,
+    /**
+     * Send to the coffee maker.
+     **/
+    TX = 1
+};
+
+enum class capture_layer_t : uint8_t {
+    /**
+     * Raw encoded quads as they went over the wire.
+     **/
+    WIRE = 0,
+    /**
+     * Decoded data bytes.
+     **/
+    DECODED = 1
+};
+
+/**
+ * A single captured chunk of data. Longer data gets split up into multiple records sharing the same timestamp.
+ **/
+struct CaptureRecord {
+    static constexpr size_t PAYLOAD_SIZE = 20;
+
+    /**
+     * Monotonic (std::chrono::steady_clock) timestamp in nanoseconds.
+     **/
+    uint64_t timestamp{0};
+    capture_direction_t direction{capture_direction_t::RX};
+    capture_layer_t layer{capture_layer_t::WIRE};
+    uint8_t size{0};
+    std::array<uint8_t, PAYLOAD_SIZE> data{};
+
+    [[nodiscard]] std::span<const uint8_t> payload() const { return std::span<const uint8_t>(data).first(size); }
+};
+static_assert(sizeof(CaptureRecord) == 32);
+
+/**
+ * Records the traffic of a connection (encoded quads and decoded bytes, both directions) with monotonic nanosecond timestamps.
+ * Meant to be left enabled in production, so a trace can be pulled once a coffee maker misbehaves.
+ *
+ * Records get written into a fixed size single producer, single consumer lock-free ring buffer.
+ * The producer is the connection it is attached to, recording never blocks or allocates.
+ * In case the ring is full, new records get dropped (and counted) instead of waiting for the consumer.
+ * The consumer drains the ring into a binary capture file via flush(), e.g. periodically from a background thread.
+ *
+ * File format (all integers little endian):
+ * Header: "JUTTACAP" (8 bytes), version (uint32), reserved (uint32)
+ * Records: timestamp in ns (uint64), flags (uint8, bit 0: TX, bit 1: decoded), size (uint8), size bytes of data
+ **/
+class WireCapture {
+ public:
+    static constexpr size_t DEFAULT_CAPACITY = 16384;
+    static constexpr std::string_view FILE_MAGIC = "JUTTACAP";
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr uint8_t FLAG_TX = 1 << 0;
+    static constexpr uint8_t FLAG_DECODED = 1 << 1;
+
+    struct Stats {
+        /**
+         * Number of records written into the ring.
+         **/
+        uint64_t records{0};
+        /**
+         * Number of records that got dropped since the ring was full.
+         **/
+        uint64_t dropped{0};
+        /**
+         * Number of records written to the capture file.
+         **/
+        uint64_t flushed{0};
+    };
+
+ private:
+    std::vector<CaptureRecord> ring;
+    size_t mask;
+    /**
+     * Monotonic positions. The actual index is (pos & mask).
+     * Kept on separate cache lines, since they get written by different threads.
+     **/
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> flushed{0};
+    std::atomic<bool> enabled{true};
+
+    std::ofstream file{};
+
+ public:
+    /**
+     * The capacity (in records) gets rounded up to the next power of two.
+     **/
+    explicit WireCapture(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Records the given data with the current time.
+     * Only call it from a single thread at a time (the producer).
+     **/
+    void record(capture_direction_t direction, capture_layer_t layer, std::span<const uint8_t> data);
+    /**
+     * Records the given data with the given timestamp (see now()).
+     * Reading the clock is the most expensive part of recording, so share one timestamp between all records of a single read.
+     * Only call it from a single thread at a time (the producer).
+     **/
+    void record(capture_direction_t direction, capture_layer_t layer, std::span<const uint8_t> data, uint64_t timestamp);
+    /**
+     * Pauses (false) or resumes (true) recording.
+     * [Thread Safe]
+     **/
+    void set_enabled(bool enabled);
+    [[nodiscard]] bool is_enabled() const;
+
+    /**
+     * Removes all records from the ring and invokes the given function for each of them.
+     * Only call it from a single thread at a time (the consumer).
+     * Returns the number of records drained.
+     **/
+    size_t drain(const std::function<void(const CaptureRecord&)>& consumer);
+    /**
+     * Creates (truncates) the given capture file and writes the file header.
+     * Throws a exception in case the file can not be created.
+     * Only call it from the consumer thread.
+     **/
+    void open(const std::string& path);
+    /**
+     * Drains the ring into the capture file opened with open().
+     * Only call it from the consumer thread.
+     * Returns the number of records written.
+     **/
+    size_t flush();
+    /**
+     * Flushes and closes the capture file.
+     **/
+    void close();
+
+    /**
+     * Reads all records of the given capture file.
+     * Throws a exception in case the file does not exist or is no capture file.
+     * A truncated last record (e.g. the process got killed while flushing) gets ignored.
+     **/
+    [[nodiscard]] static std::vector<CaptureRecord> read_file(const std::string& path);
+
+    /**
+     * [Thread Safe]
+     **/
+    [[nodiscard]] Stats get_stats() const;
+    [[nodiscard]] size_t capacity() const;
+
+    [[nodiscard]] static uint64_t now();
+};
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
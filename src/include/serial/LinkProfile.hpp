@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+/**
+ * How a serial (UART) device gets configured.
+ *
+ * Since the file descriptor is non-blocking, VMIN and VTIME do not change what read() returns,
+ * but they control when poll() reports the device as readable (n_tty):
+ * VTIME == 0 and VMIN > 0 - Readable once VMIN bytes are available.
+ * Otherwise - Readable once a single byte is available.
+ * http://unixwiz.net/techtips/termios-vmin-vtime.html
+ **/
+struct LinkProfile {
+    uint32_t baudRate{9600};
+    uint8_t vmin{4};
+    /**
+     * In tenth of seconds.
+     **/
+    uint8_t vtime{2};
+    /**
+     * Request ASYNC_LOW_LATENCY via TIOCSSERIAL.
+     * Drivers like ftdi_sio lower the latency timer of USB to serial adapters (e.g. the FTDI FT232R) as long as it is set.
+     **/
+    bool lowLatency{false};
+    /**
+     * Additionally set the sysfs latency timer of USB to serial adapters to 1ms.
+     * Otherwise FTDI adapters buffer received bytes for up to 16ms before handing them to the kernel.
+     * This is a system wide setting of the adapter that requires write access to sysfs, so it is opt-in.
+     * The previous value gets restored once the connection gets closed.
+     **/
+    bool lowLatencyTimer{false};
+
+    /**
+     * The configuration used so far (VMIN = 4, VTIME = 2, driver default latency).
+     **/
+    static constexpr LinkProfile legacy() { return LinkProfile{}; }
+    /**
+     * Wakes up once per quad (VMIN = 4, VTIME = 0) with low latency enabled.
+     * Fewest wakeups, but the last bytes of a message with a lost byte only get picked up by the next read.
+     **/
+    static constexpr LinkProfile quad_framed() { return LinkProfile{9600, 4, 0, true}; }
+    /**
+     * Wakes up for every byte (VMIN = 1, VTIME = 0) with low latency enabled.
+     * Lowest latency, but four times the wakeups of quad_framed().
+     **/
+    static constexpr LinkProfile byte_streaming() { return LinkProfile{9600, 1, 0, true}; }
+};
+
+/**
+ * The settings that actually took effect after configuring a device with a LinkProfile.
+ * Read back from the device after applying them.
+ **/
+struct LinkSettings {
+    /**
+     * 0 in case the baud rate can not be represented as number.
+     **/
+    uint32_t baudRate{0};
+    uint8_t vmin{0};
+    uint8_t vtime{0};
+    /**
+     * True in case the driver supports TIOCGSERIAL/TIOCSSERIAL (e.g. not the case for pseudo terminals).
+     **/
+    bool serialInfoSupported{false};
+    bool lowLatency{false};
+    /**
+     * The latency timer of USB to serial adapters in ms (sysfs latency_timer).
+     * Only gets changed in case LinkProfile::lowLatencyTimer is set.
+     * -1 in case the device has none.
+     **/
+    int latencyTimerMs{-1};
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
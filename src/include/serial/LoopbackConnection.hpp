@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include "RingBuffer.hpp"
+#include "Transport.hpp"
+#include "WireCounters.hpp"
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+/**
+ * In-memory transport without any syscalls.
+ * Everything written to it gets collected and can be fetched via take_tx().
+ * The peer (e.g. a simulated coffee maker) provides data for reading via inject_rx().
+ * Satisfies the Transport concept, so it can be used as drop in replacement for the SerialConnection.
+ *
+ * The connection side (init, fill_rx, peek_rx, consume_rx, write_serial, ...) is not thread safe,
+ * the peer side (inject_rx, take_tx) is [Thread Safe].
+ **/
+class LoopbackConnection {
+ public:
+    /**
+     * Gets invoked for each write_serial() call with the written data.
+     * Allows simulating the other side synchronously by calling inject_rx() from inside.
+     **/
+    using Responder = std::function<void(std::span<const uint8_t>)>;
+
+ private:
+    RingBuffer rxBuffer;
+    /**
+     * Data injected by the peer that has not been moved into the rxBuffer yet.
+     **/
+    std::vector<uint8_t> rxPending{};
+    std::vector<uint8_t> txData{};
+    Responder responder{};
+    WireCounters counters{};
+    std::atomic<SerialConnectionState> state{SC_DISABLED};
+    /**
+     * Simulates an unplugged device. reopen() fails as long as this is set.
+     **/
+    std::atomic<bool> unplugged{false};
+
+    mutable std::mutex peerMutex{};
+    mutable std::condition_variable rxCondition{};
+
+ public:
+    explicit LoopbackConnection(size_t rxCapacity = RingBuffer::DEFAULT_CAPACITY);
+
+    /**
+     * Clears everything received so far. Never fails.
+     **/
+    void init();
+    /**
+     * Clears everything received so far.
+     * Throws a exception in case the device is currently unplugged (see set_unplugged()).
+     **/
+    void reopen();
+    void mark_error();
+    [[nodiscard]] SerialConnectionState get_state() const;
+
+    /**
+     * Moves everything injected by the peer into the receive buffer, up to its free space.
+     * Returns the number of bytes moved.
+     **/
+    size_t fill_rx();
+    [[nodiscard]] std::span<const uint8_t> peek_rx() const;
+    void consume_rx(size_t count);
+    [[nodiscard]] const RingBuffer& get_rx_buffer() const;
+    /**
+     * Returns the traffic counters (bytes, reads, short reads, writes, errors).
+     * [Thread Safe]
+     **/
+    [[nodiscard]] const WireCounters& get_wire_counters() const;
+    /**
+     * Blocks until the peer injected data or the given timeout occurred.
+     * A negative timeout waits forever.
+     * Returns true in case data is available.
+     * Returns false right away in case the connection is not in SC_READY.
+     **/
+    [[nodiscard]] bool wait_readable(const std::chrono::milliseconds& timeout) const;
+    /**
+     * Appends the given data to the transmitted data and invokes the responder, if set.
+     * Returns data.size() or 0 in case the connection is not in SC_READY.
+     **/
+    [[nodiscard]] size_t write_serial(std::span<const uint8_t> data);
+    /**
+     * Nothing to do since there is no actual transmission.
+     **/
+    void flush() const;
+
+    /**
+     * Makes the given data available for reading.
+     * [Thread Safe]
+     **/
+    void inject_rx(std::span<const uint8_t> data);
+    /**
+     * Moves everything written so far into out (appended).
+     * [Thread Safe]
+     **/
+    void take_tx(std::vector<uint8_t>& out);
+    /**
+     * Simulates unplugging (true) and replugging (false) the device.
+     * Unplugging moves the connection into SC_ERROR.
+     * [Thread Safe]
+     **/
+    void set_unplugged(bool unplugged);
+    /**
+     * Has to be set before the connection gets used, since it gets invoked without holding any lock.
+     **/
+    void set_responder(Responder&& responder);
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
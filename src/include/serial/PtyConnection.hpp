@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+
+#include "SerialConnection.hpp"
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+/**
+ * A serial connection on top of a pseudo terminal (openpty).
+ * We use the slave side, which is a real TTY and gets configured exactly like a serial (UART) device.
+ * The master side (peer) can be used by e.g. a simulated coffee maker to load test the protocol stack without any hardware.
+ **/
+class PtyConnection : public SerialConnection {
+ private:
+    struct PtyPair {
+        int masterFd{-1};
+        int slaveFd{-1};
+        std::string slavePath{};
+    };
+
+    int masterFd{-1};
+    /**
+     * Kept open for the whole lifetime, so reading from the master does not fail while the slave gets reopened.
+     **/
+    int slaveFd{-1};
+
+ public:
+    /**
+     * Creates a new pseudo terminal pair.
+     * Throws a exception in case something goes wrong.
+     **/
+    explicit PtyConnection(const LinkProfile& profile = LinkProfile::legacy());
+    PtyConnection(const PtyConnection&) = delete;
+    PtyConnection& operator=(const PtyConnection&) = delete;
+    PtyConnection(PtyConnection&&) = delete;
+    PtyConnection& operator=(PtyConnection&&) = delete;
+    ~PtyConnection();
+
+    /**
+     * Returns the master (peer) file descriptor. Everything written to it can be read from this connection and vice versa.
+     **/
+    [[nodiscard]] int get_peer_fd() const;
+
+ private:
+    PtyConnection(PtyPair&& pair, const LinkProfile& profile);
+    static PtyPair open_pty();
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+/**
+ * Fixed capacity byte ring buffer.
+ * Hands out contiguous views into its storage for filling (e.g. with readv()) and for consuming without copying.
+ * Not thread safe!
+ **/
+class RingBuffer {
+ public:
+    struct Stats {
+        /**
+         * Number of commits (e.g. read syscalls) that added data.
+         **/
+        size_t fills{0};
+        /**
+         * Total number of bytes that went through the buffer.
+         **/
+        size_t bytes{0};
+        /**
+         * The maximum number of bytes buffered at once.
+         **/
+        size_t highWaterMark{0};
+        /**
+         * Number of times new data could not be accepted since the buffer was full.
+         **/
+        size_t overflows{0};
+    };
+
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+ private:
+    std::vector<uint8_t> storage;
+    size_t mask;
+    /**
+     * Monotonic read and write positions. The actual index is (pos & mask).
+     **/
+    size_t head{0};
+    size_t tail{0};
+    Stats stats{};
+
+ public:
+    /**
+     * The capacity gets rounded up to the next power of two.
+     **/
+    explicit RingBuffer(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * Returns up to two contiguous regions of free space.
+     * The second one is only non empty in case the free space wraps around.
+     **/
+    [[nodiscard]] std::array<std::span<uint8_t>, 2> write_spans();
+    /**
+     * Marks count bytes of the free space, handed out by write_spans(), as filled.
+     **/
+    void commit(size_t count);
+    /**
+     * Records that new data was available, but the buffer was full.
+     **/
+    void record_overflow();
+
+    /**
+     * Returns the first contiguous region of buffered data.
+     * In case the data wraps around, the rest will be returned after consuming this one.
+     **/
+    [[nodiscard]] std::span<const uint8_t> read_span() const;
+    /**
+     * Removes the first count bytes from the buffer.
+     **/
+    void consume(size_t count);
+    /**
+     * Removes all buffered bytes.
+     **/
+    void clear();
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t capacity() const;
+    [[nodiscard]] size_t free_space() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] const Stats& get_stats() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
@@ -1,17 +1,21 @@
 #pragma once
 
 #include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "LinkProfile.hpp"
+#include "RingBuffer.hpp"
+#include "Transport.hpp"
+#include "WireCounters.hpp"
+
 //---------------------------------------------------------------------------
 namespace serial {
 //---------------------------------------------------------------------------
-enum SerialConnectionState { SC_DISABLED = 0,
-                             SC_OPENED = 1,
-                             SC_READY = 2,
-                             SC_ERROR = 3 };
-
 /**
  * Based on: https://en.wikibooks.org/wiki/Serial_Programming/termios
  **/
@@ -20,9 +24,25 @@ class SerialConnection {
     const std::string device;
     int fd = -1;
     SerialConnectionState state{SC_DISABLED};
+    LinkProfile profile;
+    /**
+     * The settings that took effect during the last configureTty().
+     **/
+    LinkSettings settings{};
+    /**
+     * The sysfs latency timer we changed and its previous value, which gets restored on close.
+     * restoreLatencyTimerMs is -1 in case we did not change it.
+     **/
+    std::filesystem::path latencyTimerPath{};
+    int restoreLatencyTimerMs{-1};
+    /**
+     * Everything available gets read into this buffer at once and then handed out to the decoder without copying.
+     **/
+    RingBuffer rxBuffer{};
+    WireCounters counters{};
 
  public:
-    explicit SerialConnection(std::string&& device);
+    explicit SerialConnection(std::string&& device, const LinkProfile& profile = LinkProfile::legacy());
     ~SerialConnection();
 
     /**
@@ -30,20 +50,94 @@ class SerialConnection {
      * Throws a exception in case something goes wrong.
      **/
     void init();
+    /**
+     * Closes the connection and opens and configures the device again.
+     * Used for recovering from SC_ERROR, e.g. after the USB to serial adapter got replugged.
+     * Throws a exception in case something goes wrong. The connection stays in SC_ERROR in this case.
+     **/
+    void reopen();
+    /**
+     * Moves the connection into SC_ERROR, e.g. in case the other side stopped responding.
+     * All I/O fails right away until reopen() succeeds.
+     **/
+    void mark_error();
+    [[nodiscard]] SerialConnectionState get_state() const;
+    /**
+     * Sets the profile used for configuring the device.
+     * In case the connection is ready, it gets applied right away.
+     * Throws a exception in case applying it fails.
+     **/
+    void set_profile(const LinkProfile& profile);
+    [[nodiscard]] const LinkProfile& get_profile() const;
+    /**
+     * Returns the settings that actually took effect when applying the profile.
+     * E.g. pseudo terminals do not support low latency and not all USB to serial adapters have a latency timer.
+     **/
+    [[nodiscard]] const LinkSettings& get_link_settings() const;
 
     /**
      * Reads at maximum four bytes.
      * Returns how many bytes have been actually read.
      **/
-    [[nodiscard]] size_t read_serial(std::array<uint8_t, 4>& buffer) const;
+    [[nodiscard]] size_t read_serial(std::array<uint8_t, 4>& buffer);
+    /**
+     * Reads everything currently available, up to the free space of the receive buffer, with a single readv() call.
+     * In case the receive buffer is full, nothing gets read and an overflow gets recorded.
+     * A read error or hangup moves the connection into SC_ERROR.
+     * Returns the number of bytes read.
+     **/
+    size_t fill_rx();
+    /**
+     * Returns a view of the first contiguous region of received data.
+     * Call consume_rx() once done with it, to get the rest in case the data wraps around inside the receive buffer.
+     **/
+    [[nodiscard]] std::span<const uint8_t> peek_rx() const;
+    /**
+     * Removes the first count bytes from the receive buffer.
+     **/
+    void consume_rx(size_t count);
+    /**
+     * Returns the receive buffer (size, capacity and statistics like the high water mark and overflows).
+     **/
+    [[nodiscard]] const RingBuffer& get_rx_buffer() const;
+    /**
+     * Returns the traffic counters (bytes, reads, short reads, writes, errors).
+     * [Thread Safe]
+     **/
+    [[nodiscard]] const WireCounters& get_wire_counters() const;
+    /**
+     * Blocks until data is available for reading or the given timeout occurred.
+     * Uses poll() on the (non-blocking) file descriptor, so it returns as soon as data arrives.
+     * A negative timeout waits forever.
+     * Returns true in case data is available or the device hung up (the next fill_rx() detects the error).
+     * Returns false right away in case the connection is not in SC_READY.
+     **/
+    [[nodiscard]] bool wait_readable(const std::chrono::milliseconds& timeout) const;
     /**
      * Writes the given data buffer to the serial connection.
      **/
-    [[nodiscard]] size_t write_serial(const std::array<uint8_t, 4>& data) const;
+    [[nodiscard]] size_t write_serial(const std::array<uint8_t, 4>& data);
+    /**
+     * Writes the given data to the serial connection with a single write call.
+     * A write error moves the connection into SC_ERROR.
+     * Returns how many bytes have been actually written.
+     **/
+    [[nodiscard]] size_t write_serial(std::span<const uint8_t> data);
+    /**
+     * Blocks until everything written has been transmitted.
+     **/
     void flush() const;
+    /**
+     * Returns the (non-blocking) file descriptor, e.g. for registering it with epoll.
+     * -1 in case the connection is not open.
+     **/
+    [[nodiscard]] int get_fd() const;
 
     /**
      * Returns all available serial port paths for this device.
+     * Scans /dev/serial/by-id and /sys/class/tty for ports backed by an actual device.
+     * In case a port is available via /dev/serial/by-id, this (stable) path gets returned instead of e.g. /dev/ttyUSB0.
+     * By-id paths come first.
      **/
     static std::vector<std::string> get_available_ports();
 
@@ -58,6 +152,15 @@ class SerialConnection {
      * Throws a exception in case something goes wrong.
      **/
     void configureTty();
+    /**
+     * Tries to enable or disable ASYNC_LOW_LATENCY and the latency timer according to the profile.
+     * Never throws, the outcome gets recorded in settings.
+     **/
+    void configureLatency();
+    /**
+     * Restores the sysfs latency timer in case we changed it.
+     **/
+    void restoreLatencyTimer();
     void closeTty();
 };
 //---------------------------------------------------------------------------
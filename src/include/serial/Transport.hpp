@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "RingBuffer.hpp"
+#include "WireCounters.hpp"
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+enum SerialConnectionState { SC_DISABLED = 0,
+                             SC_OPENED = 1,
+                             SC_READY = 2,
+                             SC_ERROR = 3 };
+
+/**
+ * Requirements for a byte transport the protocol stack (e.g. jutta_proto::BasicJuttaConnection) can run on top of.
+ * Resolved at compile time, so there is no virtual dispatch on the per quad hot path.
+ *
+ * Implementations:
+ * SerialConnection - A real serial (UART) device configured via termios.
+ * PtyConnection - A pseudo terminal (openpty), the other end is available to e.g. a simulated coffee maker.
+ * LoopbackConnection - An in-memory loopback without any syscalls.
+ *
+ * I/O errors (e.g. the USB to serial adapter got unplugged) move the transport into SC_ERROR.
+ * From there on all I/O fails right away until reopen() succeeds.
+ * All traffic gets counted in the WireCounters, which can be read from any thread.
+ **/
+template <typename T>
+concept Transport = requires(T t, const T ct, std::span<const uint8_t> data, size_t count, const std::chrono::milliseconds& timeout) {
+    t.init();
+    t.reopen();
+    t.mark_error();
+    { ct.get_state() } -> std::same_as<SerialConnectionState>;
+    { t.fill_rx() } -> std::convertible_to<size_t>;
+    { ct.peek_rx() } -> std::same_as<std::span<const uint8_t>>;
+    t.consume_rx(count);
+    { ct.get_rx_buffer() } -> std::same_as<const RingBuffer&>;
+    { ct.get_wire_counters() } -> std::same_as<const WireCounters&>;
+    { ct.wait_readable(timeout) } -> std::convertible_to<bool>;
+    { t.write_serial(data) } -> std::convertible_to<size_t>;
+    t.flush();
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
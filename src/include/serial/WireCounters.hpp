@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+/**
+ * Counts the traffic of a transport (bytes, reads, writes, ...).
+ * Gets updated by the thread doing the I/O and can be read at any time from any other thread without locking.
+ * [Thread Safe]
+ **/
+class WireCounters {
+ public:
+    struct Snapshot {
+        /**
+         * Number of wire bytes received.
+         **/
+        uint64_t bytesIn{0};
+        /**
+         * Number of wire bytes transmitted.
+         **/
+        uint64_t bytesOut{0};
+        /**
+         * Number of reads that returned data.
+         **/
+        uint64_t reads{0};
+        /**
+         * Number of reads that ended in the middle of a four byte quad, so the rest had to be waited for.
+         **/
+        uint64_t shortReads{0};
+        /**
+         * Number of writes.
+         **/
+        uint64_t writes{0};
+        /**
+         * Number of writes that transmitted less than requested.
+         **/
+        uint64_t shortWrites{0};
+        /**
+         * Number of I/O errors and hangups.
+         **/
+        uint64_t errors{0};
+    };
+
+ private:
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> shortReads{0};
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> shortWrites{0};
+    std::atomic<uint64_t> errors{0};
+
+ public:
+    /**
+     * Records a read that returned the given number of bytes.
+     **/
+    void on_read(size_t count);
+    /**
+     * Records a write of the given size, that actually transmitted the given number of bytes.
+     **/
+    void on_write(size_t requested, size_t written);
+    void on_error();
+
+    /**
+     * Each value gets read atomically, but not all of them at the same point in time.
+     **/
+    [[nodiscard]] Snapshot get_snapshot() const;
+};
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
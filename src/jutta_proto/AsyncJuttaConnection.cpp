@@ -0,0 +1,76 @@
+#include "jutta_proto/AsyncJuttaConnection.hpp"
+
+#include <utility>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+/**
+ * std::function requires copyable callables, so the promise has to be shared.
+ **/
+template <typename T>
+using SharedPromise = std::shared_ptr<std::promise<T>>;
+}  // namespace
+
+AsyncJuttaConnection::AsyncJuttaConnection(std::string&& device, const serial::LinkProfile& profile) : machine(loop.add_machine(std::move(device), profile)) {
+    start();
+}
+
+AsyncJuttaConnection::AsyncJuttaConnection(std::shared_ptr<serial::SerialConnection> connection) : machine(loop.add_machine(std::move(connection))) {
+    start();
+}
+
+AsyncJuttaConnection::~AsyncJuttaConnection() {
+    loop.stop();
+    ioThread.join();
+    loop.cancel_all();
+}
+
+void AsyncJuttaConnection::start() {
+    ioThread = std::thread([this]() { loop.run(); });
+}
+
+std::future<std::shared_ptr<std::string>> AsyncJuttaConnection::write_decoded_with_response(const std::string& data, const std::chrono::milliseconds& timeout) {
+    SharedPromise<std::shared_ptr<std::string>> promise = std::make_shared<std::promise<std::shared_ptr<std::string>>>();
+    std::future<std::shared_ptr<std::string>> future = promise->get_future();
+    write_decoded_with_response(
+        data, [promise](std::shared_ptr<std::string> response) { promise->set_value(std::move(response)); }, timeout);
+    return future;
+}
+
+void AsyncJuttaConnection::write_decoded_with_response(const std::string& data, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    loop.submit(machine, data, std::move(callback), timeout);
+}
+
+std::future<bool> AsyncJuttaConnection::write_decoded_wait_for(const std::string& data, const std::string& response, const std::chrono::milliseconds& timeout) {
+    SharedPromise<bool> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    write_decoded_wait_for(
+        data, response, [promise](bool result) { promise->set_value(result); }, timeout);
+    return future;
+}
+
+void AsyncJuttaConnection::write_decoded_wait_for(const std::string& data, const std::string& response, ResultCallback&& callback, const std::chrono::milliseconds& timeout) {
+    loop.submit_wait_for(
+        machine, data, response, [callback = std::move(callback)](std::shared_ptr<std::string> line) { callback(line != nullptr); }, timeout);
+}
+
+std::future<bool> AsyncJuttaConnection::wait_for_ok(const std::chrono::milliseconds& timeout) {
+    // Nothing to write, so the command directly waits for the response:
+    return write_decoded_wait_for("", "ok:\r\n", timeout);
+}
+
+std::future<bool> AsyncJuttaConnection::write_decoded(const std::string& data) {
+    SharedPromise<bool> promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> future = promise->get_future();
+    loop.submit_write(machine, data, [promise](std::shared_ptr<std::string> result) { promise->set_value(result != nullptr); });
+    return future;
+}
+
+EventLoop& AsyncJuttaConnection::get_event_loop() { return loop; }
+
+EventLoop::MachineId AsyncJuttaConnection::get_machine() const { return machine; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
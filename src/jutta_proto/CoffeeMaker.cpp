@@ -3,7 +3,9 @@
 #include "logger/Logger.hpp"
 #include <cassert>
 #include <chrono>
+#include <coroutine>
 #include <cstddef>
+#include <exception>
 #include <iomanip>
 #include <limits>
 #include <ratio>
@@ -70,27 +72,27 @@ CoffeeMaker::jutta_button_t CoffeeMaker::get_button_num(coffee_t coffee) const {
 void CoffeeMaker::press_button(jutta_button_t button) const {
     switch (button) {
         case jutta_button_t::BUTTON_1:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_1));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_1));
             break;
 
         case jutta_button_t::BUTTON_2:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_2));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_2));
             break;
 
         case jutta_button_t::BUTTON_3:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_3));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_3));
             break;
 
         case jutta_button_t::BUTTON_4:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_4));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_4));
             break;
 
         case jutta_button_t::BUTTON_5:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_5));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_5));
             break;
 
         case jutta_button_t::BUTTON_6:
-            static_cast<void>(write_and_wait(JUTTA_BUTTON_6));
+            static_cast<void>(write_and_wait(jutta_command_t::BUTTON_6));
             break;
 
         default:
@@ -102,87 +104,152 @@ void CoffeeMaker::press_button(jutta_button_t button) const {
     std::this_thread::sleep_for(std::chrono::milliseconds{500});
 }
 
-void CoffeeMaker::brew_custom_coffee(const bool* cancel, const std::chrono::milliseconds& grindTime, const std::chrono::milliseconds& waterTime) {
-    assert(!locked);
-    locked = true;
+/**
+ * Provides the awaitable interface of CoroutineConnection on top of the blocking JuttaConnection.
+ * All awaitables are ready right away, so a coroutine using it runs to completion on the calling thread.
+ **/
+class CoffeeMaker::BlockingConnection {
+ public:
+    struct ReadyAwaitable {
+        bool result;
+
+        [[nodiscard]] bool await_ready() const noexcept { return true; }
+        void await_suspend(std::coroutine_handle<> /*handle*/) const noexcept {}
+        [[nodiscard]] bool await_resume() const noexcept { return result; }
+    };
+
+ private:
+    const CoffeeMaker& coffeeMaker;
+
+ public:
+    explicit BlockingConnection(const CoffeeMaker& coffeeMaker) : coffeeMaker(coffeeMaker) {}
+
+    [[nodiscard]] ReadyAwaitable write_command(jutta_command_t command) const { return {coffeeMaker.write_and_wait(command)}; }
+    [[nodiscard]] static ReadyAwaitable sleep_cancelable(std::chrono::milliseconds time, const bool* cancel) { return {CoffeeMaker::sleep_cancelable(time, cancel)}; }
+
+    /**
+     * Runs the given task on the calling thread and rethrows its exception.
+     **/
+    static void run(Task<void>&& task) {
+        std::exception_ptr exception{};
+        bool done = false;
+        spawn(capture(std::move(task), exception, done));
+        // Nothing suspends, so the task is done once spawn() returns:
+        assert(done);
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+ private:
+    static Task<void> capture(Task<void> task, std::exception_ptr& exception, bool& done) {
+        try {
+            co_await task;
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        done = true;
+    }
+};
+
+bool CoffeeMaker::write_and_wait(jutta_command_t command) const {
+    return connection->write_command_wait_for(command);
+}
+
+template <typename Connection>
+Task<void> CoffeeMaker::brew_custom_coffee_steps(Connection& connection, const bool* cancel, std::chrono::milliseconds grindTime, std::chrono::milliseconds waterTime) {
     SPDLOG_INFO("Brewing custom coffee with {} ms grind time and {} ms ms water time...", std::to_string(grindTime.count()), std::to_string(waterTime.count()));
 
     // Grind:
     SPDLOG_INFO("Custom coffee grinding...");
-    static_cast<void>(write_and_wait(JUTTA_GRINDER_ON));
-    if (!sleep_cancelable(grindTime, cancel)) {
-        static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_RESET));
-        locked = false;
-        return;
+    static_cast<void>(co_await connection.write_command(jutta_command_t::GRINDER_ON));
+    if (!co_await connection.sleep_cancelable(grindTime, cancel)) {
+        static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_RESET));
+        co_return;
     }
-    static_cast<void>(write_and_wait(JUTTA_GRINDER_OFF));
-    static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_TO_BREWING_POSITION));
+    static_cast<void>(co_await connection.write_command(jutta_command_t::GRINDER_OFF));
+    static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_TO_BREWING_POSITION));
 
     // Compress:
     SPDLOG_INFO("Custom coffee compressing...");
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_PRESS_ON));
-    if (!sleep_cancelable(grindTime, cancel)) {
-        static_cast<void>(write_and_wait(JUTTA_COFFEE_PRESS_OFF));
-        static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_RESET));
-        locked = false;
-        return;
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_PRESS_ON));
+    if (!co_await connection.sleep_cancelable(grindTime, cancel)) {
+        static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_PRESS_OFF));
+        static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_RESET));
+        co_return;
     }
-    sleep_cancelable(std::chrono::milliseconds{500}, cancel);
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_PRESS_OFF));
+    static_cast<void>(co_await connection.sleep_cancelable(std::chrono::milliseconds{500}, cancel));
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_PRESS_OFF));
 
     // Brew step 1:
     SPDLOG_INFO("Custom coffee brewing...");
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_ON));
-    if (!sleep_cancelable(std::chrono::milliseconds{2000}, cancel)) {
-        static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_OFF));
-        static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_RESET));
-        locked = false;
-        return;
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_ON));
+    if (!co_await connection.sleep_cancelable(std::chrono::milliseconds{2000}, cancel)) {
+        static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_OFF));
+        static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_RESET));
+        co_return;
     }
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_OFF));
-    if (!sleep_cancelable(std::chrono::milliseconds{2000}, cancel)) {
-        static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_RESET));
-        locked = false;
-        return;
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_OFF));
+    if (!co_await connection.sleep_cancelable(std::chrono::milliseconds{2000}, cancel)) {
+        static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_RESET));
+        co_return;
     }
 
-    // Brew setp 2:
-    pump_hot_water(waterTime, cancel);
+    // Brew step 2:
+    static_cast<void>(co_await pump_hot_water(connection, waterTime, cancel));
 
     // Reset:
     SPDLOG_INFO("Custom coffee finishing up...");
-    static_cast<void>(write_and_wait(JUTTA_BREW_GROUP_RESET));
+    static_cast<void>(co_await connection.write_command(jutta_command_t::BREW_GROUP_RESET));
     SPDLOG_INFO("Custom coffee done.");
-
-    locked = false;
-}
-
-bool CoffeeMaker::write_and_wait(const std::string& s) const {
-    static_cast<void>(connection->write_decoded(s));
-    return connection->wait_for_ok();
 }
 
-bool CoffeeMaker::pump_hot_water(const std::chrono::milliseconds& waterTime, const bool* cancel) const {
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_ON));
+template <typename Connection>
+Task<bool> CoffeeMaker::pump_hot_water(Connection& connection, std::chrono::milliseconds waterTime, const bool* cancel) {
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_ON));
     std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + waterTime;
-    // NOLINTNEXTLINE (hicpp-use-nullptr, modernize-use-nullptr)
     while (std::chrono::steady_clock::now() < end) {
-        static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_HEATER_ON));
+        static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_HEATER_ON));
         SPDLOG_INFO("Heater turned on.");
-        if (!sleep_cancelable(waterTime / 8, cancel)) {
-            static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_HEATER_OFF));
-            static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_OFF));
-            return false;
+        if (!co_await connection.sleep_cancelable(waterTime / 8, cancel)) {
+            static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_HEATER_OFF));
+            static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_OFF));
+            co_return false;
         }
-        static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_HEATER_OFF));
+        static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_HEATER_OFF));
         SPDLOG_INFO("Heater turned off.");
-        if (!sleep_cancelable(waterTime / 20, cancel)) {
-            static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_OFF));
-            return false;
+        if (!co_await connection.sleep_cancelable(waterTime / 20, cancel)) {
+            static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_OFF));
+            co_return false;
         }
     }
-    static_cast<void>(write_and_wait(JUTTA_COFFEE_WATER_PUMP_OFF));
-    return !(*cancel);
+    static_cast<void>(co_await connection.write_command(jutta_command_t::COFFEE_WATER_PUMP_OFF));
+    co_return !(*cancel);
+}
+
+void CoffeeMaker::brew_custom_coffee(const bool* cancel, const std::chrono::milliseconds& grindTime, const std::chrono::milliseconds& waterTime) {
+    assert(!locked);
+    locked = true;
+    BlockingConnection blocking(*this);
+    try {
+        BlockingConnection::run(brew_custom_coffee_steps(blocking, cancel, grindTime, waterTime));
+    } catch (...) {
+        locked = false;
+        throw;
+    }
+    locked = false;
+}
+
+Task<void> CoffeeMaker::brew_custom_coffee(CoroutineConnection& connection, const bool* cancel, std::chrono::milliseconds grindTime, std::chrono::milliseconds waterTime) {
+    assert(!locked);
+    locked = true;
+    try {
+        co_await brew_custom_coffee_steps(connection, cancel, grindTime, waterTime);
+    } catch (...) {
+        locked = false;
+        throw;
+    }
+    locked = false;
 }
 
 bool CoffeeMaker::is_locked() const { return locked; }
@@ -0,0 +1,41 @@
+#include "jutta_proto/CommandLock.hpp"
+
+#include <cassert>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+void CommandLock::lock() {
+    std::unique_lock<std::mutex> lk(mutex);
+    condition.wait(lk, [this] { return !locked && priorityWaiters <= 0; });
+    locked = true;
+}
+
+void CommandLock::lock_priority() {
+    std::unique_lock<std::mutex> lk(mutex);
+    priorityWaiters++;
+    condition.wait(lk, [this] { return !locked; });
+    priorityWaiters--;
+    locked = true;
+}
+
+bool CommandLock::try_lock() {
+    std::unique_lock<std::mutex> lk(mutex);
+    if (locked || priorityWaiters > 0) {
+        return false;
+    }
+    locked = true;
+    return true;
+}
+
+void CommandLock::unlock() {
+    {
+        std::unique_lock<std::mutex> lk(mutex);
+        assert(locked);
+        locked = false;
+    }
+    condition.notify_all();
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
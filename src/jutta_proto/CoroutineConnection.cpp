@@ -0,0 +1,56 @@
+#include "jutta_proto/CoroutineConnection.hpp"
+
+#include <algorithm>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+CoroutineConnection::CoroutineConnection(EventLoop& loop, EventLoop::MachineId machine) : loop(loop), machine(machine) {}
+
+CoroutineConnection::CommandAwaitable<std::shared_ptr<std::string>> CoroutineConnection::write_decoded_with_response(std::string data, const std::chrono::milliseconds& timeout) {
+    return {loop, machine, std::move(data), "", timeout, true};
+}
+
+CoroutineConnection::CommandAwaitable<bool> CoroutineConnection::write_decoded_wait_for(std::string data, std::string response, const std::chrono::milliseconds& timeout) {
+    return {loop, machine, std::move(data), std::move(response), timeout, true};
+}
+
+CoroutineConnection::CommandAwaitable<bool> CoroutineConnection::write_and_wait(std::string data, const std::chrono::milliseconds& timeout) {
+    return write_decoded_wait_for(std::move(data), "ok:\r\n", timeout);
+}
+
+CoroutineConnection::CommandAwaitable<bool> CoroutineConnection::write_command(jutta_command_t command, const std::chrono::milliseconds& timeout) {
+    return {loop, machine, command, timeout};
+}
+
+CoroutineConnection::CommandAwaitable<bool> CoroutineConnection::wait_for_ok(const std::chrono::milliseconds& timeout) {
+    // Nothing to write, so the command directly waits for the response:
+    return write_decoded_wait_for("", "ok:\r\n", timeout);
+}
+
+CoroutineConnection::CommandAwaitable<bool> CoroutineConnection::write_decoded(std::string data) {
+    return {loop, machine, std::move(data), "", std::chrono::milliseconds{0}, false};
+}
+
+CoroutineConnection::SleepAwaitable CoroutineConnection::sleep(const std::chrono::nanoseconds& duration) {
+    return {loop, duration};
+}
+
+Task<bool> CoroutineConnection::sleep_cancelable(std::chrono::milliseconds time, const bool* cancel) {
+    // By default we perform 100ms increment steps:
+    constexpr std::chrono::milliseconds TIME_STEP{100};
+
+    while (time.count() > 0 && !(*cancel)) {
+        const std::chrono::milliseconds step = std::min(time, TIME_STEP);
+        co_await sleep(step);
+        time -= step;
+    }
+    co_return !(*cancel);
+}
+
+EventLoop& CoroutineConnection::get_event_loop() const { return loop; }
+
+EventLoop::MachineId CoroutineConnection::get_machine() const { return machine; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
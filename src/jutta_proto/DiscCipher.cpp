@@ -0,0 +1,136 @@
+#include "jutta_proto/DiscCipher.hpp"
+
+#include <algorithm>
+#include <memory>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+DiscCipher::DiscCipher(uint8_t key) : key(key) {
+    const uint8_t keyLeftNibble = key >> 4;
+    const uint8_t keyRightNibble = key & 0x0F;
+    for (size_t n = 0; n < rows.size(); n++) {
+        const uint8_t a = (n + keyLeftNibble) & 0x0F;
+        const uint8_t c = (keyRightNibble + (n >> 4) - n - keyLeftNibble) & 0x0F;
+        rows[n] = static_cast<uint8_t>((a << 4) | c);
+    }
+}
+
+const DiscCipher& DiscCipher::for_key(uint8_t key) {
+    // 256 keys * 256 nibble positions = 64 KiB, initialized once on first use:
+    static const std::unique_ptr<std::array<DiscCipher, 256>> CIPHERS = [] {
+        std::unique_ptr<std::array<DiscCipher, 256>> ciphers = std::make_unique<std::array<DiscCipher, 256>>();
+        for (size_t i = 0; i < ciphers->size(); i++) {
+            (*ciphers)[i] = DiscCipher(static_cast<uint8_t>(i));
+        }
+        return ciphers;
+    }();
+    return (*CIPHERS)[key];
+}
+
+void DiscCipher::encrypt(std::span<uint8_t> data, size_t nibbleOffset) const {
+    apply(data, nibbleOffset);
+}
+
+void DiscCipher::decrypt(std::span<uint8_t> data, size_t nibbleOffset) const {
+    apply(data, nibbleOffset);
+}
+
+void DiscCipher::apply(std::span<uint8_t> data, size_t nibbleOffset) const {
+    // Wraps around after 256 nibbles, the same way it does on the coffee maker:
+    auto n = static_cast<uint8_t>(nibbleOffset);
+    for (uint8_t& b : data) {
+        const std::array<uint8_t, 16>& left = SUBSTITUTION[rows[n++]];
+        const std::array<uint8_t, 16>& right = SUBSTITUTION[rows[n++]];
+        b = static_cast<uint8_t>((left[b >> 4] << 4) | right[b & 0x0F]);
+    }
+}
+
+size_t DiscCipher::decrypt_frame(std::span<uint8_t> frame) {
+    if (frame.size() < 2 || frame[0] != FRAME_START) {
+        return 0;
+    }
+
+    // Key:
+    size_t r = 1;
+    uint8_t key = frame[r++];
+    if (key == ESCAPE) {
+        if (r >= frame.size()) {
+            return 0;
+        }
+        key = frame[r++] ^ ESCAPE_XOR;
+    }
+
+    // Remove the escaping in place. The plain text is never longer than the frame, so writing never overtakes reading:
+    size_t w = 0;
+    while (r < frame.size() && frame[r] != '\r') {
+        uint8_t b = frame[r++];
+        if (b == ESCAPE) {
+            if (r >= frame.size()) {
+                break;
+            }
+            b = frame[r++] ^ ESCAPE_XOR;
+        }
+        frame[w++] = b;
+    }
+    for_key(key).decrypt(frame.first(w));
+    return w;
+}
+
+size_t DiscCipher::decrypt_frames(std::span<const std::span<uint8_t>> frames, std::span<size_t> lengths) {
+    const size_t count = std::min(frames.size(), lengths.size());
+    for (size_t i = 0; i < count; i++) {
+        lengths[i] = decrypt_frame(frames[i]);
+    }
+    return count;
+}
+
+size_t DiscCipher::encrypt_frame(uint8_t key, std::span<const uint8_t> plain, std::span<uint8_t> out) {
+    const DiscCipher& cipher = for_key(key);
+    size_t w = 0;
+    auto put = [&out, &w](uint8_t b) {
+        if (needs_escape(b)) {
+            if (w + 2 > out.size()) {
+                return false;
+            }
+            out[w++] = ESCAPE;
+            out[w++] = b ^ ESCAPE_XOR;
+            return true;
+        }
+        if (w + 1 > out.size()) {
+            return false;
+        }
+        out[w++] = b;
+        return true;
+    };
+
+    if (out.empty()) {
+        return 0;
+    }
+    out[w++] = FRAME_START;
+    if (!put(key)) {
+        return 0;
+    }
+
+    // Encrypt byte by byte to stay allocation free, since the escaping happens after encrypting:
+    auto n = static_cast<uint8_t>(0);
+    for (uint8_t b : plain) {
+        const std::array<uint8_t, 16>& left = SUBSTITUTION[cipher.rows[n++]];
+        const std::array<uint8_t, 16>& right = SUBSTITUTION[cipher.rows[n++]];
+        if (!put(static_cast<uint8_t>((left[b >> 4] << 4) | right[b & 0x0F]))) {
+            return 0;
+        }
+    }
+
+    if (w + 2 > out.size()) {
+        return 0;
+    }
+    out[w++] = '\r';
+    out[w++] = '\n';
+    return w;
+}
+
+uint8_t DiscCipher::get_key() const { return key; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
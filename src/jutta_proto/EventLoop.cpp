@@ -0,0 +1,534 @@
+#include "jutta_proto/EventLoop.hpp"
+#include "jutta_proto/JuttaCodec.hpp"
+#include "jutta_proto/JuttaCommands.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+extern "C" {
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+}
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+constexpr uint64_t WAKE_EVENT = std::numeric_limits<uint64_t>::max();
+constexpr uint64_t TIMER_EVENT = std::numeric_limits<uint64_t>::max() - 1;
+constexpr size_t MAX_EVENTS = 64;
+
+void add_to_epoll(int epollFd, int fd, uint64_t data) {
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = data;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        throw std::runtime_error(std::string("Failed to add fd to epoll with: ") + strerror(errno));
+    }
+}
+
+void drain_fd(int fd) {
+    uint64_t value = 0;
+    while (read(fd, &value, sizeof(value)) > 0) {}
+}
+}  // namespace
+
+EventLoop::EventLoop() : epollFd(epoll_create1(EPOLL_CLOEXEC)),
+                         wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+                         // NOLINTNEXTLINE (hicpp-signed-bitwise)
+                         timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) {
+    if (epollFd < 0 || wakeFd < 0 || timerFd < 0) {
+        close(epollFd);
+        close(wakeFd);
+        close(timerFd);
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        throw std::runtime_error(std::string("Failed to create the event loop with: ") + strerror(errno));
+    }
+    add_to_epoll(epollFd, wakeFd, WAKE_EVENT);
+    add_to_epoll(epollFd, timerFd, TIMER_EVENT);
+}
+
+EventLoop::~EventLoop() {
+    close(timerFd);
+    close(wakeFd);
+    close(epollFd);
+}
+
+EventLoop::MachineId EventLoop::add_machine(std::string&& device, const serial::LinkProfile& profile) {
+    std::shared_ptr<serial::SerialConnection> connection = std::make_shared<serial::SerialConnection>(std::move(device), profile);
+    connection->init();
+    return add_machine(std::move(connection));
+}
+
+EventLoop::MachineId EventLoop::add_machine(std::shared_ptr<serial::SerialConnection> connection) {
+    assert(connection);
+    assert(connection->get_fd() >= 0);
+    MachineId id = machines.size();
+    add_to_epoll(epollFd, connection->get_fd(), id);
+    machines.push_back(std::make_unique<Machine>());
+    machines.back()->connection = std::move(connection);
+    return id;
+}
+
+size_t EventLoop::get_machine_count() const { return machines.size(); }
+
+FrameRouter& EventLoop::get_router(MachineId machine) {
+    assert(machine < machines.size());
+    return machines[machine]->router;
+}
+
+void EventLoop::set_link_config(MachineId machine, const LinkSupervisor::Config& config) {
+    assert(machine < machines.size());
+    machines[machine]->supervisor = LinkSupervisor(config);
+}
+
+const LinkSupervisor::Stats& EventLoop::get_link_stats(MachineId machine) const {
+    assert(machine < machines.size());
+    return machines[machine]->supervisor.get_stats();
+}
+
+void EventLoop::set_capture(MachineId machine, std::shared_ptr<WireCapture> capture) {
+    assert(machine < machines.size());
+    machines[machine]->capture = std::move(capture);
+}
+
+void EventLoop::submit(MachineId machine, const std::string& data, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    submit_wait_for(machine, data, "", std::move(callback), timeout);
+}
+
+void EventLoop::submit_wait_for(MachineId machine, const std::string& data, const std::string& response, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    // Encode on the calling thread:
+    Command command = make_command(data, response, std::move(callback), timeout);
+    post([this, machine, command = std::move(command)]() mutable { enqueue(machine, std::move(command)); });
+}
+
+void EventLoop::submit_command(MachineId machine, jutta_command_t command, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    Command cmd = make_command(command, std::move(callback), timeout);
+    post([this, machine, cmd = std::move(cmd)]() mutable { enqueue(machine, std::move(cmd)); });
+}
+
+void EventLoop::submit_write(MachineId machine, const std::string& data, ResponseCallback&& callback) {
+    Command command = make_command(data, "", std::move(callback), std::chrono::milliseconds{0});
+    command.expectResponse = false;
+    post([this, machine, command = std::move(command)]() mutable { enqueue(machine, std::move(command)); });
+}
+
+EventLoop::Command EventLoop::make_command(const std::string& data, const std::string& response, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    Command command;
+    command.wire.resize(data.size() * WIRE_QUAD_SIZE);
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    encode_block(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size()), command.wire);
+    command.response = response;
+    command.timeout = timeout;
+    command.callback = std::move(callback);
+    return command;
+}
+
+EventLoop::Command EventLoop::make_command(jutta_command_t command, ResponseCallback&& callback, const std::chrono::milliseconds& timeout) {
+    Command result;
+    // Already encoded at compile time:
+    const std::span<const uint8_t> wire = get_encoded_command(command);
+    result.wire.assign(wire.begin(), wire.end());
+    result.response = get_command_info(command).response;
+    result.timeout = timeout;
+    result.callback = std::move(callback);
+    return result;
+}
+
+void EventLoop::post(std::function<void()>&& task) {
+    {
+        std::unique_lock<std::mutex> lk(inboxLock);
+        inbox.push_back(std::move(task));
+    }
+    wake();
+}
+
+EventLoop::TimerId EventLoop::add_timer(const std::chrono::nanoseconds& delay, TimerCallback&& callback) {
+    TimerId id = nextTimerId++;
+    TimePoint deadline = std::chrono::steady_clock::now() + delay;
+    timers.emplace(std::make_pair(deadline, id), std::move(callback));
+    timerDeadlines.emplace(id, deadline);
+    arm_timer();
+    return id;
+}
+
+bool EventLoop::cancel_timer(TimerId timer) {
+    std::unordered_map<TimerId, TimePoint>::iterator it = timerDeadlines.find(timer);
+    if (it == timerDeadlines.end()) {
+        return false;
+    }
+    timers.erase(std::make_pair(it->second, timer));
+    timerDeadlines.erase(it);
+    return true;
+}
+
+void EventLoop::run() {
+    while (!stopRequested) {
+        run_once(std::chrono::milliseconds{-1});
+    }
+}
+
+void EventLoop::run_once(const std::chrono::milliseconds& timeout) {
+    std::array<epoll_event, MAX_EVENTS> events{};
+    int count = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), static_cast<int>(timeout.count()));
+    if (count < 0 && errno != EINTR) {
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        SPDLOG_ERROR("epoll_wait failed with: {}", strerror(errno));
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        const epoll_event& event = events[i];
+        if (event.data.u64 == WAKE_EVENT) {
+            drain_fd(wakeFd);
+            drain_inbox();
+        } else if (event.data.u64 == TIMER_EVENT) {
+            drain_fd(timerFd);
+            armedDeadline = TimePoint::max();
+        } else {
+            MachineId id = event.data.u64;
+            Machine& machine = *machines[id];
+            if (machine.state == MachineState::FAILED) {
+                continue;
+            }
+            if (event.events & EPOLLIN) {
+                on_readable(id, machine);
+            }
+            if ((event.events & (EPOLLERR | EPOLLHUP)) || machine.connection->get_state() != serial::SC_READY) {
+                fail(id, machine);
+            }
+        }
+    }
+
+    const TimePoint now = std::chrono::steady_clock::now();
+    for (MachineId id = 0; id < machines.size(); id++) {
+        service(id, *machines[id], now);
+    }
+    fire_timers(now);
+    arm_timer();
+}
+
+void EventLoop::stop() {
+    stopRequested = true;
+    wake();
+}
+
+void EventLoop::cancel_all() {
+    drain_inbox();
+    for (std::unique_ptr<Machine>& machine : machines) {
+        std::deque<Command> queue;
+        queue.swap(machine->queue);
+        if (machine->state != MachineState::FAILED) {
+            machine->state = MachineState::IDLE;
+        }
+        for (Command& command : queue) {
+            if (command.callback) {
+                command.callback(nullptr);
+            }
+        }
+    }
+}
+
+void EventLoop::wake() const {
+    uint64_t value = 1;
+    static_cast<void>(write(wakeFd, &value, sizeof(value)));
+}
+
+void EventLoop::drain_inbox() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::unique_lock<std::mutex> lk(inboxLock);
+        tasks.swap(inbox);
+    }
+    for (std::function<void()>& task : tasks) {
+        task();
+    }
+}
+
+void EventLoop::enqueue(MachineId machine, Command&& command) {
+    assert(machine < machines.size());
+    // Fail fast while the link is down or the reconnect probe is still pending:
+    if (machines[machine]->state == MachineState::FAILED || machines[machine]->reconnecting) {
+        if (command.callback) {
+            command.callback(nullptr);
+        }
+        return;
+    }
+    machines[machine]->queue.push_back(std::move(command));
+}
+
+void EventLoop::on_readable(MachineId id, Machine& machine) {
+    serial::SerialConnection& serial = *machine.connection;
+    while (true) {
+        const size_t freeSpace = serial.get_rx_buffer().free_space();
+        const size_t size = serial.fill_rx();
+        for (std::span<const uint8_t> wire = serial.peek_rx(); !wire.empty(); wire = serial.peek_rx()) {
+            std::vector<uint8_t>& decoded = machine.framer.input();
+            // Realigning might take back bytes of the previous call, so only the appended ones get recorded:
+            const size_t appended = machine.decoder.feed(wire, decoded);
+            if (machine.capture) {
+                const uint64_t timestamp = WireCapture::now();
+                machine.capture->record(capture_direction_t::RX, capture_layer_t::WIRE, wire, timestamp);
+                machine.capture->record(capture_direction_t::RX, capture_layer_t::DECODED, std::span<const uint8_t>(decoded).last(appended), timestamp);
+            }
+            serial.consume_rx(wire.size());
+        }
+        if (size <= 0 || size < freeSpace) {
+            break;
+        }
+    }
+    machine.lastRx = std::chrono::steady_clock::now();
+
+    // Dispatch all complete lines:
+    for (std::optional<std::string_view> line = machine.framer.next(); line; line = machine.framer.next()) {
+        on_line(id, machine, *line);
+    }
+}
+
+void EventLoop::on_line([[maybe_unused]] MachineId id, Machine& machine, std::string_view line) {
+    SPDLOG_DEBUG("Read from {}: {}", id, line);
+    if (machine.state != MachineState::WAITING) {
+        if (!machine.router.is_unsolicited(line)) {
+            if (machine.earlyLines.size() >= MAX_EARLY_LINES) {
+                machine.earlyLines.pop_front();
+            }
+            machine.earlyLines.emplace_back(line);
+        }
+        static_cast<void>(machine.router.dispatch(line));
+        return;
+    }
+    if (machine.router.route(line, machine.queue.front().response)) {
+        complete(machine, std::make_shared<std::string>(line));
+    }
+}
+
+void EventLoop::service(MachineId id, Machine& machine, TimePoint now) {
+    while (true) {
+        switch (machine.state) {
+            case MachineState::IDLE:
+                if (machine.queue.empty()) {
+                    break;
+                }
+                if (!machine.queue.front().wire.empty()) {
+                    machine.earlyLines.clear();
+                }
+                machine.state = MachineState::TRANSMITTING;
+                machine.nextQuad = 0;
+                machine.messageStart = machine.pacer.begin_message();
+                machine.nextRelease = machine.messageStart;
+                continue;
+
+            case MachineState::TRANSMITTING: {
+                const std::vector<uint8_t>& wire = machine.queue.front().wire;
+                bool failed = false;
+                while (!failed && machine.nextRelease <= now && machine.nextQuad * WIRE_QUAD_SIZE < wire.size()) {
+                    machine.nextRelease = machine.pacer.release_quad(machine.nextRelease);
+                    std::span<const uint8_t> quad = std::span<const uint8_t>(wire).subspan(machine.nextQuad * WIRE_QUAD_SIZE, WIRE_QUAD_SIZE);
+                    if (machine.capture) {
+                        machine.capture->record(capture_direction_t::TX, capture_layer_t::WIRE, quad);
+                    }
+                    failed = machine.connection->write_serial(quad) != quad.size();
+                    machine.nextQuad++;
+                }
+                if (failed) {
+                    SPDLOG_WARN("Failed to write quad {}.", machine.nextQuad - 1);
+                    machine.pacer.end_message(machine.messageStart, machine.nextRelease);
+                    if (machine.connection->get_state() != serial::SC_READY) {
+                        fail(id, machine);
+                    } else {
+                        complete(machine, nullptr);
+                    }
+                    continue;
+                }
+                if (machine.nextQuad * WIRE_QUAD_SIZE < wire.size()) {
+                    // Wait for the next quad to become due:
+                    break;
+                }
+                machine.pacer.end_message(machine.messageStart, machine.nextRelease);
+                if (!machine.queue.front().expectResponse) {
+                    complete(machine, std::make_shared<std::string>());
+                    continue;
+                }
+                if (machine.queue.front().wire.empty()) {
+                    // Nothing got written, so the response might already have arrived:
+                    const std::string& expected = machine.queue.front().response;
+                    std::deque<std::string>::iterator it = std::find_if(machine.earlyLines.begin(), machine.earlyLines.end(), [&expected](const std::string& line) { return expected.empty() || line.find(expected) != std::string::npos; });
+                    if (it != machine.earlyLines.end()) {
+                        std::shared_ptr<std::string> response = std::make_shared<std::string>(std::move(*it));
+                        machine.earlyLines.erase(machine.earlyLines.begin(), it + 1);
+                        complete(machine, std::move(response));
+                        continue;
+                    }
+                }
+                const std::chrono::milliseconds& timeout = machine.queue.front().timeout;
+                machine.responseDeadline = timeout.count() > 0 ? now + timeout : TimePoint::max();
+                machine.state = MachineState::WAITING;
+                continue;
+            }
+
+            case MachineState::WAITING:
+                if (now < machine.responseDeadline) {
+                    break;
+                }
+                SPDLOG_DEBUG("Command timed out.");
+                if (!machine.reconnecting && machine.supervisor.on_timeout()) {
+                    // The link stalled:
+                    machine.connection->mark_error();
+                    fail(id, machine);
+                } else {
+                    complete(machine, nullptr);
+                }
+                continue;
+
+            case MachineState::FAILED:
+                break;
+        }
+        break;
+    }
+
+    // A partial quad at this point will never be completed:
+    if (machine.decoder.buffered() > 0 && now >= machine.lastRx + LINE_QUIET_TIME) {
+        machine.decoder.on_idle();
+    }
+}
+
+void EventLoop::complete(Machine& machine, std::shared_ptr<std::string>&& response) {
+    assert(!machine.queue.empty());
+    Command command = std::move(machine.queue.front());
+    machine.queue.pop_front();
+    machine.state = MachineState::IDLE;
+    machine.responseDeadline = TimePoint::max();
+    if (response && command.expectResponse && !machine.reconnecting) {
+        machine.supervisor.on_success();
+    }
+    if (command.callback) {
+        command.callback(std::move(response));
+    }
+}
+
+void EventLoop::fail(MachineId id, Machine& machine) {
+    if (machine.state == MachineState::FAILED) {
+        return;
+    }
+    const TimePoint now = std::chrono::steady_clock::now();
+    if (machine.supervisor.is_down()) {
+        // The probe after reopening the connection failed:
+        machine.supervisor.on_reconnect_failed(now);
+    } else {
+        SPDLOG_ERROR("Connection to machine {} failed.", id);
+        if (machine.connection->get_state() == serial::SC_ERROR) {
+            machine.supervisor.on_error();
+        }
+        machine.supervisor.link_down(now);
+    }
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, machine.connection->get_fd(), nullptr);
+    machine.connection->mark_error();
+    machine.state = MachineState::FAILED;
+    machine.reconnecting = false;
+    machine.earlyLines.clear();
+
+    // Fail fast instead of letting callers wait for their timeout:
+    std::deque<Command> queue;
+    queue.swap(machine.queue);
+    for (Command& command : queue) {
+        if (command.callback) {
+            command.callback(nullptr);
+        }
+    }
+    schedule_reconnect(id);
+}
+
+void EventLoop::schedule_reconnect(MachineId id) {
+    std::chrono::nanoseconds delay = std::max(machines[id]->supervisor.get_next_attempt() - std::chrono::steady_clock::now(), std::chrono::nanoseconds{0});
+    add_timer(delay, [this, id]() { reconnect(id); });
+}
+
+void EventLoop::reconnect(MachineId id) {
+    Machine& machine = *machines[id];
+    assert(machine.state == MachineState::FAILED);
+    try {
+        machine.connection->reopen();
+        add_to_epoll(epollFd, machine.connection->get_fd(), id);
+    } catch (const std::exception& e) {
+        SPDLOG_DEBUG("Reopening machine {} failed with: {}", id, e.what());
+        machine.connection->mark_error();
+        machine.supervisor.on_reconnect_failed(std::chrono::steady_clock::now());
+        schedule_reconnect(id);
+        return;
+    }
+    machine.decoder.reset();
+    machine.framer.clear();
+    machine.state = MachineState::IDLE;
+    machine.reconnecting = true;
+
+    // The coffee maker has to respond again, before the machine accepts commands:
+    machine.queue.push_front(make_command(jutta_command_t::GET_TYPE, [this, id](std::shared_ptr<std::string> response) {
+        Machine& machine = *machines[id];
+        if (!response) {
+            fail(id, machine);
+            return;
+        }
+        machine.reconnecting = false;
+        machine.supervisor.on_reconnected(std::chrono::steady_clock::now());
+    },
+                                          RECONNECT_PROBE_TIMEOUT));
+}
+
+void EventLoop::fire_timers(TimePoint now) {
+    while (!timers.empty() && timers.begin()->first.first <= now) {
+        TimerCallback callback = std::move(timers.begin()->second);
+        timerDeadlines.erase(timers.begin()->first.second);
+        timers.erase(timers.begin());
+        callback();
+    }
+}
+
+EventLoop::TimePoint EventLoop::next_deadline(const Machine& machine) const {
+    TimePoint deadline = TimePoint::max();
+    switch (machine.state) {
+        case MachineState::TRANSMITTING:
+            deadline = machine.nextRelease;
+            break;
+        case MachineState::WAITING:
+            deadline = machine.responseDeadline;
+            break;
+        default:
+            break;
+    }
+    if (machine.decoder.buffered() > 0) {
+        deadline = std::min(deadline, machine.lastRx + LINE_QUIET_TIME);
+    }
+    return deadline;
+}
+
+void EventLoop::arm_timer() {
+    TimePoint deadline = timers.empty() ? TimePoint::max() : timers.begin()->first.first;
+    for (const std::unique_ptr<Machine>& machine : machines) {
+        deadline = std::min(deadline, next_deadline(*machine));
+    }
+    if (deadline == armedDeadline) {
+        return;
+    }
+    armedDeadline = deadline;
+    itimerspec spec{};
+    if (deadline != TimePoint::max()) {
+        // std::chrono::steady_clock is based on CLOCK_MONOTONIC on Linux. A zero value would disarm the timer:
+        std::chrono::nanoseconds sinceEpoch = std::max(deadline.time_since_epoch(), std::chrono::nanoseconds{1});
+        spec.it_value.tv_sec = static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count());
+        spec.it_value.tv_nsec = static_cast<long>((sinceEpoch - std::chrono::seconds{spec.it_value.tv_sec}).count());
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,79 @@
+#include "jutta_proto/FrameRouter.hpp"
+
+#include <algorithm>
+#include <utility>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+FrameRouter::SubscriptionId FrameRouter::subscribe(std::string prefix, Handler&& handler) {
+    std::unique_lock<std::mutex> lk(lock);
+    std::shared_ptr<Subscriptions> updated = std::make_shared<Subscriptions>(*subscriptions);
+    SubscriptionId id = nextId++;
+    updated->push_back(Subscription{id, std::move(prefix), std::move(handler)});
+    subscriptions = std::move(updated);
+    return id;
+}
+
+bool FrameRouter::unsubscribe(SubscriptionId id) {
+    std::unique_lock<std::mutex> lk(lock);
+    std::shared_ptr<Subscriptions> updated = std::make_shared<Subscriptions>(*subscriptions);
+    Subscriptions::iterator it = std::find_if(updated->begin(), updated->end(), [id](const Subscription& s) { return s.id == id; });
+    if (it == updated->end()) {
+        return false;
+    }
+    updated->erase(it);
+    subscriptions = std::move(updated);
+    return true;
+}
+
+void FrameRouter::set_unsolicited_prefixes(std::vector<std::string>&& prefixes) {
+    std::unique_lock<std::mutex> lk(lock);
+    unsolicitedPrefixes = std::move(prefixes);
+}
+
+bool FrameRouter::route(std::string_view frame, std::string_view expected) {
+    bool reply = expected.empty() ? !is_unsolicited(frame) : frame.find(expected) != std::string_view::npos;
+    if (reply) {
+        std::unique_lock<std::mutex> lk(lock);
+        stats.replies++;
+        return true;
+    }
+    static_cast<void>(dispatch(frame));
+    return false;
+}
+
+size_t FrameRouter::dispatch(std::string_view frame) {
+    std::shared_ptr<const Subscriptions> current;
+    {
+        std::unique_lock<std::mutex> lk(lock);
+        current = subscriptions;
+    }
+    size_t count = 0;
+    for (const Subscription& subscription : *current) {
+        if (frame.starts_with(subscription.prefix)) {
+            subscription.handler(frame);
+            count++;
+        }
+    }
+    std::unique_lock<std::mutex> lk(lock);
+    if (count > 0) {
+        stats.dispatched++;
+    } else {
+        stats.unrouted++;
+    }
+    return count;
+}
+
+bool FrameRouter::is_unsolicited(std::string_view frame) const {
+    std::unique_lock<std::mutex> lk(lock);
+    return std::any_of(unsolicitedPrefixes.begin(), unsolicitedPrefixes.end(), [frame](const std::string& prefix) { return frame.starts_with(prefix); });
+}
+
+FrameRouter::Stats FrameRouter::get_stats() const {
+    std::unique_lock<std::mutex> lk(lock);
+    return stats;
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
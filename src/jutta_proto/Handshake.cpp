@@ -0,0 +1,129 @@
+#include "jutta_proto/Handshake.hpp"
+#include "logger/Logger.hpp"
+
+#include <utility>
+#include <variant>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+Handshake::Handshake() : Handshake(Config{}) {}
+
+Handshake::Handshake(Config config) : config(std::move(config)) {}
+
+std::string_view Handshake::start(TimePoint now) {
+    state = handshake_state_t::WAIT_START;
+    failedIn = handshake_state_t::IDLE;
+    timing = Timing{};
+    keyExchange.reset();
+    token.reset();
+    started = now;
+    phaseStarted = now;
+    deadline = now + config.startTimeout;
+    return START_REQUEST;
+}
+
+Handshake::Step Handshake::on_frame(std::string_view frame, TimePoint now) {
+    Step step;
+    switch (state) {
+        case handshake_state_t::WAIT_START:
+            if (classify_response(frame) == response_kind_t::HANDSHAKE_START) {
+                advance(handshake_state_t::WAIT_KEY_EXCHANGE, &Timing::start, config.keyExchangeTimeout, now);
+                step.consumed = true;
+            }
+            break;
+
+        case handshake_state_t::WAIT_KEY_EXCHANGE:
+            if (classify_response(frame) == response_kind_t::KEY_EXCHANGE) {
+                ParsedResponse parsed = parse_response(frame);
+                if (const KeyExchangeResponse* key = std::get_if<KeyExchangeResponse>(&parsed)) {
+                    keyExchange = *key;
+                    advance(handshake_state_t::WAIT_END, &Timing::keyExchange, config.endTimeout, now);
+                    step.send = config.keyExchangeResponse;
+                } else {
+                    SPDLOG_WARN("Ignoring malformed key exchange request.");
+                }
+                step.consumed = true;
+            }
+            break;
+
+        case handshake_state_t::WAIT_END:
+            if (classify_response(frame) == response_kind_t::HANDSHAKE_END) {
+                ParsedResponse parsed = parse_response(frame);
+                if (const HandshakeEndResponse* end = std::get_if<HandshakeEndResponse>(&parsed)) {
+                    token = end->token;
+                    advance(handshake_state_t::DONE, &Timing::end, std::chrono::milliseconds{0}, now);
+                    deadline = TimePoint::max();
+                    timing.total = std::chrono::duration_cast<std::chrono::microseconds>(now - started);
+                    step.send = END_RESPONSE;
+                    SPDLOG_DEBUG("Handshake done after {}us.", timing.total.count());
+                } else {
+                    SPDLOG_WARN("Ignoring malformed handshake end.");
+                }
+                step.consumed = true;
+            }
+            break;
+
+        default:
+            break;
+    }
+    return step;
+}
+
+bool Handshake::on_tick(TimePoint now) {
+    if (now < deadline) {
+        return false;
+    }
+    SPDLOG_WARN("Handshake timed out in state {}.", to_string(state));
+    failedIn = state;
+    state = handshake_state_t::FAILED;
+    deadline = TimePoint::max();
+    timing.total = std::chrono::duration_cast<std::chrono::microseconds>(now - started);
+    return true;
+}
+
+void Handshake::advance(handshake_state_t next, std::chrono::microseconds Timing::*phase, const std::chrono::milliseconds& timeout, TimePoint now) {
+    timing.*phase = std::chrono::duration_cast<std::chrono::microseconds>(now - phaseStarted);
+    state = next;
+    phaseStarted = now;
+    deadline = now + timeout;
+}
+
+handshake_state_t Handshake::get_state() const { return state; }
+
+handshake_state_t Handshake::get_failed_state() const { return failedIn; }
+
+bool Handshake::is_done() const { return state == handshake_state_t::DONE; }
+
+bool Handshake::is_finished() const { return state == handshake_state_t::DONE || state == handshake_state_t::FAILED; }
+
+Handshake::TimePoint Handshake::get_deadline() const { return deadline; }
+
+const Handshake::Timing& Handshake::get_timing() const { return timing; }
+
+const Handshake::Config& Handshake::get_config() const { return config; }
+
+const std::optional<KeyExchangeResponse>& Handshake::get_key_exchange() const { return keyExchange; }
+
+const std::optional<std::array<uint8_t, 2>>& Handshake::get_token() const { return token; }
+
+std::string_view Handshake::to_string(handshake_state_t state) {
+    switch (state) {
+        case handshake_state_t::IDLE:
+            return "IDLE";
+        case handshake_state_t::WAIT_START:
+            return "WAIT_START";
+        case handshake_state_t::WAIT_KEY_EXCHANGE:
+            return "WAIT_KEY_EXCHANGE";
+        case handshake_state_t::WAIT_END:
+            return "WAIT_END";
+        case handshake_state_t::DONE:
+            return "DONE";
+        case handshake_state_t::FAILED:
+            return "FAILED";
+    }
+    return "UNKNOWN";
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
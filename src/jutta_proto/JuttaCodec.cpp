@@ -0,0 +1,128 @@
+#include "jutta_proto/JuttaCodec.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+size_t encode_block(std::span<const uint8_t> data, std::span<uint8_t> out) {
+    const size_t count = std::min(data.size(), out.size() / WIRE_QUAD_SIZE);
+    uint8_t* dst = out.data();
+    for (size_t i = 0; i < count; i++) {
+        std::memcpy(dst, ENCODE_TABLE[data[i]].data(), WIRE_QUAD_SIZE);
+        dst += WIRE_QUAD_SIZE;
+    }
+    return count * WIRE_QUAD_SIZE;
+}
+
+std::vector<uint8_t> encode_block(std::span<const uint8_t> data) {
+    std::vector<uint8_t> wire(data.size() * WIRE_QUAD_SIZE);
+    static_cast<void>(encode_block(data, wire));
+    return wire;
+}
+
+size_t decode_block(std::span<const uint8_t> wire, std::span<uint8_t> out) {
+    if constexpr (has_simd_decoder()) {
+        return decode_block_simd(wire, out);
+    }
+    return decode_block_table(wire, out);
+}
+
+size_t decode_block_table(std::span<const uint8_t> wire, std::span<uint8_t> out) {
+    const size_t count = std::min(wire.size() / WIRE_QUAD_SIZE, out.size());
+    const uint8_t* src = wire.data();
+    for (size_t i = 0; i < count; i++) {
+        out[i] = decode_table(src);
+        src += WIRE_QUAD_SIZE;
+    }
+    return count;
+}
+
+#if defined(__SSE2__)
+/**
+ * Decodes 64 wire bytes (16 quads) into 16 data bytes.
+ * For every wire byte we extract the two data bits (5 and 2) into bit 1 and 0 of the same byte.
+ * Afterwards the four 2 bit values of each quad (32 bit lane) get folded into the lowest byte of the lane
+ * and all lanes get packed together.
+ **/
+static inline __m128i decode_quads_sse2(__m128i v) {
+    const __m128i mask1 = _mm_set1_epi8(0b01);
+    const __m128i mask2 = _mm_set1_epi8(0b10);
+    // There is no 8 bit shift in SSE2, but masking afterwards removes the bits shifted in from the neighbouring byte:
+    __m128i pairs = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), mask2), _mm_and_si128(_mm_srli_epi16(v, 2), mask1));
+    // p0 | p1 << 2 in the lower byte of each 16 bit lane:
+    pairs = _mm_and_si128(_mm_or_si128(pairs, _mm_srli_epi16(pairs, 6)), _mm_set1_epi16(0x0F));
+    // (p0 | p1 << 2) | (p2 | p3 << 2) << 4 in the lower byte of each 32 bit lane:
+    return _mm_and_si128(_mm_or_si128(pairs, _mm_srli_epi32(pairs, 12)), _mm_set1_epi32(0xFF));
+}
+
+size_t decode_block_simd(std::span<const uint8_t> wire, std::span<uint8_t> out) {
+    constexpr size_t VEC_WIRE = 64;
+    constexpr size_t VEC_DATA = VEC_WIRE / WIRE_QUAD_SIZE;
+    const size_t count = std::min(wire.size() / WIRE_QUAD_SIZE, out.size());
+    const uint8_t* src = wire.data();
+    uint8_t* dst = out.data();
+
+    size_t i = 0;
+    for (; i + VEC_DATA <= count; i += VEC_DATA) {
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        const __m128i* in = reinterpret_cast<const __m128i*>(src);
+        __m128i a = decode_quads_sse2(_mm_loadu_si128(in));
+        __m128i b = decode_quads_sse2(_mm_loadu_si128(in + 1));
+        __m128i c = decode_quads_sse2(_mm_loadu_si128(in + 2));
+        __m128i d = decode_quads_sse2(_mm_loadu_si128(in + 3));
+        // All values are <= 0xFF, so the saturation never kicks in:
+        __m128i res = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), res);
+        src += VEC_WIRE;
+        dst += VEC_DATA;
+    }
+    return i + decode_block_table(wire.subspan(i * WIRE_QUAD_SIZE), out.subspan(i, count - i));
+}
+#elif defined(__ARM_NEON)
+/**
+ * Decodes 16 wire bytes (4 quads) into four data bytes, each one stored in its own 32 bit lane.
+ * For every wire byte we extract the two data bits (5 and 2) into bit 1 and 0 of the same byte,
+ * shift them to their position inside the resulting data byte and add up all four bytes of a quad.
+ **/
+static inline uint32x4_t decode_quads_neon(uint8x16_t v) {
+    static const int8_t SHIFTS[16] = {0, 2, 4, 6, 0, 2, 4, 6, 0, 2, 4, 6, 0, 2, 4, 6};
+    uint8x16_t pairs = vorrq_u8(vandq_u8(vshrq_n_u8(v, 4), vdupq_n_u8(0b10)), vandq_u8(vshrq_n_u8(v, 2), vdupq_n_u8(0b01)));
+    pairs = vshlq_u8(pairs, vld1q_s8(SHIFTS));
+    // The bits do not overlap, so adding them up equals or-ing them:
+    return vpaddlq_u16(vpaddlq_u8(pairs));
+}
+
+size_t decode_block_simd(std::span<const uint8_t> wire, std::span<uint8_t> out) {
+    constexpr size_t VEC_WIRE = 32;
+    constexpr size_t VEC_DATA = VEC_WIRE / WIRE_QUAD_SIZE;
+    const size_t count = std::min(wire.size() / WIRE_QUAD_SIZE, out.size());
+    const uint8_t* src = wire.data();
+    uint8_t* dst = out.data();
+
+    size_t i = 0;
+    for (; i + VEC_DATA <= count; i += VEC_DATA) {
+        uint32x4_t a = decode_quads_neon(vld1q_u8(src));
+        uint32x4_t b = decode_quads_neon(vld1q_u8(src + 16));
+        vst1_u8(dst, vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b))));
+        src += VEC_WIRE;
+        dst += VEC_DATA;
+    }
+    return i + decode_block_table(wire.subspan(i * WIRE_QUAD_SIZE), out.subspan(i, count - i));
+}
+#else
+size_t decode_block_simd(std::span<const uint8_t> wire, std::span<uint8_t> out) {
+    return decode_block_table(wire, out);
+}
+#endif
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
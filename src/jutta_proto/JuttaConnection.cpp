@@ -1,11 +1,15 @@
 #include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/JuttaCodec.hpp"
+#include "jutta_proto/JuttaCommands.hpp"
+#include "serial/LoopbackConnection.hpp"
+#include "serial/PtyConnection.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdio>
+#include <exception>
 #include <optional>
-#include <sstream>
 #include <string>
 #include <thread>
 #include <spdlog/spdlog.h>
@@ -13,104 +17,405 @@
 //---------------------------------------------------------------------------
 namespace jutta_proto {
 //---------------------------------------------------------------------------
-JuttaConnection::JuttaConnection(std::string&& device) : serial(std::move(device)) {}
-
-void JuttaConnection::init() {
+template <serial::Transport T>
+void BasicJuttaConnection<T>::init() {
     actionLock.lock();
     serial.init();
     actionLock.unlock();
 }
 
-bool JuttaConnection::read_decoded(std::vector<uint8_t>& data) {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::read_decoded(std::vector<uint8_t>& data) {
+    actionLock.lock();
+    bool result = ensure_link_unsafe() && read_decoded_unsafe(data);
+    check_link_unsafe();
+    actionLock.unlock();
+    return result;
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::read_decoded(uint8_t* byte) {
+    actionLock.lock();
+    bool result = ensure_link_unsafe() && read_decoded_unsafe(byte);
+    check_link_unsafe();
+    actionLock.unlock();
+    return result;
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::set_inter_quad_gap(const std::chrono::nanoseconds& gap) {
+    actionLock.lock();
+    pacer.set_inter_quad_gap(gap);
+    quadPeriod = pacer.get_period();
+    actionLock.unlock();
+}
+
+template <serial::Transport T>
+TransmitPacer::Stats BasicJuttaConnection<T>::get_pacing_stats() {
+    actionLock.lock();
+    TransmitPacer::Stats stats = pacer.get_stats();
+    actionLock.unlock();
+    return stats;
+}
+
+template <serial::Transport T>
+StreamDecoder::Stats BasicJuttaConnection<T>::get_decoder_stats() {
+    actionLock.lock();
+    StreamDecoder::Stats stats = decoder.get_stats();
+    actionLock.unlock();
+    return stats;
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::reconnect() {
     actionLock.lock();
-    bool result = read_decoded_unsafe(data);
+    if (serial.get_state() == serial::SC_READY && !supervisor.is_down()) {
+        serial.mark_error();
+    }
+    supervisor.link_down(std::chrono::steady_clock::now());
+    bool result = reconnect_unsafe();
     actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::read_decoded(uint8_t* byte) {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::is_link_up() {
     actionLock.lock();
-    bool result = read_decoded_unsafe(byte);
+    bool result = serial.get_state() == serial::SC_READY && !supervisor.is_down();
     actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::read_decoded_unsafe(uint8_t* byte) const {
-    std::array<uint8_t, 4> buffer{};
-    if (!read_encoded_unsafe(buffer)) {
+template <serial::Transport T>
+LinkSupervisor::Stats BasicJuttaConnection<T>::get_link_stats() {
+    actionLock.lock();
+    LinkSupervisor::Stats stats = supervisor.get_stats();
+    actionLock.unlock();
+    return stats;
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::set_link_config(const LinkSupervisor::Config& config) {
+    actionLock.lock();
+    supervisor = LinkSupervisor(config);
+    actionLock.unlock();
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::ensure_link_unsafe() {
+    if (serial.get_state() == serial::SC_READY && !supervisor.is_down()) {
+        return true;
+    }
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    supervisor.link_down(now);
+    // Fail fast until the next reconnect attempt is due:
+    if (!supervisor.attempt_due(now)) {
+        return false;
+    }
+    return reconnect_unsafe();
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::begin_command_unsafe() {
+    if (!ensure_link_unsafe()) {
         return false;
     }
-    *byte = decode(buffer);
+    static_cast<void>(read_available_unsafe());
+    for (std::optional<std::string_view> line = framer.next(); line; line = framer.next()) {
+        if (!router.is_unsolicited(*line)) {
+            if (rtt.on_late_reply()) {
+                SPDLOG_DEBUG("Late response: {}", *line);
+            } else {
+                SPDLOG_DEBUG("Unexpected response: {}", *line);
+            }
+        }
+        static_cast<void>(router.dispatch(*line));
+    }
+    rtt.on_sent();
     return true;
 }
 
-bool JuttaConnection::read_decoded_unsafe(std::vector<uint8_t>& data) const {
-    // Read encoded data:
-    std::vector<std::array<uint8_t, 4>> dataBuffer;
-    if (read_encoded_unsafe(dataBuffer) <= 0) {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::reconnect_unsafe() {
+    assert(supervisor.is_down());
+    try {
+        serial.reopen();
+    } catch (const std::exception& e) {
+        SPDLOG_DEBUG("Reopening failed with: {}", e.what());
+        supervisor.on_reconnect_failed(std::chrono::steady_clock::now());
         return false;
     }
+    metrics.on_decoder_stats(decoder.get_stats());
+    decoder.reset();
+    metrics.on_decoder_reset();
+    framer.clear();
+
+    // The coffee maker has to respond again, before the link is usable:
+    if (write_command_unsafe(jutta_command_t::GET_TYPE) && wait_for_response_unsafe(get_command_info(jutta_command_t::GET_TYPE).response, RECONNECT_PROBE_TIMEOUT)) {
+        supervisor.on_reconnected(std::chrono::steady_clock::now());
+        return true;
+    }
+    serial.mark_error();
+    supervisor.on_reconnect_failed(std::chrono::steady_clock::now());
+    return false;
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::check_link_unsafe() {
+    if (serial.get_state() == serial::SC_ERROR && !supervisor.is_down()) {
+        supervisor.on_error();
+        supervisor.link_down(std::chrono::steady_clock::now());
+    }
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::on_response_unsafe(bool received) {
+    if (serial.get_state() == serial::SC_ERROR) {
+        check_link_unsafe();
+    } else if (received) {
+        supervisor.on_success();
+    } else if (supervisor.on_timeout()) {
+        serial.mark_error();
+        supervisor.link_down(std::chrono::steady_clock::now());
+    }
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::read_decoded_unsafe(uint8_t* byte) {
+    if (framer.empty()) {
+        static_cast<void>(read_available_unsafe());
+        if (framer.empty()) {
+            return false;
+        }
+    }
+    *byte = framer.pending().front();
+    framer.consume(1);
+    return true;
+}
 
-    // Decode all:
-    for (const std::array<uint8_t, 4>& buffer : dataBuffer) {
-        data.push_back(decode(buffer));
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::read_decoded_unsafe(std::vector<uint8_t>& data) {
+    // Read until the line goes quiet:
+    do {
+        static_cast<void>(read_available_unsafe());
+    } while (serial.wait_readable(LINE_QUIET_TIME));
+    // A partial quad at this point will never be completed:
+    decoder.on_idle();
+    metrics.on_decoder_stats(decoder.get_stats());
+
+    if (framer.empty()) {
+        return false;
     }
+    std::span<const uint8_t> pending = framer.pending();
+    data.insert(data.end(), pending.begin(), pending.end());
+    framer.clear();
     SPDLOG_DEBUG("Read: {}", vec_to_string(data));
     return true;
 }
 
-bool JuttaConnection::write_decoded_unsafe(const uint8_t& byte) const {
-    return write_encoded_unsafe(encode(byte));
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_unsafe(const uint8_t& byte) {
+    return write_decoded_unsafe(std::span<const uint8_t>(&byte, 1));
 }
 
-bool JuttaConnection::write_decoded_unsafe(const std::vector<uint8_t>& data) const {
-    // Bad compiler support:
-    // return std::ranges::all_of(data.begin(), data.end(), [this](uint8_t byte) { return write_decoded_unsafe(byte); });
-    // So we use this until it gets better:
-    bool result = true;
-    for (uint8_t byte : data) {
-        if (!write_decoded_unsafe(byte)) {
-            result = false;
-        }
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_unsafe(const std::vector<uint8_t>& data) {
+    return write_decoded_unsafe(std::span<const uint8_t>(data));
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_unsafe(const std::string& data) {
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    return write_decoded_unsafe(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_unsafe(std::span<const uint8_t> data) {
+    if (capture) {
+        capture->record(capture_direction_t::TX, capture_layer_t::DECODED, data);
+    }
+    // Encode the whole message in one pass into the reused transmit buffer:
+    txBuffer.resize(data.size() * WIRE_QUAD_SIZE);
+    encode_block(data, txBuffer);
+    return write_encoded_unsafe(txBuffer);
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_command(jutta_command_t command) {
+    actionLock.lock();
+    bool result = ensure_link_unsafe() && write_command_unsafe(command);
+    if (result) {
+        metrics.on_sent(command);
+    }
+    check_link_unsafe();
+    actionLock.unlock();
+    return result;
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_command_wait_for(jutta_command_t command, const std::chrono::milliseconds& timeout) {
+    actionLock.lock();
+    bool result = begin_command_unsafe() && write_command_unsafe(command);
+    if (result) {
+        result = await_reply_unsafe(command, get_command_info(command).response, timeout).has_value();
     }
+    on_response_unsafe(result);
+    actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::write_decoded_unsafe(const std::string& data) const {
-    // Bad compiler support:
-    // return std::ranges::all_of(data.begin(), data.end(), [this](char c) { return write_decoded_unsafe(static_cast<uint8_t>(c)); });
-    // So we use this until it gets better:
-    bool result = true;
-    for (char c : data) {
-        if (!write_decoded_unsafe(static_cast<uint8_t>(c))) {
-            result = false;
+template <serial::Transport T>
+std::optional<typename BasicJuttaConnection<T>::Response> BasicJuttaConnection<T>::write_command_with_response(jutta_command_t command, const std::chrono::milliseconds& timeout) {
+    std::optional<Response> result{std::nullopt};
+    bool received = false;
+    actionLock.lock();
+    if (begin_command_unsafe() && write_command_unsafe(command)) {
+        std::optional<std::string_view> line = await_reply_unsafe(command, "", timeout);
+        received = line.has_value();
+        if (line) {
+            result.emplace();
+            if (!result->assign(*line)) {
+                SPDLOG_WARN("Response with {} bytes does not fit into a response of {} bytes.", line->size(), Response::capacity());
+                result.reset();
+            }
         }
     }
+    on_response_unsafe(received);
+    actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::write_decoded(const uint8_t& byte) {
+template <serial::Transport T>
+RttEstimator::CommandStats BasicJuttaConnection<T>::get_rtt_stats(std::optional<jutta_command_t> command) {
+    actionLock.lock();
+    RttEstimator::CommandStats stats = rtt.get_stats(command);
+    actionLock.unlock();
+    return stats;
+}
+
+template <serial::Transport T>
+MetricsSnapshot BasicJuttaConnection<T>::get_metrics() const {
+    return metrics.get_snapshot(serial.get_wire_counters());
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::set_capture(std::shared_ptr<WireCapture> capture) {
     actionLock.lock();
-    bool result = write_decoded_unsafe(byte);
+    this->capture = std::move(capture);
+    actionLock.unlock();
+}
+
+template <serial::Transport T>
+BasicJuttaConnection<T>::~BasicJuttaConnection() {
+    stop_keep_alive();
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::start_keep_alive(const KeepAliveScheduler::Config& config, KeepAliveSource&& source) {
+    assert(source);
+    stop_keep_alive();
+    keepAliveMutex.lock();
+    keepAlive = KeepAliveScheduler(config);
+    keepAlive.start(std::chrono::steady_clock::now());
+    keepAliveSource = std::move(source);
+    keepAliveStop = false;
+    keepAliveMutex.unlock();
+    keepAliveThread = std::thread([this]() { keep_alive_loop(); });
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::stop_keep_alive() {
+    keepAliveMutex.lock();
+    keepAliveStop = true;
+    keepAliveMutex.unlock();
+    keepAliveCondition.notify_all();
+    if (keepAliveThread.joinable()) {
+        keepAliveThread.join();
+    }
+}
+
+template <serial::Transport T>
+KeepAliveScheduler::Stats BasicJuttaConnection<T>::get_keep_alive_stats() {
+    keepAliveMutex.lock();
+    KeepAliveScheduler::Stats stats = keepAlive.get_stats();
+    keepAliveMutex.unlock();
+    return stats;
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::keep_alive_loop() {
+    std::unique_lock<std::mutex> lk(keepAliveMutex);
+    while (true) {
+        // Use a copy, since the due time may not change while waiting:
+        const KeepAliveScheduler::TimePoint due = keepAlive.get_next_due();
+        if (keepAliveCondition.wait_until(lk, due, [this] { return keepAliveStop; })) {
+            break;
+        }
+        keepAliveFrame.clear();
+        keepAliveSource(keepAliveFrame);
+        // Every data byte gets send as one quad:
+        const std::chrono::microseconds airTime = std::chrono::duration_cast<std::chrono::microseconds>(quadPeriod.load() * static_cast<int64_t>(keepAliveFrame.size()));
+        const bool overtake = keepAlive.may_overtake(airTime);
+        lk.unlock();
+
+        if (overtake) {
+            actionLock.lock_priority();
+        } else {
+            actionLock.lock();
+        }
+        const std::chrono::steady_clock::time_point sentAt = std::chrono::steady_clock::now();
+        // Do not try to reconnect here, since this would delay the commands way longer than the keep-alive itself:
+        const bool sent = serial.get_state() == serial::SC_READY && !supervisor.is_down() && write_decoded_unsafe(keepAliveFrame);
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        check_link_unsafe();
+        actionLock.unlock();
+
+        lk.lock();
+        if (sent) {
+            keepAlive.on_sent(sentAt, std::chrono::duration_cast<std::chrono::microseconds>(end - sentAt));
+        } else {
+            SPDLOG_DEBUG("Failed to send keep-alive.");
+            keepAlive.on_failed(end);
+        }
+    }
+}
+
+template <serial::Transport T>
+void BasicJuttaConnection<T>::set_rtt_config(const RttEstimator::Config& config) {
+    actionLock.lock();
+    rtt = RttEstimator(config);
+    actionLock.unlock();
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded(const uint8_t& byte) {
+    actionLock.lock();
+    bool result = ensure_link_unsafe() && write_decoded_unsafe(byte);
+    check_link_unsafe();
     actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::write_decoded(const std::vector<uint8_t>& data) {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded(const std::vector<uint8_t>& data) {
     actionLock.lock();
-    bool result = write_decoded_unsafe(data);
+    bool result = ensure_link_unsafe() && write_decoded_unsafe(data);
+    check_link_unsafe();
     actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::write_decoded(const std::string& data) {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded(const std::string& data) {
     actionLock.lock();
-    bool result = write_decoded_unsafe(data);
+    bool result = ensure_link_unsafe() && write_decoded_unsafe(data);
+    check_link_unsafe();
     actionLock.unlock();
     return result;
 }
 
-void JuttaConnection::print_byte(const uint8_t& byte) {
+template <serial::Transport T>
+void BasicJuttaConnection<T>::print_byte(const uint8_t& byte) {
     for (size_t i = 0; i < 8; i++) {
         SPDLOG_INFO("{} ", ((byte >> (7 - i)) & 0b00000001));
     }
@@ -118,22 +423,25 @@ void JuttaConnection::print_byte(const uint8_t& byte) {
     printf("-> %d\t%02x", byte, byte);
 }
 
-void JuttaConnection::print_bytes(const std::vector<uint8_t>& data) {
+template <serial::Transport T>
+void BasicJuttaConnection<T>::print_bytes(const std::vector<uint8_t>& data) {
     for (const uint8_t& byte : data) {
         print_byte(byte);
     }
 }
 
-void JuttaConnection::run_encode_decode_test() {
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::run_encode_decode_test() {
     bool success = true;
 
+    // Encoding and decoding of every possible byte value has to be reversable for all implementations:
     for (uint16_t i = 0b00000000; i <= 0b11111111; i++) {
-        if (i != decode(encode(i))) {
+        std::array<uint8_t, 4> dataEnc = encode_scalar(i);
+        if (dataEnc != encode_table(i) || i != decode_scalar(dataEnc) || i != decode_table(dataEnc.data())) {
             success = false;
             SPDLOG_ERROR("data:");
             print_byte(i);
 
-            std::array<uint8_t, 4> dataEnc = encode(i);
             for (size_t i = 0; i < 4; i++) {
                 SPDLOG_ERROR("dataEnc[{}]", i);
                 print_byte(dataEnc.at(i));
@@ -144,190 +452,365 @@ void JuttaConnection::run_encode_decode_test() {
             print_byte(dataDec);
         }
     }
-    // Flush the stdout to ensure the result gets printed when assert(success) fails:
-    SPDLOG_INFO("Encode decode test: {}", success);
-    assert(success);
-}
 
-std::array<uint8_t, 4> JuttaConnection::encode(const uint8_t& decData) {
-    // 1111 0000 -> 0000 1111:
-    uint8_t tmp = ((decData & 0xF0) >> 4) | ((decData & 0x0F) << 4);
-
-    // 1100 1100 -> 0011 0011:
-    tmp = ((tmp & 0xC0) >> 2) | ((tmp & 0x30) << 2) | ((tmp & 0x0C) >> 2) | ((tmp & 0x03) << 2);
-
-    // The base bit layout for all send bytes:
-    constexpr uint8_t BASE = 0b01011011;
-
-    std::array<uint8_t, 4> encData{};
-    encData[0] = BASE | ((tmp & 0b10000000) >> 2);
-    encData[0] |= ((tmp & 0b01000000) >> 4);
-
-    encData[1] = BASE | (tmp & 0b00100000);
-    encData[1] |= ((tmp & 0b00010000) >> 2);
-
-    encData[2] = BASE | ((tmp & 0b00001000) << 2);
-    encData[2] |= (tmp & 0b00000100);
-
-    encData[3] = BASE | ((tmp & 0b00000010) << 4);
-    encData[3] |= ((tmp & 0b00000001) << 2);
-
-    return encData;
+    // Every possible wire byte at every quad position has to be decoded the same way:
+    std::vector<uint8_t> wire;
+    std::vector<uint8_t> expected;
+    for (size_t pos = 0; pos < WIRE_QUAD_SIZE; pos++) {
+        for (uint16_t b = 0b00000000; b <= 0b11111111; b++) {
+            std::array<uint8_t, 4> quad{WIRE_BASE, WIRE_BASE, WIRE_BASE, WIRE_BASE};
+            quad[pos] = static_cast<uint8_t>(b);
+            wire.insert(wire.end(), quad.begin(), quad.end());
+            expected.push_back(decode_scalar(quad));
+        }
+    }
+    // Include the result of encode_block to also cover the encoding side:
+    std::vector<uint8_t> data(256);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i);
+    }
+    const size_t wireOffset = wire.size();
+    wire.resize(wireOffset + (data.size() * WIRE_QUAD_SIZE));
+    if (encode_block(data, std::span<uint8_t>(wire).subspan(wireOffset)) != data.size() * WIRE_QUAD_SIZE) {
+        success = false;
+        SPDLOG_ERROR("encode_block did not encode all bytes.");
+    }
+    expected.insert(expected.end(), data.begin(), data.end());
+
+    // Decode all prefixes, so every SIMD tail length gets covered as well:
+    std::vector<uint8_t> decTable(expected.size());
+    std::vector<uint8_t> decSimd(expected.size());
+    for (size_t len = 0; len <= expected.size(); len += (len < 128) ? 1 : 61) {
+        std::span<const uint8_t> in = std::span<const uint8_t>(wire).first(len * WIRE_QUAD_SIZE);
+        std::fill(decTable.begin(), decTable.end(), 0);
+        std::fill(decSimd.begin(), decSimd.end(), 0);
+        size_t countTable = decode_block_table(in, decTable);
+        size_t countSimd = decode_block_simd(in, decSimd);
+        if (countTable != len || countSimd != len || !std::equal(decTable.begin(), decTable.begin() + static_cast<std::ptrdiff_t>(len), expected.begin()) || decTable != decSimd) {
+            success = false;
+            SPDLOG_ERROR("Block decoding of {} quads differs (table: {}, SIMD: {}).", len, countTable, countSimd);
+        }
+    }
+    SPDLOG_INFO("Encode decode test (SIMD: {}): {}", has_simd_decoder(), success);
+    return success;
 }
 
-uint8_t JuttaConnection::decode(const std::array<uint8_t, 4>& encData) {
-    // Bit mask for the 2. bit from the left:
-    constexpr uint8_t B2_MASK = (0b10000000 >> 2);
-    // Bit mask for the 5. bit from the left:
-    constexpr uint8_t B5_MASK = (0b10000000 >> 5);
-
-    uint8_t decData = 0;
-    decData |= (encData[0] & B2_MASK) << 2;
-    decData |= (encData[0] & B5_MASK) << 4;
-
-    decData |= (encData[1] & B2_MASK);
-    decData |= (encData[1] & B5_MASK) << 2;
-
-    decData |= (encData[2] & B2_MASK) >> 2;
-    decData |= (encData[2] & B5_MASK);
-
-    decData |= (encData[3] & B2_MASK) >> 4;
-    decData |= (encData[3] & B5_MASK) >> 2;
-
-    // 1111 0000 -> 0000 1111:
-    decData = ((decData & 0xF0) >> 4) | ((decData & 0x0F) << 4);
+template <serial::Transport T>
+std::array<uint8_t, 4> BasicJuttaConnection<T>::encode(const uint8_t& decData) {
+    return encode_table(decData);
+}
 
-    // 1100 1100 -> 0011 0011:
-    decData = ((decData & 0xC0) >> 2) | ((decData & 0x30) << 2) | ((decData & 0x0C) >> 2) | ((decData & 0x03) << 2);
+template <serial::Transport T>
+uint8_t BasicJuttaConnection<T>::decode(const std::array<uint8_t, 4>& encData) {
+    return decode_table(encData.data());
+}
 
-    return decData;
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_command_unsafe(jutta_command_t command) {
+    if (capture) {
+        const std::string_view data = get_command_info(command).data;
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        capture->record(capture_direction_t::TX, capture_layer_t::DECODED, std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+    }
+    return write_encoded_unsafe(get_encoded_command(command));
 }
 
-bool JuttaConnection::write_encoded_unsafe(const std::array<uint8_t, 4>& encData) const {
-    bool result = serial.write_serial(encData);
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_encoded_unsafe(std::span<const uint8_t> wire) {
+    bool result = pacer.transmit(wire, [this](std::span<const uint8_t> quad) {
+        if (capture) {
+            capture->record(capture_direction_t::TX, capture_layer_t::WIRE, quad);
+        }
+        return serial.write_serial(quad) == quad.size();
+    });
+    // Wait until everything has been send, so waiting for the response starts afterwards:
     serial.flush();
-    std::this_thread::sleep_for(std::chrono::milliseconds{8});
     return result;
 }
 
-bool JuttaConnection::read_encoded_unsafe(std::array<uint8_t, 4>& buffer) const {
-    size_t size = serial.read_serial(buffer);
-    if (size <= 0 || size > 4) {
-        SPDLOG_TRACE("No serial data found.");
-        return false;
-    }
-    if (size < 4) {
-        SPDLOG_WARN("Invalid amount of UART data found ({} byte) - ignoring.", size);
-        return false;
+template <serial::Transport T>
+size_t BasicJuttaConnection<T>::read_available_unsafe() {
+    size_t total = 0;
+    while (true) {
+        // One read syscall for everything available:
+        const size_t freeSpace = serial.get_rx_buffer().free_space();
+        const size_t size = serial.fill_rx();
+        // Decode directly from the receive buffer:
+        for (std::span<const uint8_t> wire = serial.peek_rx(); !wire.empty(); wire = serial.peek_rx()) {
+            std::vector<uint8_t>& decoded = framer.input();
+            // Realigning might take back bytes of the previous call, so only the appended ones get recorded:
+            const size_t appended = decoder.feed(wire, decoded);
+            if (capture) {
+                const uint64_t timestamp = WireCapture::now();
+                capture->record(capture_direction_t::RX, capture_layer_t::WIRE, wire, timestamp);
+                capture->record(capture_direction_t::RX, capture_layer_t::DECODED, std::span<const uint8_t>(decoded).last(appended), timestamp);
+            }
+            serial.consume_rx(wire.size());
+            total += wire.size();
+        }
+        // Only in case the receive buffer got filled completely, there might be more data pending:
+        if (size <= 0 || size < freeSpace) {
+            break;
+        }
     }
-    SPDLOG_TRACE("Read 4 encoded bytes.");
-    return true;
+    metrics.on_decoder_stats(decoder.get_stats());
+    // Frames get dropped once new data gets appended to them:
+    metrics.on_framer_stats(framer.get_dropped_frames());
+    SPDLOG_TRACE("Read {} encoded bytes.", total);
+    return total;
 }
 
-size_t JuttaConnection::read_encoded_unsafe(std::vector<std::array<uint8_t, 4>>& data) const {
+template <serial::Transport T>
+std::optional<std::string_view> BasicJuttaConnection<T>::wait_for_line_unsafe(const std::chrono::milliseconds& timeout) {
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
     while (true) {
-        std::array<uint8_t, 4> buffer{};
-        if (!read_encoded_unsafe(buffer)) {
-            // Wait 100 ms for the next bunch of data to arrive:
-            std::this_thread::sleep_for(std::chrono::milliseconds{100});
-            if (!read_encoded_unsafe(buffer)) {
-                break;
+        // The framer only scans newly received bytes for the "\r\n" terminator:
+        std::optional<std::string_view> line = framer.next();
+        if (line) {
+            return line;
+        }
+        static_cast<void>(read_available_unsafe());
+        line = framer.next();
+        if (line) {
+            return line;
+        }
+        // Fail fast instead of waiting for the timeout in case the link broke:
+        if (serial.get_state() != serial::SC_READY) {
+            return std::nullopt;
+        }
+
+        std::chrono::milliseconds wait = LINE_QUIET_TIME;
+        if (timeout.count() > 0) {
+            std::chrono::milliseconds remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                return std::nullopt;
             }
+            wait = std::min(wait, remaining);
+        }
+        if (!serial.wait_readable(wait)) {
+            // The line went quiet, so a partial quad at this point will never be completed:
+            decoder.on_idle();
+            metrics.on_decoder_stats(decoder.get_stats());
         }
-        data.push_back(buffer);
     }
-    return data.size();
 }
 
-bool JuttaConnection::wait_for_ok(const std::chrono::milliseconds& timeout) {
+template <serial::Transport T>
+size_t BasicJuttaConnection<T>::dispatch_pending() {
     actionLock.lock();
-    bool result = wait_for_response_unsafe("ok:\r\n", timeout);
+    static_cast<void>(read_available_unsafe());
+    check_link_unsafe();
+    size_t count = 0;
+    for (std::optional<std::string_view> line = framer.next(); line; line = framer.next()) {
+        static_cast<void>(router.dispatch(*line));
+        count++;
+    }
     actionLock.unlock();
-    return result;
+    return count;
 }
 
-std::shared_ptr<std::string> JuttaConnection::write_decoded_with_response(const std::vector<uint8_t>& data, const std::chrono::milliseconds& timeout) {
-    std::shared_ptr<std::string> result{nullptr};
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::perform_handshake(Handshake& handshake) {
     actionLock.lock();
-    if (write_decoded_unsafe(data)) {
-        result = wait_for_str_unsafe(timeout);
+    bool result = ensure_link_unsafe() && perform_handshake_unsafe(handshake);
+    check_link_unsafe();
+    actionLock.unlock();
+    return result;
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::perform_handshake_unsafe(Handshake& handshake) {
+    std::string_view send = handshake.start(std::chrono::steady_clock::now());
+    while (true) {
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        if (!send.empty() && !write_decoded_unsafe(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(send.data()), send.size()))) {
+            return false;
+        }
+        if (handshake.is_finished()) {
+            break;
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (handshake.on_tick(now)) {
+            break;
+        }
+        // At least 1ms, since 0 would wait forever:
+        const std::chrono::milliseconds remaining = std::max(std::chrono::ceil<std::chrono::milliseconds>(handshake.get_deadline() - now), std::chrono::milliseconds{1});
+        std::optional<std::string_view> line = wait_for_line_unsafe(remaining);
+        send = {};
+        if (!line) {
+            if (serial.get_state() != serial::SC_READY) {
+                return false;
+            }
+            continue;
+        }
+        Handshake::Step step = handshake.on_frame(*line, std::chrono::steady_clock::now());
+        if (step.consumed) {
+            send = step.send;
+        } else {
+            static_cast<void>(router.dispatch(*line));
+        }
     }
+    return handshake.is_done();
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::wait_for_ok(const std::chrono::milliseconds& timeout) {
+    actionLock.lock();
+    bool result = ensure_link_unsafe() && wait_for_response_unsafe("ok:\r\n", timeout);
+    on_response_unsafe(result);
     actionLock.unlock();
     return result;
 }
 
-std::shared_ptr<std::string> JuttaConnection::write_decoded_with_response(const std::string& data, const std::chrono::milliseconds& timeout) {
+template <serial::Transport T>
+std::shared_ptr<std::string> BasicJuttaConnection<T>::write_decoded_with_response(const std::vector<uint8_t>& data, const std::chrono::milliseconds& timeout) {
     std::shared_ptr<std::string> result{nullptr};
     actionLock.lock();
-    if (write_decoded_unsafe(data)) {
-        result = wait_for_str_unsafe(timeout);
+    if (begin_command_unsafe() && write_decoded_unsafe(data)) {
+        std::optional<std::string_view> line = await_reply_unsafe(command_of(data), "", timeout);
+        if (line) {
+            result = std::make_shared<std::string>(*line);
+        }
     }
+    on_response_unsafe(result != nullptr);
     actionLock.unlock();
     return result;
 }
 
-std::shared_ptr<std::string> JuttaConnection::wait_for_str_unsafe(const std::chrono::milliseconds& timeout) const {
+template <serial::Transport T>
+std::shared_ptr<std::string> BasicJuttaConnection<T>::write_decoded_with_response(const std::string& data, const std::chrono::milliseconds& timeout) {
     std::shared_ptr<std::string> result{nullptr};
-    std::vector<uint8_t> buffer;
-    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-    // NOLINTNEXTLINE (hicpp-use-nullptr, modernize-use-nullptr)
-    while ((timeout.count() <= 0) || ((std::chrono::steady_clock::now() - start) < timeout)) {
-        if (read_decoded_unsafe(buffer)) {
-            result = std::make_shared<std::string>(vec_to_string(buffer));
-            break;
+    actionLock.lock();
+    if (begin_command_unsafe() && write_decoded_unsafe(data)) {
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        std::optional<std::string_view> line = await_reply_unsafe(command_of(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size())), "", timeout);
+        if (line) {
+            result = std::make_shared<std::string>(*line);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds{250});
     }
+    on_response_unsafe(result != nullptr);
+    actionLock.unlock();
     return result;
 }
 
-bool JuttaConnection::wait_for_response_unsafe(const std::string& response, const std::chrono::milliseconds& timeout) const {
-    std::vector<uint8_t> buffer;
-    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-    // NOLINTNEXTLINE (hicpp-use-nullptr, modernize-use-nullptr)
-    while ((timeout.count() <= 0) || ((std::chrono::steady_clock::now() - start) < timeout)) {
-        if (read_decoded_unsafe(buffer)) {
-            for (size_t i = 0; (buffer.size() >= response.size()) && (i < buffer.size() - (response.size() - 1)); i++) {
-                bool success = true;
-                for (size_t e = 0; e < response.size(); e++) {
-                    if (static_cast<char>(buffer[i + e]) != response[e]) {
-                        success = false;
-                        break;
-                    }
-                }
-                if (success) {
-                    return true;
-                }
+template <serial::Transport T>
+std::optional<std::string_view> BasicJuttaConnection<T>::wait_for_reply_unsafe(std::string_view expected, const std::chrono::milliseconds& timeout) {
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        std::chrono::milliseconds remaining{0};
+        if (timeout.count() > 0) {
+            remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) {
+                return std::nullopt;
             }
-            buffer.clear();
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds{250});
+        std::optional<std::string_view> line = wait_for_line_unsafe(remaining);
+        if (!line) {
+            return std::nullopt;
+        }
+        SPDLOG_DEBUG("Read: {}", *line);
+        // Unsolicited frames get handed to the subscribers:
+        if (router.route(*line, expected)) {
+            return line;
+        }
     }
-    return false;
 }
 
-bool JuttaConnection::write_decoded_wait_for(const std::string& data, const std::string& response, const std::chrono::milliseconds& timeout) {
+template <serial::Transport T>
+std::optional<std::string_view> BasicJuttaConnection<T>::await_reply_unsafe(std::optional<jutta_command_t> command, std::string_view expected, const std::chrono::milliseconds& timeout) {
+    metrics.on_sent(command);
+    const std::chrono::milliseconds deadline = (timeout == ADAPTIVE_TIMEOUT) ? rtt.get_deadline(command) : timeout;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::optional<std::string_view> line = wait_for_reply_unsafe(expected, deadline);
+    if (line) {
+        const std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        metrics.on_reply(command, elapsed);
+        if (rtt.on_reply(command, elapsed)) {
+            SPDLOG_DEBUG("Slow response after {}us.", elapsed.count());
+        }
+    } else if (serial.get_state() == serial::SC_READY) {
+        // Only a timeout in case the link did not break in the meantime:
+        rtt.on_timeout(command, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+        metrics.on_timeout(command);
+        SPDLOG_DEBUG("No response within {}ms.", deadline.count());
+    }
+    return line;
+}
+
+template <serial::Transport T>
+std::optional<jutta_command_t> BasicJuttaConnection<T>::command_of(std::span<const uint8_t> data) {
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    return find_command(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::wait_for_response_unsafe(std::string_view response, const std::chrono::milliseconds& timeout) {
+    return wait_for_reply_unsafe(response, timeout).has_value();
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_wait_for(const std::vector<uint8_t>& data, const std::string& response, const std::chrono::milliseconds& timeout) {
+    return write_decoded_wait_for(std::span<const uint8_t>(data), std::string_view(response), timeout);
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_wait_for(const std::string& data, const std::string& response, const std::chrono::milliseconds& timeout) {
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    return write_decoded_wait_for(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size()), std::string_view(response), timeout);
+}
+
+template <serial::Transport T>
+bool BasicJuttaConnection<T>::write_decoded_wait_for(std::span<const uint8_t> data, std::string_view response, const std::chrono::milliseconds& timeout) {
     actionLock.lock();
-    bool result = write_decoded_unsafe(data);
+    bool result = begin_command_unsafe() && write_decoded_unsafe(data);
     if (result) {
-        result = wait_for_response_unsafe(response, timeout);
+        result = await_reply_unsafe(command_of(data), response, timeout).has_value();
     }
+    on_response_unsafe(result);
     actionLock.unlock();
     return result;
 }
 
-std::string JuttaConnection::vec_to_string(const std::vector<uint8_t>& data) {
-    if (data.empty()) {
-        return "";
+template <serial::Transport T>
+std::optional<size_t> BasicJuttaConnection<T>::write_decoded_with_response(std::span<const uint8_t> data, std::span<char> response, const std::chrono::milliseconds& timeout) {
+    std::optional<size_t> result{std::nullopt};
+    bool received = false;
+    actionLock.lock();
+    if (begin_command_unsafe() && write_decoded_unsafe(data)) {
+        std::optional<std::string_view> line = await_reply_unsafe(command_of(data), "", timeout);
+        received = line.has_value();
+        if (line && line->size() <= response.size()) {
+            std::copy(line->begin(), line->end(), response.begin());
+            result = line->size();
+        } else if (line) {
+            SPDLOG_WARN("Response with {} bytes does not fit into the given buffer of {} bytes.", line->size(), response.size());
+        }
     }
+    on_response_unsafe(received);
+    actionLock.unlock();
+    return result;
+}
 
-    std::ostringstream sstream;
-    for (unsigned char i : data) {
-        sstream << static_cast<char>(i);
+template <serial::Transport T>
+std::optional<typename BasicJuttaConnection<T>::Response> BasicJuttaConnection<T>::write_decoded_with_fixed_response(std::span<const uint8_t> data, const std::chrono::milliseconds& timeout) {
+    Response response;
+    std::optional<size_t> len = write_decoded_with_response(data, response.buffer(), timeout);
+    if (!len) {
+        return std::nullopt;
     }
-    return sstream.str();
+    response.resize(*len);
+    return response;
+}
+
+template <serial::Transport T>
+std::string BasicJuttaConnection<T>::vec_to_string(const std::vector<uint8_t>& data) {
+    return std::string(data.begin(), data.end());
 }
 
+// Explicit instantiations for all transports shipped with the serial library:
+template class BasicJuttaConnection<serial::SerialConnection>;
+template class BasicJuttaConnection<serial::PtyConnection>;
+template class BasicJuttaConnection<serial::LoopbackConnection>;
 //---------------------------------------------------------------------------
 }  // namespace jutta_proto
 //---------------------------------------------------------------------------
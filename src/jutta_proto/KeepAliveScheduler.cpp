@@ -0,0 +1,62 @@
+#include "jutta_proto/KeepAliveScheduler.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+KeepAliveScheduler::KeepAliveScheduler() : KeepAliveScheduler(Config{}) {}
+
+KeepAliveScheduler::KeepAliveScheduler(const Config& config) : config(config) {
+    assert(config.interval.count() > 0);
+}
+
+void KeepAliveScheduler::start(TimePoint now) { nextDue = now + config.interval; }
+
+KeepAliveScheduler::TimePoint KeepAliveScheduler::get_next_due() const { return nextDue; }
+
+bool KeepAliveScheduler::is_due(TimePoint now) const { return now >= nextDue; }
+
+bool KeepAliveScheduler::may_overtake(std::chrono::microseconds airTime) {
+    if (airTime <= config.maxCommandDelay) {
+        return true;
+    }
+    stats.yielded++;
+    return false;
+}
+
+bool KeepAliveScheduler::on_sent(TimePoint sentAt, std::chrono::microseconds airTime) {
+    const std::chrono::microseconds lateness = std::max(std::chrono::duration_cast<std::chrono::microseconds>(sentAt - nextDue), std::chrono::microseconds{0});
+    stats.sent++;
+    stats.lastLateness = lateness;
+    stats.maxLateness = std::max(stats.maxLateness, lateness);
+    stats.lastAirTime = airTime;
+    const bool missed = lateness > config.maxLateness;
+    if (missed) {
+        stats.missed++;
+        SPDLOG_WARN("Keep-alive missed its deadline by {}ms.", std::chrono::duration_cast<std::chrono::milliseconds>(lateness).count());
+        // Start over instead of sending the backlog back to back:
+        nextDue = sentAt + config.interval;
+    } else {
+        // Keep the original schedule, so lateness does not add up:
+        nextDue += config.interval;
+    }
+    if (airTime > config.maxCommandDelay) {
+        SPDLOG_WARN("Keep-alive took {}us to transmit, more than the allowed command delay of {}ms.", airTime.count(), config.maxCommandDelay.count());
+    }
+    return missed;
+}
+
+void KeepAliveScheduler::on_failed(TimePoint now) {
+    stats.failed++;
+    nextDue = now + config.interval;
+}
+
+const KeepAliveScheduler::Stats& KeepAliveScheduler::get_stats() const { return stats; }
+
+const KeepAliveScheduler::Config& KeepAliveScheduler::get_config() const { return config; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
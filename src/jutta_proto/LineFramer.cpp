@@ -0,0 +1,89 @@
+#include "jutta_proto/LineFramer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+LineFramer::LineFramer(size_t capacity, size_t maxFrameSize) : maxFrameSize(maxFrameSize) {
+    assert(maxFrameSize > 0);
+    buffer.reserve(capacity);
+}
+
+std::vector<uint8_t>& LineFramer::input() {
+    // Only drop what next() already searched for a terminator (e.g. not the pending bytes read without it):
+    if (scanned >= buffer.size() && buffer.size() - head > maxFrameSize) {
+        if (!discarding) {
+            droppedFrames++;
+            discarding = true;
+        }
+        // Keep the last byte, since it might be the "\r" of the terminator ending the dropped frame:
+        head = buffer.size() - 1;
+    }
+    if (head >= buffer.size()) {
+        buffer.clear();
+        head = 0;
+        scanned = 0;
+    } else if (head > 0) {
+        // Only the incomplete frame remains, which is usually just a few bytes:
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(head));
+        scanned -= head;
+        head = 0;
+    }
+    return buffer;
+}
+
+std::optional<std::string_view> LineFramer::next() {
+    // The "\n" can not be the first byte of a frame:
+    size_t start = std::max(scanned - std::min(scanned, RESCAN_SIZE), head + 1);
+    if (start >= buffer.size()) {
+        return std::nullopt;
+    }
+    while (true) {
+        const void* pos = std::memchr(buffer.data() + start, '\n', buffer.size() - start);
+        if (!pos) {
+            scanned = buffer.size();
+            return std::nullopt;
+        }
+        const size_t end = static_cast<size_t>(static_cast<const uint8_t*>(pos) - buffer.data()) + 1;
+        if (buffer[end - 2] == '\r' && discarding) {
+            // The rest of a dropped frame:
+            head = end;
+            scanned = end;
+            discarding = false;
+            return next();
+        }
+        if (buffer[end - 2] == '\r') {
+            // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+            std::string_view frame(reinterpret_cast<const char*>(buffer.data() + head), end - head);
+            head = end;
+            scanned = end;
+            return frame;
+        }
+        start = end;
+    }
+}
+
+std::span<const uint8_t> LineFramer::pending() const { return std::span<const uint8_t>(buffer).subspan(head); }
+
+void LineFramer::consume(size_t count) {
+    assert(count <= buffer.size() - head);
+    head += count;
+    scanned = std::max(scanned, head);
+}
+
+void LineFramer::clear() {
+    buffer.clear();
+    head = 0;
+    scanned = 0;
+    discarding = false;
+}
+
+bool LineFramer::empty() const { return head >= buffer.size(); }
+
+uint64_t LineFramer::get_dropped_frames() const { return droppedFrames; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
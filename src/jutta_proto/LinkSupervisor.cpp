@@ -0,0 +1,79 @@
+#include "jutta_proto/LinkSupervisor.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+LinkSupervisor::LinkSupervisor() : LinkSupervisor(Config{}) {}
+
+LinkSupervisor::LinkSupervisor(const Config& config) : config(config) {
+    assert(config.maxConsecutiveTimeouts > 0);
+    assert(config.initialBackoff <= config.maxBackoff);
+}
+
+void LinkSupervisor::on_success() { consecutiveTimeouts = 0; }
+
+bool LinkSupervisor::on_timeout() {
+    stats.timeouts++;
+    consecutiveTimeouts++;
+    return consecutiveTimeouts >= config.maxConsecutiveTimeouts;
+}
+
+void LinkSupervisor::on_error() {
+    stats.errors++;
+    errorPending = true;
+}
+
+void LinkSupervisor::link_down(TimePoint now) {
+    if (down) {
+        return;
+    }
+    if (errorPending) {
+        SPDLOG_WARN("Link down after an I/O error.");
+    } else if (consecutiveTimeouts >= config.maxConsecutiveTimeouts) {
+        SPDLOG_WARN("Link down after {} consecutive timeout(s).", consecutiveTimeouts);
+    } else {
+        SPDLOG_WARN("Link down (connection closed or reconnect requested).");
+    }
+    errorPending = false;
+    down = true;
+    stats.linkDowns++;
+    downSince = now;
+    nextAttempt = now;
+    backoff = config.initialBackoff;
+}
+
+bool LinkSupervisor::is_down() const { return down; }
+
+bool LinkSupervisor::attempt_due(TimePoint now) const { return down && now >= nextAttempt; }
+
+LinkSupervisor::TimePoint LinkSupervisor::get_next_attempt() const { return nextAttempt; }
+
+void LinkSupervisor::on_reconnect_failed(TimePoint now) {
+    assert(down);
+    stats.reconnectAttempts++;
+    nextAttempt = now + backoff;
+    SPDLOG_DEBUG("Reconnect attempt failed. Retrying in {}ms.", backoff.count());
+    backoff = std::min(backoff * 2, config.maxBackoff);
+}
+
+void LinkSupervisor::on_reconnected(TimePoint now) {
+    assert(down);
+    stats.reconnectAttempts++;
+    stats.reconnects++;
+    stats.lastRecoveryTime = std::chrono::duration_cast<std::chrono::milliseconds>(now - downSince);
+    SPDLOG_INFO("Link up again after {}ms.", stats.lastRecoveryTime.count());
+    down = false;
+    consecutiveTimeouts = 0;
+    errorPending = false;
+}
+
+const LinkSupervisor::Stats& LinkSupervisor::get_stats() const { return stats; }
+
+const LinkSupervisor::Config& LinkSupervisor::get_config() const { return config; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
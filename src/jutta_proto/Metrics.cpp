@@ -0,0 +1,98 @@
+#include "jutta_proto/Metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+void LatencyHistogram::record(std::chrono::microseconds latency) {
+    buckets[bucket_of(latency)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sumUs.fetch_add(static_cast<uint64_t>(std::max(latency.count(), static_cast<int64_t>(0))), std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::get_snapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count.load(std::memory_order_relaxed);
+    snapshot.sum = std::chrono::microseconds{sumUs.load(std::memory_order_relaxed)};
+    return snapshot;
+}
+
+std::optional<std::chrono::microseconds> LatencyHistogram::upper_bound(size_t bucket) {
+    if (bucket >= BUCKET_COUNT - 1) {
+        return std::nullopt;
+    }
+    return std::chrono::microseconds{static_cast<int64_t>(1) << bucket};
+}
+
+size_t LatencyHistogram::bucket_of(std::chrono::microseconds latency) {
+    if (latency.count() <= 1) {
+        return 0;
+    }
+    // The smallest i with latency <= 2^i:
+    const size_t bucket = std::bit_width(static_cast<uint64_t>(latency.count() - 1));
+    return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+void MetricsRegistry::on_sent(std::optional<jutta_command_t> command) {
+    entries[index_of(command)].sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::on_reply(std::optional<jutta_command_t> command, std::chrono::microseconds latency) {
+    entries[index_of(command)].latency.record(latency);
+}
+
+void MetricsRegistry::on_timeout(std::optional<jutta_command_t> command) {
+    entries[index_of(command)].timeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsRegistry::on_decoder_stats(const StreamDecoder::Stats& stats) {
+    // In case the decoder got reset without on_decoder_reset(), everything counts as new:
+    const uint64_t lastRealignments = stats.realignments >= lastDecoderStats.realignments ? lastDecoderStats.realignments : 0;
+    const uint64_t lastDiscardedBytes = stats.discardedBytes >= lastDecoderStats.discardedBytes ? lastDecoderStats.discardedBytes : 0;
+    realignments.fetch_add(stats.realignments - lastRealignments, std::memory_order_relaxed);
+    discardedBytes.fetch_add(stats.discardedBytes - lastDiscardedBytes, std::memory_order_relaxed);
+    lastDecoderStats = stats;
+}
+
+void MetricsRegistry::on_decoder_reset() { lastDecoderStats = StreamDecoder::Stats{}; }
+
+void MetricsRegistry::on_framer_stats(uint64_t droppedFrames) {
+    // The framer counter never gets reset, but stay monotonic in case it gets replaced:
+    const uint64_t last = droppedFrames >= lastDroppedFrames ? lastDroppedFrames : 0;
+    this->droppedFrames.fetch_add(droppedFrames - last, std::memory_order_relaxed);
+    lastDroppedFrames = droppedFrames;
+}
+
+MetricsSnapshot MetricsRegistry::get_snapshot(const serial::WireCounters& wire) const {
+    MetricsSnapshot snapshot;
+    snapshot.wire = wire.get_snapshot();
+    snapshot.realignments = realignments.load(std::memory_order_relaxed);
+    snapshot.discardedBytes = discardedBytes.load(std::memory_order_relaxed);
+    snapshot.droppedFrames = droppedFrames.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const uint64_t sent = entries[i].sent.load(std::memory_order_relaxed);
+        if (sent <= 0) {
+            continue;
+        }
+        MetricsSnapshot::Command& command = snapshot.commands.emplace_back();
+        if (i < COMMANDS.size()) {
+            command.command = COMMANDS[i].command;
+        }
+        command.sent = sent;
+        command.timeouts = entries[i].timeouts.load(std::memory_order_relaxed);
+        command.latency = entries[i].latency.get_snapshot();
+    }
+    return snapshot;
+}
+
+size_t MetricsRegistry::index_of(std::optional<jutta_command_t> command) {
+    return command ? static_cast<size_t>(*command) : COMMANDS.size();
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
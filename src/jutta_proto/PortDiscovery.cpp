@@ -0,0 +1,143 @@
+#include "jutta_proto/PortDiscovery.hpp"
+#include "jutta_proto/JuttaCommands.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/ResponseParser.hpp"
+#include "logger/Logger.hpp"
+#include "serial/SerialConnection.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+constexpr std::string_view BY_ID_DIR = "/dev/serial/by-id/";
+}  // namespace
+
+PortDiscovery::PortDiscovery(std::string&& cachePath, const std::chrono::milliseconds& timeout) : cachePath(std::move(cachePath)), timeout(timeout) {}
+
+std::vector<PortDiscovery::Port> PortDiscovery::discover() const {
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    std::vector<std::string> candidates = serial::SerialConnection::get_available_ports();
+
+    // Cached ports do not have to be probed again as long as they still exist:
+    std::vector<Port> result;
+    for (Port& port : load_cache()) {
+        std::vector<std::string>::iterator it = std::find(candidates.begin(), candidates.end(), port.path);
+        if (it != candidates.end()) {
+            candidates.erase(it);
+            result.push_back(std::move(port));
+        }
+    }
+
+    // Probe everything else concurrently:
+    std::vector<std::optional<Port>> probed(candidates.size());
+    std::vector<std::thread> threads;
+    threads.reserve(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        threads.emplace_back([&candidates, &probed, &deadline, i]() { probed[i] = probe(candidates[i], deadline); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    bool cacheChanged = false;
+    for (std::optional<Port>& port : probed) {
+        if (port) {
+            cacheChanged |= port->path.starts_with(BY_ID_DIR);
+            result.push_back(std::move(*port));
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const Port& a, const Port& b) { return a.latency < b.latency; });
+    if (cacheChanged) {
+        store_cache(result);
+    }
+    SPDLOG_INFO("Discovered {} coffee maker(s) on {} probed port(s).", result.size(), candidates.size());
+    return result;
+}
+
+std::optional<PortDiscovery::Port> PortDiscovery::probe(const std::string& path, const std::chrono::steady_clock::time_point& deadline) {
+    try {
+        JuttaConnection connection(std::string{path});
+        connection.init();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::milliseconds remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - start);
+        // A timeout of 0 would disable the timeout:
+        while (remaining.count() > 0) {
+            std::optional<JuttaConnection::Response> response = connection.write_command_with_response(jutta_command_t::GET_TYPE, remaining);
+            if (!response) {
+                break;
+            }
+            ParsedResponse parsed = parse_response(response->view());
+            if (const TypeResponse* type = std::get_if<TypeResponse>(&parsed)) {
+                Port port;
+                port.path = path;
+                port.latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                port.machineType = std::string(type->model);
+                if (!type->firmware.empty()) {
+                    port.machineType += ' ';
+                    port.machineType += type->firmware;
+                }
+                SPDLOG_INFO("Found coffee maker '{}' on '{}' after {}us.", port.machineType, path, port.latency.count());
+                return port;
+            }
+            remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        }
+    } catch (const std::exception& e) {
+        SPDLOG_DEBUG("Probing '{}' failed with: {}", path, e.what());
+    }
+    return std::nullopt;
+}
+
+void PortDiscovery::clear_cache() const {
+    if (!cachePath.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(cachePath, ec);
+    }
+}
+
+std::vector<PortDiscovery::Port> PortDiscovery::load_cache() const {
+    std::vector<Port> ports;
+    if (cachePath.empty()) {
+        return ports;
+    }
+    std::ifstream file(cachePath);
+    std::string line;
+    // One port per line: <path>\t<latency in us>\t<machine type>
+    while (std::getline(file, line)) {
+        std::istringstream sstream(line);
+        Port port;
+        int64_t latency = 0;
+        if (std::getline(sstream, port.path, '\t') && (sstream >> latency) && sstream.get() == '\t' && std::getline(sstream, port.machineType)) {
+            port.latency = std::chrono::microseconds{latency};
+            port.cached = true;
+            ports.push_back(std::move(port));
+        }
+    }
+    return ports;
+}
+
+void PortDiscovery::store_cache(const std::vector<Port>& ports) const {
+    if (cachePath.empty()) {
+        return;
+    }
+    std::ofstream file(cachePath, std::ios::trunc);
+    for (const Port& port : ports) {
+        // Only by-id paths are stable across reboots:
+        if (port.path.starts_with(BY_ID_DIR)) {
+            file << port.path << '\t' << port.latency.count() << '\t' << port.machineType << '\n';
+        }
+    }
+    if (!file) {
+        SPDLOG_WARN("Failed to write the port cache '{}'.", cachePath);
+    }
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
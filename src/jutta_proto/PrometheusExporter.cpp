@@ -0,0 +1,210 @@
+#include "jutta_proto/PrometheusExporter.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <system_error>
+
+extern "C" {
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+/**
+ * Escapes backslashes, double quotes and line feeds inside label values.
+ **/
+void write_label_value(std::ostringstream& out, std::string_view value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\':
+                out << "\\\\";
+                break;
+            case '"':
+                out << "\\\"";
+                break;
+            case '\n':
+                out << "\\n";
+                break;
+            default:
+                out << c;
+        }
+    }
+}
+
+void write_header(std::ostringstream& out, std::string_view name, std::string_view type, std::string_view help) {
+    out << "# HELP " << name << ' ' << help << '\n';
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+/**
+ * Writes the start of a sample up to the closing '}' of its labels.
+ **/
+void write_sample_start(std::ostringstream& out, std::string_view name, std::string_view machine) {
+    out << name << "{machine=\"";
+    write_label_value(out, machine);
+    out << '"';
+}
+
+double to_seconds(std::chrono::microseconds us) {
+    return std::chrono::duration<double>(us).count();
+}
+}  // namespace
+
+void PrometheusExporter::add(std::string&& machine, MetricsSnapshot&& snapshot) {
+    machines.emplace_back(std::move(machine), std::move(snapshot));
+}
+
+void PrometheusExporter::clear() { machines.clear(); }
+
+std::string PrometheusExporter::render() const {
+    std::ostringstream out;
+    out.precision(12);
+
+    // One sample per machine:
+    auto machineFamily = [&](std::string_view name, std::string_view help, const std::function<uint64_t(const MetricsSnapshot&)>& value) {
+        write_header(out, name, "counter", help);
+        for (const auto& [machine, snapshot] : machines) {
+            write_sample_start(out, name, machine);
+            out << "} " << value(snapshot) << '\n';
+        }
+    };
+    // One sample per machine and command:
+    auto commandFamily = [&](std::string_view name, std::string_view help, const std::function<uint64_t(const MetricsSnapshot::Command&)>& value) {
+        write_header(out, name, "counter", help);
+        for (const auto& [machine, snapshot] : machines) {
+            for (const MetricsSnapshot::Command& command : snapshot.commands) {
+                write_sample_start(out, name, machine);
+                out << ",command=\"" << command_label(command.command) << "\"} " << value(command) << '\n';
+            }
+        }
+    };
+
+    write_header(out, "jutta_wire_bytes_total", "counter", "Wire bytes transferred.");
+    for (const auto& [machine, snapshot] : machines) {
+        write_sample_start(out, "jutta_wire_bytes_total", machine);
+        out << ",direction=\"in\"} " << snapshot.wire.bytesIn << '\n';
+        write_sample_start(out, "jutta_wire_bytes_total", machine);
+        out << ",direction=\"out\"} " << snapshot.wire.bytesOut << '\n';
+    }
+    machineFamily("jutta_wire_reads_total", "Reads that returned data.", [](const MetricsSnapshot& s) { return s.wire.reads; });
+    machineFamily("jutta_wire_short_reads_total", "Reads that ended in the middle of a quad.", [](const MetricsSnapshot& s) { return s.wire.shortReads; });
+    machineFamily("jutta_wire_writes_total", "Writes.", [](const MetricsSnapshot& s) { return s.wire.writes; });
+    machineFamily("jutta_wire_short_writes_total", "Writes that transmitted less than requested.", [](const MetricsSnapshot& s) { return s.wire.shortWrites; });
+    machineFamily("jutta_wire_errors_total", "I/O errors and hangups.", [](const MetricsSnapshot& s) { return s.wire.errors; });
+    machineFamily("jutta_decoder_realignments_total", "Realignments to the quad boundaries.", [](const MetricsSnapshot& s) { return s.realignments; });
+    machineFamily("jutta_decoder_discarded_bytes_total", "Wire bytes thrown away by the decoder.", [](const MetricsSnapshot& s) { return s.discardedBytes; });
+    machineFamily("jutta_framer_dropped_frames_total", "Frames dropped for exceeding the maximum frame size.", [](const MetricsSnapshot& s) { return s.droppedFrames; });
+    commandFamily("jutta_commands_total", "Commands sent.", [](const MetricsSnapshot::Command& c) { return c.sent; });
+    commandFamily("jutta_command_timeouts_total", "Commands without a response in time.", [](const MetricsSnapshot::Command& c) { return c.timeouts; });
+
+    constexpr std::string_view LATENCY = "jutta_command_latency_seconds";
+    write_header(out, LATENCY, "histogram", "Time between writing a command and receiving its response.");
+    for (const auto& [machine, snapshot] : machines) {
+        for (const MetricsSnapshot::Command& command : snapshot.commands) {
+            const std::string_view label = command_label(command.command);
+            // Prometheus buckets are cumulative:
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+                cumulative += command.latency.buckets[i];
+                write_sample_start(out, "jutta_command_latency_seconds_bucket", machine);
+                out << ",command=\"" << label << "\",le=\"";
+                std::optional<std::chrono::microseconds> bound = LatencyHistogram::upper_bound(i);
+                if (bound) {
+                    out << to_seconds(*bound);
+                } else {
+                    out << "+Inf";
+                }
+                out << "\"} " << cumulative << '\n';
+            }
+            write_sample_start(out, "jutta_command_latency_seconds_sum", machine);
+            out << ",command=\"" << label << "\"} " << to_seconds(command.latency.sum) << '\n';
+            write_sample_start(out, "jutta_command_latency_seconds_count", machine);
+            out << ",command=\"" << label << "\"} " << cumulative << '\n';
+        }
+    }
+    return out.str();
+}
+
+bool PrometheusExporter::write_file(const std::string& path) const {
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << render();
+        if (!file) {
+            SPDLOG_WARN("Failed to write the metrics to '{}'.", tmpPath);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        SPDLOG_WARN("Failed to move the metrics to '{}' with: {}", path, ec.message());
+        return false;
+    }
+    return true;
+}
+
+bool PrometheusExporter::write_socket(const std::string& path) const {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        SPDLOG_WARN("Socket path '{}' is too long.", path);
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), static_cast<char*>(addr.sun_path));
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        SPDLOG_WARN("Failed to create a unix socket with: {}", strerror(errno));
+        return false;
+    }
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        SPDLOG_WARN("Failed to connect to '{}' with: {}", path, strerror(errno));
+        close(fd);
+        return false;
+    }
+    const std::string text = render();
+    size_t offset = 0;
+    while (offset < text.size()) {
+        ssize_t result = send(fd, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // NOLINTNEXTLINE (concurrency-mt-unsafe)
+            SPDLOG_WARN("Failed to send the metrics to '{}' with: {}", path, strerror(errno));
+            close(fd);
+            return false;
+        }
+        offset += static_cast<size_t>(result);
+    }
+    close(fd);
+    return true;
+}
+
+std::string_view PrometheusExporter::command_label(std::optional<jutta_command_t> command) {
+    if (!command) {
+        return "other";
+    }
+    std::string_view data = get_command_info(*command).data;
+    if (data.ends_with("\r\n")) {
+        data.remove_suffix(2);
+    }
+    return data;
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
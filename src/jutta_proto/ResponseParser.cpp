@@ -0,0 +1,193 @@
+#include "jutta_proto/ResponseParser.hpp"
+
+#include <optional>
+#include <span>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+constexpr size_t PREFIX_SIZE = 3;
+
+struct PrefixEntry {
+    std::string_view prefix;
+    response_kind_t kind;
+};
+
+constexpr std::array<PrefixEntry, 7> PREFIXES{{{"ok:", response_kind_t::OK},
+                                               {"ty:", response_kind_t::TYPE},
+                                               {"@t1", response_kind_t::HANDSHAKE_START},
+                                               {"@T2", response_kind_t::KEY_EXCHANGE},
+                                               {"@T3", response_kind_t::HANDSHAKE_END},
+                                               {"ku:", response_kind_t::DEBUG},
+                                               {"Ku:", response_kind_t::DEBUG}}};
+
+constexpr size_t HASH_BITS = 4;
+constexpr size_t TABLE_SIZE = static_cast<size_t>(1) << HASH_BITS;
+
+constexpr uint32_t pack_prefix(std::string_view prefix) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(prefix[0])) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(prefix[1])) << 8) | static_cast<uint8_t>(prefix[2]);
+}
+
+/**
+ * Multiplicative hash, the upper bits of the product select the slot.
+ **/
+constexpr size_t hash_prefix(uint32_t packed, uint32_t seed) { return static_cast<size_t>((packed * seed) >> (32 - HASH_BITS)); }
+
+constexpr bool is_perfect(uint32_t seed) {
+    std::array<bool, TABLE_SIZE> used{};
+    for (const PrefixEntry& entry : PREFIXES) {
+        size_t slot = hash_prefix(pack_prefix(entry.prefix), seed);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+/**
+ * The first odd seed, that maps all prefixes to different slots.
+ **/
+constexpr uint32_t HASH_SEED = [] {
+    uint32_t seed = 1;
+    while (!is_perfect(seed)) {
+        seed += 2;
+    }
+    return seed;
+}();
+
+struct Slot {
+    uint32_t packed{0};
+    response_kind_t kind{response_kind_t::UNKNOWN};
+};
+
+constexpr std::array<Slot, TABLE_SIZE> PREFIX_TABLE = [] {
+    std::array<Slot, TABLE_SIZE> table{};
+    for (const PrefixEntry& entry : PREFIXES) {
+        uint32_t packed = pack_prefix(entry.prefix);
+        table[hash_prefix(packed, HASH_SEED)] = Slot{packed, entry.kind};
+    }
+    return table;
+}();
+
+std::string_view strip_terminator(std::string_view frame) {
+    while (!frame.empty() && (frame.back() == '\n' || frame.back() == '\r')) {
+        frame.remove_suffix(1);
+    }
+    return frame;
+}
+
+std::optional<uint8_t> parse_hex_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return static_cast<uint8_t>(c - '0');
+    }
+    if (c >= 'A' && c <= 'F') {
+        return static_cast<uint8_t>(c - 'A' + 10);
+    }
+    if (c >= 'a' && c <= 'f') {
+        return static_cast<uint8_t>(c - 'a' + 10);
+    }
+    return std::nullopt;
+}
+
+/**
+ * Parses the given hex string into out.
+ * Returns the number of bytes parsed or std::nullopt in case it contains invalid characters or does not fit.
+ **/
+std::optional<size_t> parse_hex(std::string_view hex, std::span<uint8_t> out) {
+    if (hex.size() % 2 != 0 || hex.size() / 2 > out.size()) {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i < hex.size(); i += 2) {
+        std::optional<uint8_t> high = parse_hex_nibble(hex[i]);
+        std::optional<uint8_t> low = parse_hex_nibble(hex[i + 1]);
+        if (!high || !low) {
+            return std::nullopt;
+        }
+        out[i / 2] = static_cast<uint8_t>((*high << 4) | *low);
+    }
+    return hex.size() / 2;
+}
+
+TypeResponse parse_type(std::string_view type) {
+    TypeResponse result;
+    size_t pos = type.find(' ');
+    result.model = type.substr(0, pos);
+    if (pos != std::string_view::npos) {
+        result.firmware = type.substr(pos + 1);
+    }
+    return result;
+}
+}  // namespace
+
+response_kind_t classify_response(std::string_view frame) {
+    if (frame.empty()) {
+        return response_kind_t::UNKNOWN;
+    }
+    // The only single character prefix. The following bytes are random, so it can not take part in the hash:
+    if (frame[0] == '&') {
+        return response_kind_t::ENCRYPTED;
+    }
+    if (frame.size() < PREFIX_SIZE) {
+        return response_kind_t::UNKNOWN;
+    }
+    uint32_t packed = pack_prefix(frame);
+    const Slot& slot = PREFIX_TABLE[hash_prefix(packed, HASH_SEED)];
+    return slot.packed == packed ? slot.kind : response_kind_t::UNKNOWN;
+}
+
+ParsedResponse parse_response(std::string_view frame) {
+    const std::string_view content = strip_terminator(frame);
+    switch (classify_response(frame)) {
+        case response_kind_t::OK:
+            return OkResponse{};
+
+        case response_kind_t::TYPE:
+            return parse_type(content.substr(PREFIX_SIZE));
+
+        case response_kind_t::HANDSHAKE_START:
+            return HandshakeStartResponse{};
+
+        case response_kind_t::KEY_EXCHANGE: {
+            // "@T2:" <hex key bytes>
+            if (content.size() <= PREFIX_SIZE || content[PREFIX_SIZE] != ':') {
+                break;
+            }
+            KeyExchangeResponse result;
+            std::optional<size_t> size = parse_hex(content.substr(PREFIX_SIZE + 1), result.key);
+            if (!size) {
+                break;
+            }
+            result.keySize = *size;
+            return result;
+        }
+
+        case response_kind_t::HANDSHAKE_END: {
+            // "@T3:" <4 hex characters> <machine type>
+            constexpr size_t TOKEN_HEX_SIZE = 4;
+            if (content.size() < PREFIX_SIZE + 1 + TOKEN_HEX_SIZE || content[PREFIX_SIZE] != ':') {
+                break;
+            }
+            HandshakeEndResponse result;
+            if (!parse_hex(content.substr(PREFIX_SIZE + 1, TOKEN_HEX_SIZE), result.token)) {
+                break;
+            }
+            result.type = parse_type(content.substr(PREFIX_SIZE + 1 + TOKEN_HEX_SIZE));
+            return result;
+        }
+
+        case response_kind_t::DEBUG:
+            return DebugResponse{content[0] == 'K', content.substr(PREFIX_SIZE)};
+
+        case response_kind_t::ENCRYPTED:
+            return EncryptedResponse{frame};
+
+        default:
+            break;
+    }
+    return UnknownResponse{frame};
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,96 @@
+#include "jutta_proto/RttEstimator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+RttEstimator::RttEstimator() : RttEstimator(Config{}) {}
+
+RttEstimator::RttEstimator(const Config& config) : config(config) {
+    assert(config.floor <= config.ceiling);
+    assert(config.percentile > 0 && config.percentile <= 1);
+    assert(config.minSamples > 0 && config.minSamples <= WINDOW_SIZE);
+}
+
+std::chrono::milliseconds RttEstimator::get_deadline(std::optional<jutta_command_t> command) const {
+    std::optional<std::chrono::microseconds> rtt = percentile_of(entries[index_of(command)]);
+    if (!rtt) {
+        return config.ceiling;
+    }
+    const std::chrono::milliseconds deadline = std::chrono::ceil<std::chrono::milliseconds>(std::chrono::duration<double, std::micro>(static_cast<double>(rtt->count()) * config.multiplier));
+    return std::clamp(deadline, config.floor, config.ceiling);
+}
+
+bool RttEstimator::on_reply(std::optional<jutta_command_t> command, std::chrono::microseconds rtt) {
+    Entry& entry = entries[index_of(command)];
+    std::optional<std::chrono::microseconds> percentile = percentile_of(entry);
+    const bool slow = percentile && rtt > *percentile;
+
+    add_sample(entry, rtt);
+    CommandStats& stats = entry.stats;
+    stats.replies++;
+    if (slow) {
+        stats.slowReplies++;
+    }
+    stats.lastRtt = rtt;
+    stats.minRtt = (stats.replies == 1) ? rtt : std::min(stats.minRtt, rtt);
+    stats.maxRtt = std::max(stats.maxRtt, rtt);
+    return slow;
+}
+
+void RttEstimator::on_timeout(std::optional<jutta_command_t> command, std::chrono::microseconds waited) {
+    Entry& entry = entries[index_of(command)];
+    entry.stats.timeouts++;
+    // A lower bound for the round trip time. Without it, the deadline would never grow again:
+    add_sample(entry, waited);
+    lastTimeout = index_of(command);
+}
+
+bool RttEstimator::on_late_reply() {
+    if (!lastTimeout) {
+        return false;
+    }
+    entries[*lastTimeout].stats.lateReplies++;
+    lastTimeout = std::nullopt;
+    return true;
+}
+
+void RttEstimator::on_sent() { lastTimeout = std::nullopt; }
+
+RttEstimator::CommandStats RttEstimator::get_stats(std::optional<jutta_command_t> command) const {
+    const Entry& entry = entries[index_of(command)];
+    CommandStats stats = entry.stats;
+    stats.percentileRtt = percentile_of(entry).value_or(std::chrono::microseconds{0});
+    stats.deadline = get_deadline(command);
+    return stats;
+}
+
+const RttEstimator::Config& RttEstimator::get_config() const { return config; }
+
+size_t RttEstimator::index_of(std::optional<jutta_command_t> command) {
+    return command ? static_cast<size_t>(*command) : COMMANDS.size();
+}
+
+void RttEstimator::add_sample(Entry& entry, std::chrono::microseconds rtt) {
+    const uint32_t us = static_cast<uint32_t>(std::min<int64_t>(rtt.count(), std::numeric_limits<uint32_t>::max()));
+    entry.window[entry.samples % WINDOW_SIZE] = us;
+    entry.samples++;
+}
+
+std::optional<std::chrono::microseconds> RttEstimator::percentile_of(const Entry& entry) const {
+    if (entry.samples < config.minSamples) {
+        return std::nullopt;
+    }
+    const size_t count = std::min(entry.samples, WINDOW_SIZE);
+    std::array<uint32_t, WINDOW_SIZE> sorted = entry.window;
+    const size_t rank = std::min(count - 1, static_cast<size_t>(std::ceil(config.percentile * static_cast<double>(count))) - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(rank), sorted.begin() + static_cast<std::ptrdiff_t>(count));
+    return std::chrono::microseconds{sorted[rank]};
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
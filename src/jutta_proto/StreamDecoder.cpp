@@ -0,0 +1,89 @@
+#include "jutta_proto/StreamDecoder.hpp"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+size_t StreamDecoder::feed(std::span<const uint8_t> wire, std::vector<uint8_t>& out) {
+    const size_t oldSize = out.size();
+    for (uint8_t b : wire) {
+        if (is_wire_byte(b)) {
+            window = (window << 8) | b;
+            if (windowLen < TERMINATOR_WIRE_SIZE) {
+                windowLen++;
+            }
+        } else {
+            // Line noise, keep the slot so we stay in sync with the quad boundaries:
+            stats.invalidBytes++;
+            quadValid = false;
+            windowLen = 0;
+        }
+
+        quad[quadLen++] = b;
+        if (quadLen >= WIRE_QUAD_SIZE) {
+            emitted = static_cast<uint8_t>(emitted << 1);
+            if (quadValid) {
+                out.push_back(decode_table(quad.data()));
+                stats.quads++;
+                emitted |= 1;
+            } else {
+                stats.discardedBytes += WIRE_QUAD_SIZE;
+            }
+            quadLen = 0;
+            quadValid = true;
+        }
+
+        // An encoded "\r\n" has to end on a quad boundary.
+        // In case it does not, we are out of sync and the last two completed quads were decoded from parts of the terminator.
+        // Aligned data can contain the same bit pattern across quad boundaries, in this case we sync to the wrong boundary
+        // and recover on the next terminator. So we lose at most the message currently being received.
+        if (quadLen != 0 && windowLen >= TERMINATOR_WIRE_SIZE && window == TERMINATOR_WIRE) {
+            // Take back the garbage bytes. They are the last ones decoded, but might have been appended by the previous call:
+            size_t garbage = static_cast<size_t>(emitted & 1) + static_cast<size_t>((emitted >> 1) & 1);
+            garbage = std::min(garbage, out.size());
+            out.resize(out.size() - garbage);
+            stats.quads -= garbage;
+            stats.discardedBytes += quadLen + garbage * WIRE_QUAD_SIZE;
+            stats.realignments++;
+            SPDLOG_DEBUG("Realigned UART stream after a misaligned terminator ({} byte dropped).", quadLen);
+            out.push_back(static_cast<uint8_t>('\r'));
+            out.push_back(static_cast<uint8_t>('\n'));
+            quadLen = 0;
+            quadValid = true;
+            windowLen = 0;
+            emitted = 0;
+        }
+    }
+    // We might have taken back more bytes than we appended:
+    return out.size() >= oldSize ? out.size() - oldSize : 0;
+}
+
+void StreamDecoder::on_idle() {
+    if (quadLen > 0) {
+        stats.discardedBytes += quadLen;
+        stats.realignments++;
+        SPDLOG_DEBUG("Dropped {} byte of a partial quad after the line went quiet.", quadLen);
+    }
+    quadLen = 0;
+    quadValid = true;
+    windowLen = 0;
+    emitted = 0;
+}
+
+void StreamDecoder::reset() {
+    quadLen = 0;
+    quadValid = true;
+    window = 0;
+    windowLen = 0;
+    emitted = 0;
+    stats = Stats{};
+}
+
+size_t StreamDecoder::buffered() const { return quadLen; }
+
+const StreamDecoder::Stats& StreamDecoder::get_stats() const { return stats; }
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
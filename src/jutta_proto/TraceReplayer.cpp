@@ -0,0 +1,215 @@
+#include "jutta_proto/TraceReplayer.hpp"
+#include "jutta_proto/JuttaCodec.hpp"
+#include "jutta_proto/TransmitPacer.hpp"
+#include "logger/Logger.hpp"
+
+#include <array>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+/**
+ * Parses eight '0'/'1' characters separated by the given number of spaces, most significant bit first.
+ **/
+std::optional<uint8_t> parse_bits(std::string_view str, size_t stride) {
+    if (str.size() < 7 * stride + 1) {
+        return std::nullopt;
+    }
+    uint8_t result = 0;
+    for (size_t i = 0; i < 8; i++) {
+        const char c = str[i * stride];
+        if (c != '0' && c != '1') {
+            return std::nullopt;
+        }
+        result = static_cast<uint8_t>((result << 1) | (c == '1' ? 1 : 0));
+    }
+    return result;
+}
+
+/**
+ * Parses a line of snoop_keep_alive.txt: "22B" followed by the received bytes in binary.
+ **/
+std::optional<std::vector<uint8_t>> parse_frame_line(std::string_view line) {
+    const size_t b = line.find('B');
+    if (b == 0 || b == std::string_view::npos || line.find_first_not_of("0123456789") != b) {
+        return std::nullopt;
+    }
+    std::vector<uint8_t> data;
+    for (size_t pos = line.find_first_of("01", b); pos != std::string_view::npos; pos = line.find_first_of("01", pos + 8)) {
+        std::optional<uint8_t> byte = parse_bits(line.substr(pos), 1);
+        if (!byte) {
+            return std::nullopt;
+        }
+        data.push_back(*byte);
+    }
+    if (data.empty()) {
+        return std::nullopt;
+    }
+    return data;
+}
+
+/**
+ * Replaces the escape sequences "\r" and "\n" of transcript lines with the actual characters.
+ **/
+std::vector<uint8_t> unescape(std::string_view str) {
+    std::vector<uint8_t> result;
+    for (size_t i = 0; i < str.size(); i++) {
+        if (str[i] == '\\' && i + 1 < str.size() && (str[i + 1] == 'r' || str[i + 1] == 'n')) {
+            result.push_back(str[++i] == 'r' ? '\r' : '\n');
+        } else {
+            result.push_back(static_cast<uint8_t>(str[i]));
+        }
+    }
+    return result;
+}
+}  // namespace
+
+TraceReplayer::TraceReplayer(std::vector<TraceEvent>&& events) : events(std::move(events)) {}
+
+TraceReplayer TraceReplayer::from_capture(const std::string& path) {
+    const std::vector<CaptureRecord> records = WireCapture::read_file(path);
+    bool hasWire = false;
+    for (const CaptureRecord& rec : records) {
+        hasWire |= rec.layer == capture_layer_t::WIRE;
+    }
+    const capture_layer_t layer = hasWire ? capture_layer_t::WIRE : capture_layer_t::DECODED;
+
+    std::vector<TraceEvent> events;
+    std::optional<uint64_t> start;
+    uint64_t lastTimestamp = 0;
+    for (const CaptureRecord& rec : records) {
+        if (rec.layer != layer) {
+            continue;
+        }
+        if (!start) {
+            start = rec.timestamp;
+        }
+        const std::span<const uint8_t> payload = rec.payload();
+        // Longer data got split into multiple records sharing the same timestamp:
+        if (!events.empty() && rec.timestamp == lastTimestamp && events.back().direction == rec.direction) {
+            std::vector<uint8_t> wire = layer == capture_layer_t::WIRE ? std::vector<uint8_t>(payload.begin(), payload.end()) : encode_block(payload);
+            events.back().wire.insert(events.back().wire.end(), wire.begin(), wire.end());
+        } else {
+            TraceEvent& event = events.emplace_back();
+            event.offset = std::chrono::nanoseconds{rec.timestamp - *start};
+            event.direction = rec.direction;
+            event.wire = layer == capture_layer_t::WIRE ? std::vector<uint8_t>(payload.begin(), payload.end()) : encode_block(payload);
+        }
+        lastTimestamp = rec.timestamp;
+    }
+    return TraceReplayer(std::move(events));
+}
+
+TraceReplayer TraceReplayer::from_snoop(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open snoop '" + path + "'.");
+    }
+    // Snoops have no timestamps, so assume the coffee maker and dongle send with the default pacing:
+    const std::chrono::nanoseconds period = TransmitPacer().get_period();
+    std::chrono::nanoseconds offset{0};
+    std::vector<TraceEvent> events;
+    std::vector<uint8_t> data;
+    capture_direction_t direction = capture_direction_t::RX;
+    // False outside of "Dongle:" and "Coffee-Maker:" sections:
+    bool inSection = false;
+    auto finishEvent = [&] {
+        if (inSection && !data.empty()) {
+            TraceEvent& event = events.emplace_back();
+            event.offset = offset;
+            event.direction = direction;
+            event.wire = encode_block(data);
+            offset += period * static_cast<int64_t>(data.size());
+        }
+        data.clear();
+    };
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string_view view(line);
+        if (view.find("Dongle:") != std::string_view::npos) {
+            finishEvent();
+            direction = capture_direction_t::TX;
+            inSection = true;
+        } else if (view.find("Coffee-Maker:") != std::string_view::npos) {
+            finishEvent();
+            direction = capture_direction_t::RX;
+            inSection = true;
+        } else if (view.starts_with('#')) {
+            // A new markdown section, e.g. an analysis repeating previous bytes:
+            finishEvent();
+            inSection = false;
+        } else if (std::optional<uint8_t> byte = parse_bits(view, 2); byte && view.find("->") != std::string_view::npos) {
+            data.push_back(*byte);
+        } else if (view.starts_with("[D]: ") || view.starts_with("[C]: ")) {
+            finishEvent();
+            TraceEvent& event = events.emplace_back();
+            event.offset = offset;
+            event.direction = view[1] == 'D' ? capture_direction_t::TX : capture_direction_t::RX;
+            const std::vector<uint8_t> message = unescape(view.substr(5));
+            event.wire = encode_block(message);
+            offset += period * static_cast<int64_t>(message.size());
+        } else if (std::optional<std::vector<uint8_t>> frame = parse_frame_line(view)) {
+            finishEvent();
+            TraceEvent& event = events.emplace_back();
+            event.offset = offset;
+            event.direction = capture_direction_t::RX;
+            event.wire = encode_block(*frame);
+            offset += period * static_cast<int64_t>(frame->size());
+        }
+    }
+    finishEvent();
+    if (events.empty()) {
+        throw std::runtime_error("Snoop '" + path + "' contains no traffic.");
+    }
+    return TraceReplayer(std::move(events));
+}
+
+TraceReplayer TraceReplayer::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open trace '" + path + "'.");
+    }
+    std::array<char, WireCapture::FILE_MAGIC.size()> magic{};
+    if (file.read(magic.data(), magic.size()) && std::string_view(magic.data(), magic.size()) == WireCapture::FILE_MAGIC) {
+        return from_capture(path);
+    }
+    return from_snoop(path);
+}
+
+TraceReplayer::Stats TraceReplayer::replay(BasicJuttaConnection<serial::LoopbackConnection>& connection, replay_mode_t mode) const {
+    Stats stats;
+    serial::LoopbackConnection& loopback = connection.get_transport();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (const TraceEvent& event : events) {
+        if (event.direction == capture_direction_t::TX) {
+            stats.txEvents++;
+            continue;
+        }
+        if (mode == replay_mode_t::ORIGINAL_TIMING) {
+            TransmitPacer::sleep_until(start + event.offset);
+        }
+        loopback.inject_rx(event.wire);
+        stats.frames += connection.dispatch_pending();
+        stats.rxEvents++;
+        stats.rxBytes += event.wire.size();
+    }
+    stats.elapsed = std::chrono::steady_clock::now() - start;
+    SPDLOG_DEBUG("Replayed {} events with {} frames in {}us.", stats.rxEvents, stats.frames, std::chrono::duration_cast<std::chrono::microseconds>(stats.elapsed).count());
+    return stats;
+}
+
+const std::vector<TraceEvent>& TraceReplayer::get_events() const { return events; }
+
+std::chrono::nanoseconds TraceReplayer::get_duration() const {
+    return events.empty() ? std::chrono::nanoseconds{0} : events.back().offset;
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
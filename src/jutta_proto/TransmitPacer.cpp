@@ -0,0 +1,77 @@
+#include "jutta_proto/TransmitPacer.hpp"
+
+#include <cassert>
+#include <cerrno>
+
+extern "C" {
+#include <time.h>
+}
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+TransmitPacer::TransmitPacer(std::chrono::nanoseconds interQuadGap, uint32_t baudRate) : interQuadGap(interQuadGap) {
+    set_baud_rate(baudRate);
+}
+
+void TransmitPacer::set_inter_quad_gap(std::chrono::nanoseconds gap) {
+    assert(gap.count() >= 0);
+    interQuadGap = gap;
+}
+
+std::chrono::nanoseconds TransmitPacer::get_inter_quad_gap() const { return interQuadGap; }
+
+std::chrono::nanoseconds TransmitPacer::get_period() const { return quadAirTime + interQuadGap; }
+
+std::chrono::steady_clock::time_point TransmitPacer::begin_message() const {
+    return std::max(std::chrono::steady_clock::now(), nextRelease);
+}
+
+std::chrono::steady_clock::time_point TransmitPacer::release_quad(std::chrono::steady_clock::time_point deadline) {
+    record_release(deadline);
+    return deadline + get_period();
+}
+
+void TransmitPacer::end_message(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point nextDeadline) {
+    if (nextDeadline > start) {
+        nextRelease = nextDeadline;
+        stats.messages++;
+        stats.lastMessageDuration = (nextDeadline - get_period()) - start;
+    }
+}
+
+void TransmitPacer::set_baud_rate(uint32_t baudRate) {
+    assert(baudRate > 0);
+    // 1 start bit + 8 data bits + 1 stop bit per byte:
+    constexpr uint64_t BITS_PER_QUAD = WIRE_QUAD_SIZE * 10;
+    quadAirTime = std::chrono::nanoseconds{(BITS_PER_QUAD * 1000000000ULL) / baudRate};
+}
+
+const TransmitPacer::Stats& TransmitPacer::get_stats() const { return stats; }
+
+void TransmitPacer::reset_stats() { stats = Stats{}; }
+
+void TransmitPacer::sleep_until(std::chrono::steady_clock::time_point deadline) {
+    // std::chrono::steady_clock is based on CLOCK_MONOTONIC on Linux:
+    std::chrono::nanoseconds sinceEpoch = deadline.time_since_epoch();
+    if (sinceEpoch.count() < 0) {
+        return;
+    }
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count());
+    ts.tv_nsec = static_cast<long>((sinceEpoch - std::chrono::seconds{ts.tv_sec}).count());
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+void TransmitPacer::record_release(std::chrono::steady_clock::time_point deadline) {
+    std::chrono::nanoseconds jitter = std::chrono::steady_clock::now() - deadline;
+    if (jitter.count() < 0) {
+        jitter = std::chrono::nanoseconds{0};
+    }
+    stats.quads++;
+    stats.totalJitter += jitter;
+    stats.maxJitter = std::max(stats.maxJitter, jitter);
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
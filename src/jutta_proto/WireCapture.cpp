@@ -0,0 +1,183 @@
+#include "jutta_proto/WireCapture.hpp"
+#include "logger/Logger.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto {
+//---------------------------------------------------------------------------
+namespace {
+template <typename I>
+void write_le(std::ofstream& file, I value) {
+    std::array<char, sizeof(I)> bytes{};
+    for (char& b : bytes) {
+        b = static_cast<char>(value & 0xFF);
+        value >>= 8;
+    }
+    file.write(bytes.data(), bytes.size());
+}
+
+template <typename I>
+bool read_le(std::ifstream& file, I& value) {
+    std::array<char, sizeof(I)> bytes{};
+    if (!file.read(bytes.data(), bytes.size())) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = bytes.size(); i > 0; i--) {
+        value = static_cast<I>((value << 8) | static_cast<uint8_t>(bytes[i - 1]));
+    }
+    return true;
+}
+}  // namespace
+
+WireCapture::WireCapture(size_t capacity) : ring(std::bit_ceil(std::max(capacity, static_cast<size_t>(2)))), mask(ring.size() - 1) {}
+
+void WireCapture::record(capture_direction_t direction, capture_layer_t layer, std::span<const uint8_t> data) {
+    if (data.empty() || !enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    record(direction, layer, data, now());
+}
+
+void WireCapture::record(capture_direction_t direction, capture_layer_t layer, std::span<const uint8_t> data, uint64_t timestamp) {
+    if (data.empty() || !enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    size_t pos = tail.load(std::memory_order_relaxed);
+    const size_t consumed = head.load(std::memory_order_acquire);
+    const size_t needed = (data.size() + CaptureRecord::PAYLOAD_SIZE - 1) / CaptureRecord::PAYLOAD_SIZE;
+    // Either the whole data gets recorded or nothing, so the consumer never sees partial messages:
+    if (pos - consumed + needed > ring.size()) {
+        dropped.fetch_add(needed, std::memory_order_relaxed);
+        return;
+    }
+    while (!data.empty()) {
+        CaptureRecord& rec = ring[pos & mask];
+        rec.timestamp = timestamp;
+        rec.direction = direction;
+        rec.layer = layer;
+        rec.size = static_cast<uint8_t>(std::min(data.size(), CaptureRecord::PAYLOAD_SIZE));
+        std::copy_n(data.begin(), rec.size, rec.data.begin());
+        data = data.subspan(rec.size);
+        pos++;
+    }
+    // Publish all records at once:
+    tail.store(pos, std::memory_order_release);
+    records.fetch_add(needed, std::memory_order_relaxed);
+}
+
+void WireCapture::set_enabled(bool enabled) { this->enabled = enabled; }
+
+bool WireCapture::is_enabled() const { return enabled; }
+
+size_t WireCapture::drain(const std::function<void(const CaptureRecord&)>& consumer) {
+    size_t pos = head.load(std::memory_order_relaxed);
+    const size_t end = tail.load(std::memory_order_acquire);
+    const size_t count = end - pos;
+    for (; pos != end; pos++) {
+        consumer(ring[pos & mask]);
+    }
+    // Hand the slots back to the producer:
+    head.store(pos, std::memory_order_release);
+    return count;
+}
+
+void WireCapture::open(const std::string& path) {
+    if (file.is_open()) {
+        close();
+    }
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to create capture file '" + path + "'.");
+    }
+    file.write(FILE_MAGIC.data(), static_cast<std::streamsize>(FILE_MAGIC.size()));
+    write_le<uint32_t>(file, FILE_VERSION);
+    write_le<uint32_t>(file, 0);
+    SPDLOG_INFO("Capturing to '{}'.", path);
+}
+
+size_t WireCapture::flush() {
+    if (!file.is_open()) {
+        return 0;
+    }
+    size_t count = drain([this](const CaptureRecord& rec) {
+        write_le<uint64_t>(file, rec.timestamp);
+        uint8_t flags = 0;
+        if (rec.direction == capture_direction_t::TX) {
+            flags |= FLAG_TX;
+        }
+        if (rec.layer == capture_layer_t::DECODED) {
+            flags |= FLAG_DECODED;
+        }
+        write_le<uint8_t>(file, flags);
+        write_le<uint8_t>(file, rec.size);
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        file.write(reinterpret_cast<const char*>(rec.data.data()), rec.size);
+    });
+    file.flush();
+    if (!file) {
+        SPDLOG_WARN("Writing the capture file failed.");
+    }
+    flushed.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+void WireCapture::close() {
+    if (file.is_open()) {
+        static_cast<void>(flush());
+        file.close();
+    }
+}
+
+std::vector<CaptureRecord> WireCapture::read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open capture file '" + path + "'.");
+    }
+    std::array<char, FILE_MAGIC.size()> magic{};
+    uint32_t version = 0;
+    uint32_t reserved = 0;
+    if (!file.read(magic.data(), magic.size()) || std::string_view(magic.data(), magic.size()) != FILE_MAGIC || !read_le(file, version) || !read_le(file, reserved)) {
+        throw std::runtime_error("'" + path + "' is no capture file.");
+    }
+    if (version != FILE_VERSION) {
+        throw std::runtime_error("Unsupported capture file version " + std::to_string(version) + ".");
+    }
+
+    std::vector<CaptureRecord> result;
+    while (true) {
+        CaptureRecord rec;
+        uint8_t flags = 0;
+        if (!read_le(file, rec.timestamp) || !read_le(file, flags) || !read_le(file, rec.size) || rec.size > CaptureRecord::PAYLOAD_SIZE) {
+            break;
+        }
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        if (!file.read(reinterpret_cast<char*>(rec.data.data()), rec.size)) {
+            break;
+        }
+        rec.direction = (flags & FLAG_TX) ? capture_direction_t::TX : capture_direction_t::RX;
+        rec.layer = (flags & FLAG_DECODED) ? capture_layer_t::DECODED : capture_layer_t::WIRE;
+        result.push_back(rec);
+    }
+    return result;
+}
+
+WireCapture::Stats WireCapture::get_stats() const {
+    Stats stats;
+    stats.records = records.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.flushed = flushed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t WireCapture::capacity() const { return ring.size(); }
+
+uint64_t WireCapture::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto
+//---------------------------------------------------------------------------
@@ -0,0 +1,125 @@
+#include "serial/LoopbackConnection.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+LoopbackConnection::LoopbackConnection(size_t rxCapacity) : rxBuffer(rxCapacity) {}
+
+void LoopbackConnection::init() {
+    std::unique_lock<std::mutex> lk(peerMutex);
+    rxPending.clear();
+    rxBuffer.clear();
+    state = SC_READY;
+}
+
+void LoopbackConnection::reopen() {
+    if (unplugged) {
+        state = SC_ERROR;
+        throw std::runtime_error("Failed to reopen the loopback connection. The device is unplugged.");
+    }
+    init();
+}
+
+void LoopbackConnection::mark_error() {
+    {
+        // Hold the lock, so a concurrent wait_readable() does not miss the state change:
+        std::unique_lock<std::mutex> lk(peerMutex);
+        if (state == SC_READY) {
+            state = SC_ERROR;
+        }
+    }
+    rxCondition.notify_all();
+}
+
+SerialConnectionState LoopbackConnection::get_state() const { return state; }
+
+size_t LoopbackConnection::fill_rx() {
+    std::unique_lock<std::mutex> lk(peerMutex);
+    if (state != SC_READY || rxPending.empty()) {
+        return 0;
+    }
+    std::array<std::span<uint8_t>, 2> spans = rxBuffer.write_spans();
+    if (spans[0].empty()) {
+        rxBuffer.record_overflow();
+        return 0;
+    }
+    size_t count = 0;
+    for (std::span<uint8_t>& span : spans) {
+        size_t len = std::min(span.size(), rxPending.size() - count);
+        std::copy_n(rxPending.begin() + static_cast<std::ptrdiff_t>(count), len, span.begin());
+        count += len;
+    }
+    rxPending.erase(rxPending.begin(), rxPending.begin() + static_cast<std::ptrdiff_t>(count));
+    rxBuffer.commit(count);
+    counters.on_read(count);
+    return count;
+}
+
+std::span<const uint8_t> LoopbackConnection::peek_rx() const { return rxBuffer.read_span(); }
+
+void LoopbackConnection::consume_rx(size_t count) { rxBuffer.consume(count); }
+
+const RingBuffer& LoopbackConnection::get_rx_buffer() const { return rxBuffer; }
+
+const WireCounters& LoopbackConnection::get_wire_counters() const { return counters; }
+
+bool LoopbackConnection::wait_readable(const std::chrono::milliseconds& timeout) const {
+    std::unique_lock<std::mutex> lk(peerMutex);
+    auto ready = [this] { return !rxPending.empty() || state != SC_READY; };
+    if (timeout.count() < 0) {
+        rxCondition.wait(lk, ready);
+    } else if (!rxCondition.wait_for(lk, timeout, ready)) {
+        return false;
+    }
+    return state == SC_READY;
+}
+
+size_t LoopbackConnection::write_serial(std::span<const uint8_t> data) {
+    if (state != SC_READY) {
+        return 0;
+    }
+    {
+        std::unique_lock<std::mutex> lk(peerMutex);
+        txData.insert(txData.end(), data.begin(), data.end());
+    }
+    counters.on_write(data.size(), data.size());
+    if (responder) {
+        responder(data);
+    }
+    return data.size();
+}
+
+void LoopbackConnection::flush() const {}
+
+void LoopbackConnection::inject_rx(std::span<const uint8_t> data) {
+    {
+        std::unique_lock<std::mutex> lk(peerMutex);
+        rxPending.insert(rxPending.end(), data.begin(), data.end());
+    }
+    rxCondition.notify_all();
+}
+
+void LoopbackConnection::take_tx(std::vector<uint8_t>& out) {
+    std::unique_lock<std::mutex> lk(peerMutex);
+    out.insert(out.end(), txData.begin(), txData.end());
+    txData.clear();
+}
+
+void LoopbackConnection::set_unplugged(bool unplugged) {
+    this->unplugged = unplugged;
+    if (unplugged) {
+        // Same as a hangup of a real device:
+        counters.on_error();
+        mark_error();
+    }
+}
+
+void LoopbackConnection::set_responder(Responder&& responder) {
+    this->responder = std::move(responder);
+}
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
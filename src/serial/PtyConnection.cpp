@@ -0,0 +1,47 @@
+#include "serial/PtyConnection.hpp"
+#include "logger/Logger.hpp"
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+extern "C" {
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+}
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+PtyConnection::PtyConnection(const LinkProfile& profile) : PtyConnection(open_pty(), profile) {}
+
+PtyConnection::PtyConnection(PtyPair&& pair, const LinkProfile& profile) : SerialConnection(std::move(pair.slavePath), profile), masterFd(pair.masterFd), slaveFd(pair.slaveFd) {}
+
+PtyConnection::~PtyConnection() {
+    close(masterFd);
+    close(slaveFd);
+}
+
+PtyConnection::PtyPair PtyConnection::open_pty() {
+    PtyPair pair;
+    std::array<char, 256> name{};
+    if (openpty(&pair.masterFd, &pair.slaveFd, name.data(), nullptr, nullptr) < 0) {
+        // NOLINTNEXTLINE (concurrency-mt-unsafe)
+        throw std::runtime_error(std::string("Failed to open a pseudo terminal with: ") + strerror(errno));
+    }
+    // The master side only passes data through:
+    termios config{};
+    if (tcgetattr(pair.masterFd, &config) == 0) {
+        cfmakeraw(&config);
+        tcsetattr(pair.masterFd, TCSANOW, &config);
+    }
+    pair.slavePath = name.data();
+    SPDLOG_INFO("Opened pseudo terminal: {}", pair.slavePath);
+    return pair;
+}
+
+int PtyConnection::get_peer_fd() const { return masterFd; }
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
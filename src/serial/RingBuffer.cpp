@@ -0,0 +1,56 @@
+#include "serial/RingBuffer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+RingBuffer::RingBuffer(size_t capacity) : storage(std::bit_ceil(std::max(capacity, static_cast<size_t>(1)))), mask(storage.size() - 1) {}
+
+std::array<std::span<uint8_t>, 2> RingBuffer::write_spans() {
+    const size_t freeSpace = free_space();
+    const size_t start = tail & mask;
+    const size_t first = std::min(freeSpace, storage.size() - start);
+    std::span<uint8_t> all(storage);
+    return {all.subspan(start, first), all.subspan(0, freeSpace - first)};
+}
+
+void RingBuffer::commit(size_t count) {
+    assert(count <= free_space());
+    if (count <= 0) {
+        return;
+    }
+    tail += count;
+    stats.fills++;
+    stats.bytes += count;
+    stats.highWaterMark = std::max(stats.highWaterMark, size());
+}
+
+void RingBuffer::record_overflow() { stats.overflows++; }
+
+std::span<const uint8_t> RingBuffer::read_span() const {
+    const size_t start = head & mask;
+    return std::span<const uint8_t>(storage).subspan(start, std::min(size(), storage.size() - start));
+}
+
+void RingBuffer::consume(size_t count) {
+    assert(count <= size());
+    head += count;
+}
+
+void RingBuffer::clear() { head = tail; }
+
+size_t RingBuffer::size() const { return tail - head; }
+
+size_t RingBuffer::capacity() const { return storage.size(); }
+
+size_t RingBuffer::free_space() const { return storage.size() - size(); }
+
+bool RingBuffer::empty() const { return head == tail; }
+
+const RingBuffer::Stats& RingBuffer::get_stats() const { return stats; }
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
@@ -1,15 +1,27 @@
 #include "serial/SerialConnection.hpp"
 #include "logger/Logger.hpp"
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
 #include <cstddef>
 #include <exception>
+#include <filesystem>
+#include <fstream>
+#include <set>
 #include <sstream>
 #include <stdexcept>
+#include <string_view>
 #include <system_error>
+#include <utility>
 
 extern "C" {
 #include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <unistd.h>
 }
@@ -17,7 +29,63 @@ extern "C" {
 //---------------------------------------------------------------------------
 namespace serial {
 //---------------------------------------------------------------------------
-SerialConnection::SerialConnection(std::string&& device) : device(std::move(device)) {}
+namespace {
+constexpr std::string_view BY_ID_DIR = "/dev/serial/by-id";
+constexpr std::string_view SYSFS_TTY_DIR = "/sys/class/tty";
+
+/**
+ * Writes the given value into a sysfs attribute.
+ * sysfs reports errors (e.g. missing permissions) when flushing, so the file gets closed before checking the result.
+ **/
+bool write_sysfs(const std::filesystem::path& path, int value) {
+    std::ofstream file(path);
+    file << value;
+    file.close();
+    return !file.fail();
+}
+
+/**
+ * The serial8250 driver registers placeholder ports (ttyS0 - ttyS31) whether or not there is an actual UART.
+ * Placeholders report the type PORT_UNKNOWN.
+ **/
+bool is_present_8250_port(const std::filesystem::path& device) {
+    // NOLINTNEXTLINE (hicpp-signed-bitwise)
+    int fd = open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        return false;
+    }
+    serial_struct info{};
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+    bool present = ioctl(fd, TIOCGSERIAL, &info) == 0 && info.type != PORT_UNKNOWN;
+    close(fd);
+    return present;
+}
+
+constexpr std::array<std::pair<uint32_t, speed_t>, 8> SPEEDS{{{1200, B1200}, {2400, B2400}, {4800, B4800}, {9600, B9600}, {19200, B19200}, {38400, B38400}, {57600, B57600}, {115200, B115200}}};
+
+/**
+ * Returns B0 in case the given baud rate is not supported.
+ **/
+speed_t to_speed(uint32_t baudRate) {
+    for (const std::pair<uint32_t, speed_t>& speed : SPEEDS) {
+        if (speed.first == baudRate) {
+            return speed.second;
+        }
+    }
+    return B0;
+}
+
+uint32_t from_speed(speed_t speed) {
+    for (const std::pair<uint32_t, speed_t>& s : SPEEDS) {
+        if (s.second == speed) {
+            return s.first;
+        }
+    }
+    return 0;
+}
+}  // namespace
+
+SerialConnection::SerialConnection(std::string&& device, const LinkProfile& profile) : device(std::move(device)), profile(profile) {}
 
 SerialConnection::~SerialConnection() {
     closeTty();
@@ -30,6 +98,28 @@ void SerialConnection::init() {
     assert(state == SC_READY);
 }
 
+void SerialConnection::reopen() {
+    closeTty();
+    try {
+        openTty(device);
+        configureTty();
+    } catch (...) {
+        closeTty();
+        state = SC_ERROR;
+        throw;
+    }
+    assert(state == SC_READY);
+}
+
+void SerialConnection::mark_error() {
+    if (state == SC_READY) {
+        SPDLOG_WARN("Serial device '{}' marked as failed.", device);
+        state = SC_ERROR;
+    }
+}
+
+SerialConnectionState SerialConnection::get_state() const { return state; }
+
 void SerialConnection::openTty(const std::string& device) {
     assert(state == SC_DISABLED || state == SC_ERROR);
     // Open with:
@@ -43,6 +133,7 @@ void SerialConnection::openTty(const std::string& device) {
         throw std::runtime_error("Failed to open '" + device + "' with: " + strerror(errno));
     }
     tcflush(fd, TCIOFLUSH);
+    rxBuffer.clear();
     state = SC_OPENED;
     SPDLOG_INFO("Successfully opened serial device: {}", device);
 }
@@ -67,17 +158,20 @@ void SerialConnection::configureTty() {
     config.c_lflag = 0;
     /**
      * Max time in tenth of seconds between characters allowed.
-     * We abuse this since the coffee maker will make a 8ms break between each byte it sends.
-     * For fail safe reasons we allow 2 ms between the individual bytes.
+     * The coffee maker will make a 8ms break between each byte it sends.
      * http://unixwiz.net/techtips/termios-vmin-vtime.html
      **/
-    config.c_cc[VTIME] = 2;
+    config.c_cc[VTIME] = profile.vtime;
     /**
      * Number of characters have been received, with no more data available.
      * http://unixwiz.net/techtips/termios-vmin-vtime.html
      **/
-    config.c_cc[VMIN] = 4;
-    if (cfsetispeed(&config, B9600) < 0 || cfsetospeed(&config, B9600) < 0) {
+    config.c_cc[VMIN] = profile.vmin;
+    const speed_t speed = to_speed(profile.baudRate);
+    if (speed == B0) {
+        throw std::runtime_error("Failed to set the baud rate for '" + device + "'. Unsupported baud rate: " + std::to_string(profile.baudRate));
+    }
+    if (cfsetispeed(&config, speed) < 0 || cfsetospeed(&config, speed) < 0) {
         // NOLINTNEXTLINE (concurrency-mt-unsafe)
         throw std::runtime_error("Failed to set the baud rate for '" + device + "' with: " + strerror(errno));
     }
@@ -86,12 +180,102 @@ void SerialConnection::configureTty() {
         // NOLINTNEXTLINE (concurrency-mt-unsafe)
         throw std::runtime_error("Failed to set configuration for '" + device + "' with: " + strerror(errno));
     }
+
+    // tcsetattr() succeeds in case any of the requested changes could be performed, so read back what took effect:
+    settings = LinkSettings{};
+    if (tcgetattr(fd, &config) == 0) {
+        settings.baudRate = from_speed(cfgetispeed(&config));
+        settings.vmin = config.c_cc[VMIN];
+        settings.vtime = config.c_cc[VTIME];
+    }
+    configureLatency();
     state = SC_READY;
-    SPDLOG_INFO("Successfully configured serial device.");
+    SPDLOG_INFO("Successfully configured serial device ({} baud, VMIN={}, VTIME={}, low latency: {}, latency timer: {}ms).", settings.baudRate, settings.vmin, settings.vtime, settings.lowLatency, settings.latencyTimerMs);
+}
+
+void SerialConnection::configureLatency() {
+    serial_struct info{};
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+    if (ioctl(fd, TIOCGSERIAL, &info) == 0) {
+        settings.serialInfoSupported = true;
+        if (profile.lowLatency) {
+            // NOLINTNEXTLINE (hicpp-signed-bitwise)
+            info.flags |= ASYNC_LOW_LATENCY;
+        } else {
+            // NOLINTNEXTLINE (hicpp-signed-bitwise)
+            info.flags &= ~ASYNC_LOW_LATENCY;
+        }
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+        if (ioctl(fd, TIOCSSERIAL, &info) < 0) {
+            // NOLINTNEXTLINE (concurrency-mt-unsafe)
+            SPDLOG_DEBUG("TIOCSSERIAL for '{}' failed with: {}", device, strerror(errno));
+        }
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-vararg, hicpp-vararg)
+        if (ioctl(fd, TIOCGSERIAL, &info) == 0) {
+            // NOLINTNEXTLINE (hicpp-signed-bitwise)
+            settings.lowLatency = (info.flags & ASYNC_LOW_LATENCY) != 0;
+        }
+    }
+
+    // USB to serial adapters (e.g. ftdi_sio) buffer received bytes up to their latency timer:
+    std::error_code ec;
+    std::filesystem::path latencyTimer = std::filesystem::path(SYSFS_TTY_DIR) / std::filesystem::canonical(device, ec).filename() / "device" / "latency_timer";
+    if (ec || !std::filesystem::exists(latencyTimer, ec)) {
+        return;
+    }
+    int value = -1;
+    if (!(std::ifstream(latencyTimer) >> value)) {
+        return;
+    }
+    if (!profile.lowLatencyTimer) {
+        // In case we lowered it for a previous profile:
+        restoreLatencyTimer();
+        std::ifstream(latencyTimer) >> value;
+    } else if (value > 1) {
+        // Requires write access to sysfs. In case it fails, we report the old value:
+        if (write_sysfs(latencyTimer, 1)) {
+            if (restoreLatencyTimerMs < 0) {
+                latencyTimerPath = latencyTimer;
+                restoreLatencyTimerMs = value;
+            }
+            std::ifstream(latencyTimer) >> value;
+        } else {
+            SPDLOG_DEBUG("Failed to lower the latency timer of '{}'.", device);
+        }
+    }
+    settings.latencyTimerMs = value;
 }
 
+void SerialConnection::restoreLatencyTimer() {
+    if (restoreLatencyTimerMs < 0) {
+        return;
+    }
+    if (!write_sysfs(latencyTimerPath, restoreLatencyTimerMs)) {
+        SPDLOG_WARN("Failed to restore the latency timer '{}' to {}ms.", latencyTimerPath.string(), restoreLatencyTimerMs);
+    }
+    restoreLatencyTimerMs = -1;
+}
+
+void SerialConnection::set_profile(const LinkProfile& profile) {
+    this->profile = profile;
+    if (state == SC_READY) {
+        state = SC_OPENED;
+        try {
+            configureTty();
+        } catch (...) {
+            state = SC_ERROR;
+            throw;
+        }
+    }
+}
+
+const LinkProfile& SerialConnection::get_profile() const { return profile; }
+
+const LinkSettings& SerialConnection::get_link_settings() const { return settings; }
+
 void SerialConnection::closeTty() {
     if (state != SC_DISABLED) {
+        restoreLatencyTimer();
         close(fd);
         fd = -1;
         SPDLOG_INFO("Serial device closed.");
@@ -99,24 +283,160 @@ void SerialConnection::closeTty() {
     }
 }
 
-size_t SerialConnection::read_serial(std::array<uint8_t, 4>& buffer) const {
-    assert(state == SC_READY);
-    return read(fd, buffer.data(), buffer.size());
+size_t SerialConnection::read_serial(std::array<uint8_t, 4>& buffer) {
+    if (rxBuffer.empty()) {
+        static_cast<void>(fill_rx());
+    }
+    size_t count = 0;
+    while (count < buffer.size() && !rxBuffer.empty()) {
+        std::span<const uint8_t> data = rxBuffer.read_span();
+        size_t len = std::min(data.size(), buffer.size() - count);
+        std::copy_n(data.begin(), len, buffer.begin() + static_cast<std::ptrdiff_t>(count));
+        rxBuffer.consume(len);
+        count += len;
+    }
+    return count;
 }
 
-size_t SerialConnection::write_serial(const std::array<uint8_t, 4>& data) const {
-    assert(state == SC_READY);
-    size_t result = write(fd, data.data(), data.size());
-    return result;
+size_t SerialConnection::fill_rx() {
+    if (state != SC_READY) {
+        return 0;
+    }
+    std::array<std::span<uint8_t>, 2> spans = rxBuffer.write_spans();
+    if (spans[0].empty()) {
+        rxBuffer.record_overflow();
+        return 0;
+    }
+    std::array<iovec, 2> iov{};
+    int iovCount = 0;
+    for (std::span<uint8_t>& span : spans) {
+        if (!span.empty()) {
+            iov[iovCount].iov_base = span.data();
+            iov[iovCount].iov_len = span.size();
+            iovCount++;
+        }
+    }
+    ssize_t result = readv(fd, iov.data(), iovCount);
+    if (result <= 0) {
+        // 0 signals a hangup, since the file descriptor is non-blocking:
+        if (result == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // NOLINTNEXTLINE (concurrency-mt-unsafe)
+            SPDLOG_WARN("Reading from '{}' failed with: {}", device, result == 0 ? "hangup" : strerror(errno));
+            counters.on_error();
+            state = SC_ERROR;
+        }
+        return 0;
+    }
+    rxBuffer.commit(static_cast<size_t>(result));
+    counters.on_read(static_cast<size_t>(result));
+    return static_cast<size_t>(result);
+}
+
+std::span<const uint8_t> SerialConnection::peek_rx() const {
+    return rxBuffer.read_span();
+}
+
+void SerialConnection::consume_rx(size_t count) {
+    rxBuffer.consume(count);
+}
+
+const RingBuffer& SerialConnection::get_rx_buffer() const { return rxBuffer; }
+
+const WireCounters& SerialConnection::get_wire_counters() const { return counters; }
+
+bool SerialConnection::wait_readable(const std::chrono::milliseconds& timeout) const {
+    if (state != SC_READY) {
+        return false;
+    }
+    pollfd pfd{};
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        int waitMs = -1;
+        if (timeout.count() >= 0) {
+            waitMs = static_cast<int>(std::max(std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count(), static_cast<int64_t>(0)));
+        }
+        int result = poll(&pfd, 1, waitMs);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        return result > 0 && (pfd.revents & (POLLIN | POLLHUP | POLLERR));
+    }
+}
+
+size_t SerialConnection::write_serial(const std::array<uint8_t, 4>& data) {
+    return write_serial(std::span<const uint8_t>(data));
+}
+
+size_t SerialConnection::write_serial(std::span<const uint8_t> data) {
+    if (state != SC_READY) {
+        return 0;
+    }
+    ssize_t result = write(fd, data.data(), data.size());
+    if (result < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            // NOLINTNEXTLINE (concurrency-mt-unsafe)
+            SPDLOG_WARN("Writing to '{}' failed with: {}", device, strerror(errno));
+            counters.on_error();
+            state = SC_ERROR;
+        }
+        counters.on_write(data.size(), 0);
+        return 0;
+    }
+    counters.on_write(data.size(), static_cast<size_t>(result));
+    return static_cast<size_t>(result);
 }
 
 void SerialConnection::flush() const {
+    if (state != SC_READY) {
+        return;
+    }
     // Wait until everything has been send:
     tcdrain(fd);
 }
 
+int SerialConnection::get_fd() const { return fd; }
+
 std::vector<std::string> SerialConnection::get_available_ports() {
     std::vector<std::string> ports{};
+    std::set<std::filesystem::path> devices{};
+    std::error_code ec;
+
+    // Prefer the stable /dev/serial/by-id/... names, since they survive reboots and replugging:
+    for (std::filesystem::directory_iterator it(BY_ID_DIR, ec), end; !ec && it != end; it.increment(ec)) {
+        std::filesystem::path device = std::filesystem::canonical(it->path(), ec);
+        if (ec) {
+            ec.clear();
+            continue;
+        }
+        if (devices.insert(device).second) {
+            ports.push_back(it->path().string());
+        }
+    }
+    ec.clear();
+
+    // Everything else backed by an actual device driver (e.g. on board UARTs without a by-id entry):
+    for (std::filesystem::directory_iterator it(SYSFS_TTY_DIR, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code driverEc;
+        std::filesystem::path driver = std::filesystem::read_symlink(it->path() / "device" / "driver", driverEc);
+        if (driverEc) {
+            continue;  // Virtual terminal (tty0, ptmx, ...)
+        }
+        std::filesystem::path device = std::filesystem::path("/dev") / it->path().filename();
+        if (devices.contains(device) || (driver.filename() == "serial8250" && !is_present_8250_port(device))) {
+            continue;
+        }
+        devices.insert(device);
+        ports.push_back(device.string());
+    }
+    std::sort(ports.begin(), ports.end(), [](const std::string& a, const std::string& b) {
+        // Keep by-id entries first:
+        bool aById = a.starts_with(BY_ID_DIR);
+        bool bById = b.starts_with(BY_ID_DIR);
+        return aById != bById ? aById : a < b;
+    });
+    SPDLOG_DEBUG("Found {} serial port(s).", ports.size());
     return ports;
 }
 //---------------------------------------------------------------------------
@@ -0,0 +1,40 @@
+#include "serial/WireCounters.hpp"
+
+//---------------------------------------------------------------------------
+namespace serial {
+//---------------------------------------------------------------------------
+void WireCounters::on_read(size_t count) {
+    if (count <= 0) {
+        return;
+    }
+    bytesIn.fetch_add(count, std::memory_order_relaxed);
+    reads.fetch_add(1, std::memory_order_relaxed);
+    if (count % 4 != 0) {
+        shortReads.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void WireCounters::on_write(size_t requested, size_t written) {
+    bytesOut.fetch_add(written, std::memory_order_relaxed);
+    writes.fetch_add(1, std::memory_order_relaxed);
+    if (written < requested) {
+        shortWrites.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void WireCounters::on_error() { errors.fetch_add(1, std::memory_order_relaxed); }
+
+WireCounters::Snapshot WireCounters::get_snapshot() const {
+    Snapshot snapshot;
+    snapshot.bytesIn = bytesIn.load(std::memory_order_relaxed);
+    snapshot.bytesOut = bytesOut.load(std::memory_order_relaxed);
+    snapshot.reads = reads.load(std::memory_order_relaxed);
+    snapshot.shortReads = shortReads.load(std::memory_order_relaxed);
+    snapshot.writes = writes.load(std::memory_order_relaxed);
+    snapshot.shortWrites = shortWrites.load(std::memory_order_relaxed);
+    snapshot.errors = errors.load(std::memory_order_relaxed);
+    return snapshot;
+}
+//---------------------------------------------------------------------------
+}  // namespace serial
+//---------------------------------------------------------------------------
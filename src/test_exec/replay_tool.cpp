@@ -0,0 +1,67 @@
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/TraceReplayer.hpp"
+#include "logger/Logger.hpp"
+#include "serial/LoopbackConnection.hpp"
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+// Usage: jutta_replay <capture or snoop> [--fast] [--repeat <count>]
+// Replays the given trace with its original timing and prints all received frames.
+// With --fast, the trace gets replayed as fast as possible (repeated <count> times) for measuring the throughput of the stack.
+int main(int argc, char** argv) {
+    logger::setup_logger(spdlog::level::info);
+    if (argc < 2) {
+        SPDLOG_ERROR("Usage: {} <capture or snoop> [--fast] [--repeat <count>]", argv[0]);
+        return -1;
+    }
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
+    jutta_proto::replay_mode_t mode = jutta_proto::replay_mode_t::ORIGINAL_TIMING;
+    size_t repeat = 1;
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] == "--fast") {
+            mode = jutta_proto::replay_mode_t::AS_FAST_AS_POSSIBLE;
+        } else if (args[i] == "--repeat" && i + 1 < args.size()) {
+            repeat = std::stoul(std::string(args[++i]));
+        }
+    }
+
+    try {
+        const jutta_proto::TraceReplayer replayer = jutta_proto::TraceReplayer::load(std::string(args[0]));
+        SPDLOG_INFO("Loaded {} events spanning {}ms.", replayer.get_events().size(), std::chrono::duration_cast<std::chrono::milliseconds>(replayer.get_duration()).count());
+
+        jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+        connection.init();
+        if (mode == jutta_proto::replay_mode_t::ORIGINAL_TIMING) {
+            static_cast<void>(connection.get_router().subscribe("", [](std::string_view frame) {
+                std::vector<uint8_t> data(frame.begin(), frame.end());
+                SPDLOG_INFO("Received: {}", jutta_proto::JuttaConnection::vec_to_string(data));
+            }));
+        }
+
+        jutta_proto::TraceReplayer::Stats total;
+        for (size_t i = 0; i < repeat; i++) {
+            jutta_proto::TraceReplayer::Stats stats = replayer.replay(connection, mode);
+            total.rxEvents += stats.rxEvents;
+            total.txEvents += stats.txEvents;
+            total.rxBytes += stats.rxBytes;
+            total.frames += stats.frames;
+            total.elapsed += stats.elapsed;
+        }
+        const double seconds = std::chrono::duration<double>(total.elapsed).count();
+        SPDLOG_INFO("Replayed {} received events ({} wire bytes, {} frames, {} send events skipped) in {:.3f}ms.", total.rxEvents, total.rxBytes, total.frames, total.txEvents, seconds * 1000);
+        if (seconds > 0) {
+            SPDLOG_INFO("Throughput: {:.1f} MB/s wire, {:.0f} frames/s.", static_cast<double>(total.rxBytes) / seconds / 1e6, static_cast<double>(total.frames) / seconds);
+        }
+        const jutta_proto::StreamDecoder::Stats decoderStats = connection.get_decoder_stats();
+        SPDLOG_INFO("Decoder: {} quads, {} realignments, {} discarded bytes.", decoderStats.quads, decoderStats.realignments, decoderStats.discardedBytes);
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("Replay failed: {}", e.what());
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+#include <vector>
+
+namespace {
+std::atomic<bool> countAllocations{false};
+std::atomic<size_t> allocations{0};
+}  // namespace
+
+void* operator new(size_t size) {
+    if (countAllocations) {
+        allocations++;
+    }
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, size_t /*size*/) noexcept { std::free(ptr); }
+
+TEST_CASE("Commands do not allocate in steady state", "[allocation]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::nanoseconds{0});
+    jutta_proto::tests::make_responder(connection.get_transport(), "ty:EF532M V02.03\r\n");
+    connection.init();
+
+    constexpr std::string_view COMMAND = "TY:\r\n";
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::span<const uint8_t> data(reinterpret_cast<const uint8_t*>(COMMAND.data()), COMMAND.size());
+    std::array<char, 64> buffer{};
+
+    // Warm up, so all reused buffers reached their final capacity:
+    for (size_t i = 0; i < 4; i++) {
+        REQUIRE(connection.write_decoded_with_response(data, buffer));
+        REQUIRE(connection.write_decoded_with_fixed_response(data));
+        REQUIRE(connection.write_decoded_wait_for(data, "ty:"));
+        REQUIRE(connection.write_command_wait_for(jutta_proto::jutta_command_t::GET_TYPE));
+    }
+
+    size_t succeeded = 0;
+    allocations = 0;
+    countAllocations = true;
+    for (size_t i = 0; i < 32; i++) {
+        std::optional<size_t> len = connection.write_decoded_with_response(data, buffer);
+        std::optional<jutta_proto::JuttaConnection::Response> fixed = connection.write_decoded_with_fixed_response(data);
+        if (len && *len == 18 && fixed && fixed->view() == "ty:EF532M V02.03\r\n" && connection.write_decoded_wait_for(data, "ty:") && connection.write_command_wait_for(jutta_proto::jutta_command_t::GET_TYPE)) {
+            succeeded++;
+        }
+    }
+    countAllocations = false;
+
+    REQUIRE(succeeded == 32);
+    REQUIRE(allocations == 0);
+}
+
+TEST_CASE("Too long responses do not fit into the given buffer", "[allocation]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::nanoseconds{0});
+    jutta_proto::tests::make_responder(connection.get_transport(), "ty:EF532M V02.03\r\n");
+    connection.init();
+
+    constexpr std::string_view COMMAND = "TY:\r\n";
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    const std::span<const uint8_t> data(reinterpret_cast<const uint8_t*>(COMMAND.data()), COMMAND.size());
+    std::array<char, 8> buffer{};
+    REQUIRE_FALSE(connection.write_decoded_with_response(data, buffer));
+    // The link is still fine:
+    REQUIRE(connection.is_link_up());
+}
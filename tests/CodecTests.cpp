@@ -0,0 +1,7 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/JuttaConnection.hpp"
+
+TEST_CASE("Scalar, table and SIMD codec agree for all inputs", "[codec]") {
+    REQUIRE(jutta_proto::JuttaConnection::run_encode_decode_test());
+}
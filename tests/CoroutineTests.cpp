@@ -0,0 +1,85 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/CoroutineConnection.hpp"
+#include "jutta_proto/EventLoop.hpp"
+#include "jutta_proto/Task.hpp"
+#include "serial/PtyConnection.hpp"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C" {
+#include <poll.h>
+#include <unistd.h>
+}
+
+using jutta_proto::tests::encode;
+
+namespace {
+struct FlowResult {
+    std::shared_ptr<std::string> reply{nullptr};
+    std::chrono::steady_clock::duration slept{0};
+    std::string error{};
+    bool done{false};
+};
+
+jutta_proto::Task<int> fail_after_sleep(jutta_proto::CoroutineConnection& connection) {
+    co_await connection.sleep(std::chrono::milliseconds{1});
+    throw std::runtime_error("brew failed");
+}
+
+jutta_proto::Task<void> flow(jutta_proto::CoroutineConnection& connection, FlowResult& result) {
+    result.reply = co_await connection.write_decoded_with_response("TY:\r\n", std::chrono::milliseconds{2000});
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    co_await connection.sleep(std::chrono::milliseconds{50});
+    result.slept = std::chrono::steady_clock::now() - start;
+
+    try {
+        static_cast<void>(co_await fail_after_sleep(connection));
+    } catch (const std::runtime_error& e) {
+        result.error = e.what();
+    }
+    result.done = true;
+}
+}  // namespace
+
+TEST_CASE("Coroutine resumes with the reply, after sleeping and with exceptions", "[coroutine]") {
+    std::shared_ptr<serial::PtyConnection> pty = std::make_shared<serial::PtyConnection>();
+    pty->init();
+    jutta_proto::EventLoop loop;
+    jutta_proto::CoroutineConnection connection(loop, loop.add_machine(pty));
+
+    FlowResult result;
+    jutta_proto::spawn(flow(connection, result));
+
+    // Act as the coffee maker and respond once the whole request arrived:
+    const size_t requestSize = encode("TY:\r\n").size();
+    const std::vector<uint8_t> reply = encode("ty:EF532M V02.03\r\n");
+    size_t received = 0;
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds{2};
+    while (!result.done && std::chrono::steady_clock::now() < deadline) {
+        loop.run_once(std::chrono::milliseconds{10});
+        pollfd peer{pty->get_peer_fd(), POLLIN, 0};
+        if (received < requestSize && poll(&peer, 1, 0) > 0) {
+            std::vector<uint8_t> buffer(requestSize);
+            const ssize_t count = read(pty->get_peer_fd(), buffer.data(), buffer.size() - received);
+            REQUIRE(count > 0);
+            received += static_cast<size_t>(count);
+            if (received >= requestSize) {
+                REQUIRE(write(pty->get_peer_fd(), reply.data(), reply.size()) == static_cast<ssize_t>(reply.size()));
+            }
+        }
+    }
+
+    REQUIRE(result.done);
+    REQUIRE(result.reply);
+    REQUIRE(*result.reply == "ty:EF532M V02.03\r\n");
+    REQUIRE(result.slept >= std::chrono::milliseconds{50});
+    REQUIRE(result.error == "brew failed");
+}
@@ -0,0 +1,55 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/AsyncJuttaConnection.hpp"
+#include "jutta_proto/EventLoop.hpp"
+#include "serial/PtyConnection.hpp"
+
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+}
+
+using jutta_proto::tests::encode;
+
+TEST_CASE("Stopping the loop before it runs does not hang", "[eventloop]") {
+    for (size_t i = 0; i < 1000; i++) {
+        jutta_proto::EventLoop loop;
+        std::thread thread([&loop]() { loop.run(); });
+        loop.stop();
+        thread.join();
+    }
+}
+
+TEST_CASE("Stopping the loop before run() got called returns right away", "[eventloop]") {
+    jutta_proto::EventLoop loop;
+    loop.stop();
+    loop.run();
+}
+
+TEST_CASE("Async connection can be destroyed right after construction", "[eventloop]") {
+    for (size_t i = 0; i < 100; i++) {
+        std::shared_ptr<serial::PtyConnection> pty = std::make_shared<serial::PtyConnection>();
+        pty->init();
+        jutta_proto::AsyncJuttaConnection connection(pty);
+    }
+}
+
+TEST_CASE("wait_for_ok picks up an ok that arrived before it got submitted", "[eventloop]") {
+    std::shared_ptr<serial::PtyConnection> pty = std::make_shared<serial::PtyConnection>();
+    pty->init();
+    jutta_proto::AsyncJuttaConnection connection(pty);
+    REQUIRE(connection.write_decoded("AN:01\r\n").get());
+
+    // The coffee maker responds before wait_for_ok() gets submitted:
+    const std::vector<uint8_t> ok = encode("ok:\r\n");
+    REQUIRE(write(pty->get_peer_fd(), ok.data(), ok.size()) == static_cast<ssize_t>(ok.size()));
+    std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    REQUIRE(connection.wait_for_ok(std::chrono::milliseconds{500}).get());
+    // It only gets picked up once:
+    REQUIRE_FALSE(connection.wait_for_ok(std::chrono::milliseconds{100}).get());
+}
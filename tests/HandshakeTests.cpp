@@ -0,0 +1,139 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/Handshake.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using jutta_proto::Handshake;
+using jutta_proto::handshake_state_t;
+
+namespace {
+using namespace std::chrono_literals;
+
+const Handshake::TimePoint START = Handshake::TimePoint{} + 1h;
+
+/**
+ * Drives the handshake into the given state.
+ **/
+void advance_to(Handshake& handshake, handshake_state_t state) {
+    REQUIRE(handshake.start(START) == Handshake::START_REQUEST);
+    if (state == handshake_state_t::WAIT_START) {
+        return;
+    }
+    REQUIRE(handshake.on_frame("@t1\r\n", START + 10ms).consumed);
+    if (state == handshake_state_t::WAIT_KEY_EXCHANGE) {
+        return;
+    }
+    REQUIRE(handshake.on_frame("@T2:010001B228\r\n", START + 20ms).send == handshake.get_config().keyExchangeResponse);
+    REQUIRE(handshake.get_state() == handshake_state_t::WAIT_END);
+}
+}  // namespace
+
+TEST_CASE("Handshake completes", "[handshake]") {
+    Handshake handshake;
+    REQUIRE(handshake.get_state() == handshake_state_t::IDLE);
+    advance_to(handshake, handshake_state_t::WAIT_END);
+    Handshake::Step step = handshake.on_frame("@T3:3BDEEF532M V02.03\r\n", START + 50ms);
+    REQUIRE(step.consumed);
+    REQUIRE(step.send == Handshake::END_RESPONSE);
+    REQUIRE(handshake.is_done());
+    REQUIRE(handshake.is_finished());
+    REQUIRE(handshake.get_deadline() == Handshake::TimePoint::max());
+    REQUIRE(handshake.get_key_exchange()->keySize == 5);
+    REQUIRE((*handshake.get_token())[0] == 0x3B);
+
+    const Handshake::Timing& timing = handshake.get_timing();
+    REQUIRE(timing.start == 10ms);
+    REQUIRE(timing.keyExchange == 10ms);
+    REQUIRE(timing.end == 30ms);
+    REQUIRE(timing.total == 50ms);
+    // Nothing times out once done:
+    REQUIRE_FALSE(handshake.on_tick(START + 1h));
+}
+
+TEST_CASE("Handshake fails once the deadline of a step passed", "[handshake]") {
+    const handshake_state_t state = GENERATE(handshake_state_t::WAIT_START, handshake_state_t::WAIT_KEY_EXCHANGE, handshake_state_t::WAIT_END);
+    Handshake handshake;
+    advance_to(handshake, state);
+    const Handshake::TimePoint deadline = handshake.get_deadline();
+    REQUIRE(deadline < Handshake::TimePoint::max());
+
+    REQUIRE_FALSE(handshake.on_tick(deadline - 1ms));
+    REQUIRE(handshake.get_state() == state);
+    REQUIRE(handshake.on_tick(deadline));
+    REQUIRE(handshake.get_state() == handshake_state_t::FAILED);
+    REQUIRE(handshake.get_failed_state() == state);
+    REQUIRE(handshake.is_finished());
+    REQUIRE_FALSE(handshake.is_done());
+    REQUIRE(handshake.get_deadline() == Handshake::TimePoint::max());
+    REQUIRE(handshake.get_timing().total == deadline - START);
+}
+
+TEST_CASE("Handshake deadlines follow the configured timeouts", "[handshake]") {
+    Handshake handshake;
+    const Handshake::Config& config = handshake.get_config();
+    advance_to(handshake, handshake_state_t::WAIT_START);
+    REQUIRE(handshake.get_deadline() == START + config.startTimeout);
+    advance_to(handshake, handshake_state_t::WAIT_KEY_EXCHANGE);
+    REQUIRE(handshake.get_deadline() == START + 10ms + config.keyExchangeTimeout);
+    advance_to(handshake, handshake_state_t::WAIT_END);
+    REQUIRE(handshake.get_deadline() == START + 20ms + config.endTimeout);
+}
+
+TEST_CASE("Handshake ignores unrelated and malformed frames", "[handshake]") {
+    Handshake handshake;
+    advance_to(handshake, handshake_state_t::WAIT_KEY_EXCHANGE);
+    // Not part of the handshake, so it should be dispatched as usual:
+    REQUIRE_FALSE(handshake.on_frame("&abc\r\n", START + 15ms).consumed);
+    REQUIRE_FALSE(handshake.on_frame("@T3:3BDEEF532M\r\n", START + 15ms).consumed);
+    // Malformed key exchange requests get consumed, but do not advance the handshake:
+    Handshake::Step step = handshake.on_frame("@T2:010\r\n", START + 15ms);
+    REQUIRE(step.consumed);
+    REQUIRE(step.send.empty());
+    REQUIRE(handshake.get_state() == handshake_state_t::WAIT_KEY_EXCHANGE);
+
+    // Restarting starts over:
+    advance_to(handshake, handshake_state_t::WAIT_START);
+    REQUIRE_FALSE(handshake.get_key_exchange());
+}
+
+TEST_CASE("Handshake runs over a connection", "[handshake]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::nanoseconds{0});
+    std::vector<std::string> received;
+    jutta_proto::tests::make_responder(connection.get_transport(), [&](std::string_view request) -> std::string {
+        received.emplace_back(request);
+        if (request == Handshake::START_REQUEST) {
+            return "@t1\r\n&abc\r\n@T2:010001B228\r\n";
+        }
+        if (request.starts_with("@t2:")) {
+            return "@T3:3BDEEF532M V02.03\r\n";
+        }
+        return "";
+    });
+    connection.init();
+
+    Handshake handshake;
+    REQUIRE(connection.perform_handshake(handshake));
+    REQUIRE(handshake.is_done());
+    REQUIRE(received == std::vector<std::string>{"@T1\r\n", "@t2:8120000000\r\n", "@t3\r\n"});
+}
+
+TEST_CASE("Handshake over a connection fails after the deadline", "[handshake]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::nanoseconds{0});
+    connection.init();
+
+    Handshake::Config config;
+    config.startTimeout = 50ms;
+    Handshake handshake(config);
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    REQUIRE_FALSE(connection.perform_handshake(handshake));
+    REQUIRE(std::chrono::steady_clock::now() - start >= 50ms);
+    REQUIRE(handshake.get_failed_state() == handshake_state_t::WAIT_START);
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/CommandLock.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/KeepAliveScheduler.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using jutta_proto::KeepAliveScheduler;
+
+namespace {
+using namespace std::chrono_literals;
+
+const KeepAliveScheduler::TimePoint START = KeepAliveScheduler::TimePoint{} + 1h;
+
+KeepAliveScheduler::Config make_config() {
+    KeepAliveScheduler::Config config;
+    config.interval = 1000ms;
+    config.maxLateness = 100ms;
+    config.maxCommandDelay = 50ms;
+    return config;
+}
+}  // namespace
+
+TEST_CASE("Keep-alives keep their schedule", "[keepalive]") {
+    KeepAliveScheduler scheduler(make_config());
+    REQUIRE(scheduler.get_next_due() == KeepAliveScheduler::TimePoint::max());
+    scheduler.start(START);
+    REQUIRE(scheduler.get_next_due() == START + 1000ms);
+    REQUIRE_FALSE(scheduler.is_due(START + 999ms));
+    REQUIRE(scheduler.is_due(START + 1000ms));
+
+    // Going out a bit late does not shift the schedule:
+    REQUIRE_FALSE(scheduler.on_sent(START + 1050ms, 10000us));
+    REQUIRE(scheduler.get_next_due() == START + 2000ms);
+    const KeepAliveScheduler::Stats& stats = scheduler.get_stats();
+    REQUIRE(stats.sent == 1);
+    REQUIRE(stats.missed == 0);
+    REQUIRE(stats.lastLateness == 50ms);
+    REQUIRE(stats.lastAirTime == 10000us);
+}
+
+TEST_CASE("Keep-alives later than maxLateness count as missed", "[keepalive]") {
+    KeepAliveScheduler scheduler(make_config());
+    scheduler.start(START);
+    REQUIRE(scheduler.on_sent(START + 3500ms, 10000us));
+    const KeepAliveScheduler::Stats& stats = scheduler.get_stats();
+    REQUIRE(stats.missed == 1);
+    REQUIRE(stats.maxLateness == 2500ms);
+    // Starts over instead of sending the backlog back to back:
+    REQUIRE(scheduler.get_next_due() == START + 4500ms);
+
+    REQUIRE_FALSE(scheduler.on_sent(START + 4500ms, 10000us));
+    REQUIRE(stats.lastLateness == 0us);
+    REQUIRE(stats.maxLateness == 2500ms);
+}
+
+TEST_CASE("Failed keep-alives get rescheduled", "[keepalive]") {
+    KeepAliveScheduler scheduler(make_config());
+    scheduler.start(START);
+    scheduler.on_failed(START + 1200ms);
+    REQUIRE(scheduler.get_stats().failed == 1);
+    REQUIRE(scheduler.get_stats().sent == 0);
+    REQUIRE(scheduler.get_next_due() == START + 2200ms);
+}
+
+TEST_CASE("Only keep-alives within maxCommandDelay overtake commands", "[keepalive]") {
+    KeepAliveScheduler scheduler(make_config());
+    scheduler.start(START);
+    // Already the first keep-alive is bound by its own air time:
+    REQUIRE_FALSE(scheduler.may_overtake(51ms));
+    REQUIRE(scheduler.get_stats().yielded == 1);
+    REQUIRE(scheduler.may_overtake(50ms));
+    REQUIRE(scheduler.get_stats().yielded == 1);
+}
+
+TEST_CASE("Priority holders get the command lock before regular waiters", "[keepalive]") {
+    jutta_proto::CommandLock lock;
+    std::mutex orderLock;
+    std::vector<int> order;
+    auto record = [&](int id) {
+        std::unique_lock<std::mutex> lk(orderLock);
+        order.push_back(id);
+    };
+
+    lock.lock();
+    std::thread regular([&]() {
+        lock.lock();
+        record(1);
+        lock.unlock();
+    });
+    std::this_thread::sleep_for(50ms);
+    std::thread priority([&]() {
+        lock.lock_priority();
+        record(2);
+        lock.unlock();
+    });
+    std::this_thread::sleep_for(50ms);
+    // Regular holders do not get it while a priority holder waits:
+    REQUIRE_FALSE(lock.try_lock());
+    lock.unlock();
+    regular.join();
+    priority.join();
+
+    REQUIRE(order == std::vector<int>{2, 1});
+    REQUIRE(lock.try_lock());
+    lock.unlock();
+}
+
+TEST_CASE("Keep-alives get send by the connection", "[keepalive]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::milliseconds{1});
+    connection.init();
+
+    KeepAliveScheduler::Config config;
+    config.interval = 20ms;
+    // Shorter than the air time of a single quad, so no keep-alive overtakes commands:
+    config.maxCommandDelay = 0ms;
+    std::atomic<size_t> frames{0};
+    connection.start_keep_alive(config, [&frames](std::vector<uint8_t>& frame) {
+        frame.push_back('&');
+        frame.push_back('\r');
+        frame.push_back('\n');
+        frames++;
+    });
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + 2s;
+    while (connection.get_keep_alive_stats().sent < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(5ms);
+    }
+    connection.stop_keep_alive();
+
+    const KeepAliveScheduler::Stats stats = connection.get_keep_alive_stats();
+    REQUIRE(stats.sent >= 2);
+    REQUIRE(frames == stats.sent + stats.failed);
+    REQUIRE(stats.yielded == stats.sent);
+    REQUIRE(stats.lastAirTime >= 3ms);
+
+    std::vector<uint8_t> tx;
+    connection.get_transport().take_tx(tx);
+    REQUIRE(tx.size() == stats.sent * 3 * jutta_proto::WIRE_QUAD_SIZE);
+}
@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/LineFramer.hpp"
+
+#include <optional>
+#include <string_view>
+
+namespace {
+void append(jutta_proto::LineFramer& framer, std::string_view data) {
+    std::vector<uint8_t>& buffer = framer.input();
+    buffer.insert(buffer.end(), data.begin(), data.end());
+}
+}  // namespace
+
+TEST_CASE("Framer splits frames", "[framer]") {
+    jutta_proto::LineFramer framer;
+    append(framer, "ty:EF532M V02.03\r\nok:\r\nrt:");
+    REQUIRE(framer.next() == "ty:EF532M V02.03\r\n");
+    REQUIRE(framer.next() == "ok:\r\n");
+    REQUIRE_FALSE(framer.next());
+    REQUIRE(framer.pending().size() == 3);
+}
+
+TEST_CASE("Framer handles a terminator split across input() calls", "[framer]") {
+    jutta_proto::LineFramer framer;
+    append(framer, "ok:\r");
+    REQUIRE_FALSE(framer.next());
+    append(framer, "\n");
+    REQUIRE(framer.next() == "ok:\r\n");
+    REQUIRE(framer.empty());
+}
+
+TEST_CASE("Framer does not end frames on a '\\n' without a preceding '\\r'", "[framer]") {
+    jutta_proto::LineFramer framer;
+    append(framer, "a\nb");
+    REQUIRE_FALSE(framer.next());
+    append(framer, "\r\n");
+    REQUIRE(framer.next() == "a\nb\r\n");
+    REQUIRE(framer.empty());
+}
+
+TEST_CASE("Framer does not end frames on a leading '\\n'", "[framer]") {
+    jutta_proto::LineFramer framer;
+    append(framer, "\r\n\nok:\r\n");
+    REQUIRE(framer.next() == "\r\n");
+    REQUIRE(framer.next() == "\nok:\r\n");
+}
+
+TEST_CASE("Framer keeps the incomplete tail when consuming and clearing", "[framer]") {
+    jutta_proto::LineFramer framer;
+    append(framer, "ok:\r\nty:");
+    framer.consume(5);
+    REQUIRE_FALSE(framer.next());
+    append(framer, "EF532M\r\n");
+    REQUIRE(framer.next() == "ty:EF532M\r\n");
+    append(framer, "partial");
+    framer.clear();
+    REQUIRE(framer.empty());
+    append(framer, "ok:\r\n");
+    REQUIRE(framer.next() == "ok:\r\n");
+}
+
+TEST_CASE("Framer drops frames exceeding the maximum frame size", "[framer]") {
+    jutta_proto::LineFramer framer(jutta_proto::LineFramer::DEFAULT_CAPACITY, 8);
+    append(framer, "0123456789");
+    REQUIRE_FALSE(framer.next());
+    // The rest of the dropped frame gets discarded as well:
+    append(framer, "abc\r");
+    REQUIRE_FALSE(framer.next());
+    append(framer, "\nok:\r\n");
+    REQUIRE(framer.next() == "ok:\r\n");
+    REQUIRE_FALSE(framer.next());
+    REQUIRE(framer.empty());
+    REQUIRE(framer.get_dropped_frames() == 1);
+
+    // Only incomplete frames get dropped, so a frame completed by a single input() call still gets handed out:
+    append(framer, "rt:0000\r\n");
+    REQUIRE(framer.next() == "rt:0000\r\n");
+    REQUIRE(framer.get_dropped_frames() == 1);
+}
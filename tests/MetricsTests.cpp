@@ -0,0 +1,44 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/Metrics.hpp"
+#include "jutta_proto/StreamDecoder.hpp"
+#include "serial/WireCounters.hpp"
+
+TEST_CASE("Decoder counters stay monotonic across decoder resets", "[metrics]") {
+    jutta_proto::MetricsRegistry registry;
+    const serial::WireCounters wire;
+    jutta_proto::StreamDecoder::Stats stats;
+    stats.realignments = 3;
+    stats.discardedBytes = 10;
+    registry.on_decoder_stats(stats);
+    stats.realignments = 4;
+    stats.discardedBytes = 12;
+    registry.on_decoder_stats(stats);
+    REQUIRE(registry.get_snapshot(wire).realignments == 4);
+    REQUIRE(registry.get_snapshot(wire).discardedBytes == 12);
+
+    // Reconnecting resets the decoder:
+    registry.on_decoder_reset();
+    stats.realignments = 1;
+    stats.discardedBytes = 2;
+    registry.on_decoder_stats(stats);
+    REQUIRE(registry.get_snapshot(wire).realignments == 5);
+    REQUIRE(registry.get_snapshot(wire).discardedBytes == 14);
+
+    // A reset without on_decoder_reset() does not make the counters go backwards either:
+    stats.realignments = 0;
+    stats.discardedBytes = 1;
+    registry.on_decoder_stats(stats);
+    REQUIRE(registry.get_snapshot(wire).realignments == 5);
+    REQUIRE(registry.get_snapshot(wire).discardedBytes == 15);
+}
+
+TEST_CASE("Dropped frames get published as they grow", "[metrics]") {
+    jutta_proto::MetricsRegistry registry;
+    const serial::WireCounters wire;
+    registry.on_framer_stats(2);
+    registry.on_framer_stats(2);
+    REQUIRE(registry.get_snapshot(wire).droppedFrames == 2);
+    registry.on_framer_stats(3);
+    REQUIRE(registry.get_snapshot(wire).droppedFrames == 3);
+}
@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/ResponseParser.hpp"
+
+#include <variant>
+
+using jutta_proto::parse_response;
+using jutta_proto::ParsedResponse;
+using jutta_proto::response_kind_t;
+
+TEST_CASE("Responses get classified by their prefix", "[parser]") {
+    REQUIRE(jutta_proto::classify_response("ok:\r\n") == response_kind_t::OK);
+    REQUIRE(jutta_proto::classify_response("ty:EF532M V02.03\r\n") == response_kind_t::TYPE);
+    REQUIRE(jutta_proto::classify_response("@t1\r\n") == response_kind_t::HANDSHAKE_START);
+    REQUIRE(jutta_proto::classify_response("@T2:010001B228\r\n") == response_kind_t::KEY_EXCHANGE);
+    REQUIRE(jutta_proto::classify_response("@T3:3BDEEF532M V02.03\r\n") == response_kind_t::HANDSHAKE_END);
+    REQUIRE(jutta_proto::classify_response("Ku:00\r\n") == response_kind_t::DEBUG);
+    REQUIRE(jutta_proto::classify_response("&X\r\n") == response_kind_t::ENCRYPTED);
+    REQUIRE(jutta_proto::classify_response("") == response_kind_t::UNKNOWN);
+    REQUIRE(jutta_proto::classify_response("ok") == response_kind_t::UNKNOWN);
+    REQUIRE(jutta_proto::classify_response("xy:\r\n") == response_kind_t::UNKNOWN);
+}
+
+TEST_CASE("Type responses get split into model and firmware", "[parser]") {
+    ParsedResponse parsed = parse_response("ty:EF532M V02.03\r\n");
+    const jutta_proto::TypeResponse& type = std::get<jutta_proto::TypeResponse>(parsed);
+    REQUIRE(type.model == "EF532M");
+    REQUIRE(type.firmware == "V02.03");
+
+    parsed = parse_response("ty:EF532M\r\n");
+    REQUIRE(std::get<jutta_proto::TypeResponse>(parsed).model == "EF532M");
+    REQUIRE(std::get<jutta_proto::TypeResponse>(parsed).firmware.empty());
+}
+
+TEST_CASE("Key exchange responses get their key parsed", "[parser]") {
+    ParsedResponse parsed = parse_response("@T2:010001b228\r\n");
+    const jutta_proto::KeyExchangeResponse& keyExchange = std::get<jutta_proto::KeyExchangeResponse>(parsed);
+    REQUIRE(keyExchange.keySize == 5);
+    REQUIRE(keyExchange.key[0] == 0x01);
+    REQUIRE(keyExchange.key[3] == 0xB2);
+    REQUIRE(keyExchange.key[4] == 0x28);
+}
+
+TEST_CASE("Malformed key exchange responses are unknown", "[parser]") {
+    // Odd length hex:
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T2:010001B22\r\n")));
+    // Invalid hex characters:
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T2:01G0\r\n")));
+    // Missing ':':
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T2\r\n")));
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T2-0100\r\n")));
+    // Key too long:
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T2:000102030405060708090A0B0C0D0E0F10\r\n")));
+}
+
+TEST_CASE("Handshake end responses get their token and type parsed", "[parser]") {
+    ParsedResponse parsed = parse_response("@T3:3BDEEF532M V02.03\r\n");
+    const jutta_proto::HandshakeEndResponse& end = std::get<jutta_proto::HandshakeEndResponse>(parsed);
+    REQUIRE(end.token[0] == 0x3B);
+    REQUIRE(end.token[1] == 0xDE);
+    REQUIRE(end.type.model == "EF532M");
+    REQUIRE(end.type.firmware == "V02.03");
+}
+
+TEST_CASE("Handshake end responses without a type have an empty type", "[parser]") {
+    ParsedResponse parsed = parse_response("@T3:3BDE\r\n");
+    const jutta_proto::HandshakeEndResponse& end = std::get<jutta_proto::HandshakeEndResponse>(parsed);
+    REQUIRE(end.token[0] == 0x3B);
+    REQUIRE(end.type.model.empty());
+    REQUIRE(end.type.firmware.empty());
+
+    // A truncated token is malformed:
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T3:3BD\r\n")));
+    REQUIRE(std::holds_alternative<jutta_proto::UnknownResponse>(parse_response("@T3:3BXXEF532M\r\n")));
+}
+
+TEST_CASE("Debug responses keep their payload", "[parser]") {
+    ParsedResponse parsed = parse_response("Ku:0102\r\n");
+    REQUIRE(std::get<jutta_proto::DebugResponse>(parsed).upper);
+    REQUIRE(std::get<jutta_proto::DebugResponse>(parsed).payload == "0102");
+    parsed = parse_response("ku:03\r\n");
+    REQUIRE_FALSE(std::get<jutta_proto::DebugResponse>(parsed).upper);
+}
@@ -0,0 +1,90 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/RttEstimator.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <atomic>
+#include <string>
+#include <string_view>
+
+using jutta_proto::jutta_command_t;
+using jutta_proto::RttEstimator;
+using jutta_proto::tests::encode;
+
+TEST_CASE("Deadlines get learned from the round trip times", "[rtt]") {
+    RttEstimator rtt;
+    const RttEstimator::Config& config = rtt.get_config();
+    for (size_t i = 0; i + 1 < config.minSamples; i++) {
+        rtt.on_reply(jutta_command_t::GET_TYPE, std::chrono::microseconds{10000});
+    }
+    REQUIRE(rtt.get_deadline(jutta_command_t::GET_TYPE) == config.ceiling);
+    rtt.on_reply(jutta_command_t::GET_TYPE, std::chrono::microseconds{10000});
+    REQUIRE(rtt.get_deadline(jutta_command_t::GET_TYPE) == config.floor);
+    // Other commands are not affected:
+    REQUIRE(rtt.get_deadline(std::nullopt) == config.ceiling);
+
+    for (size_t i = 0; i < RttEstimator::WINDOW_SIZE; i++) {
+        rtt.on_reply(jutta_command_t::GET_TYPE, std::chrono::microseconds{200000});
+    }
+    REQUIRE(rtt.get_deadline(jutta_command_t::GET_TYPE) == std::chrono::milliseconds{400});
+    REQUIRE(rtt.get_stats(jutta_command_t::GET_TYPE).replies == config.minSamples + RttEstimator::WINDOW_SIZE);
+}
+
+TEST_CASE("Deadlines recover after the round trip time grew past them", "[rtt]") {
+    RttEstimator rtt;
+    for (size_t i = 0; i < RttEstimator::WINDOW_SIZE; i++) {
+        rtt.on_reply(jutta_command_t::GET_TYPE, std::chrono::microseconds{10000});
+    }
+    REQUIRE(rtt.get_deadline(jutta_command_t::GET_TYPE) == rtt.get_config().floor);
+
+    // The coffee maker now takes 600ms to respond, so every command times out after waiting for the deadline:
+    constexpr std::chrono::milliseconds ACTUAL_RTT{600};
+    size_t timeouts = 0;
+    while (rtt.get_deadline(jutta_command_t::GET_TYPE) < ACTUAL_RTT) {
+        rtt.on_timeout(jutta_command_t::GET_TYPE, rtt.get_deadline(jutta_command_t::GET_TYPE));
+        timeouts++;
+        REQUIRE(timeouts <= 8);
+    }
+    REQUIRE(rtt.get_stats(jutta_command_t::GET_TYPE).timeouts == timeouts);
+    REQUIRE(rtt.get_deadline(jutta_command_t::GET_TYPE) <= rtt.get_config().ceiling);
+}
+
+TEST_CASE("Late replies get attributed to the last timed out command", "[rtt]") {
+    RttEstimator rtt;
+    REQUIRE_FALSE(rtt.on_late_reply());
+    rtt.on_timeout(jutta_command_t::GET_TYPE, std::chrono::microseconds{250000});
+    REQUIRE(rtt.on_late_reply());
+    // Only once per timeout:
+    REQUIRE_FALSE(rtt.on_late_reply());
+    REQUIRE(rtt.get_stats(jutta_command_t::GET_TYPE).lateReplies == 1);
+
+    rtt.on_timeout(jutta_command_t::GET_TYPE, std::chrono::microseconds{250000});
+    rtt.on_sent();
+    REQUIRE_FALSE(rtt.on_late_reply());
+    REQUIRE(rtt.get_stats(jutta_command_t::GET_TYPE).timeouts == 2);
+    REQUIRE(rtt.get_stats(jutta_command_t::GET_TYPE).lateReplies == 1);
+}
+
+TEST_CASE("Late replies do not get taken as response to the next command", "[rtt]") {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.set_inter_quad_gap(std::chrono::nanoseconds{0});
+    serial::LoopbackConnection& loopback = connection.get_transport();
+    std::atomic<bool> respond{false};
+    jutta_proto::tests::make_responder(loopback, [&](std::string_view /*request*/) -> std::string { return respond ? "ty:EF532M V02.03\r\n" : ""; });
+    connection.init();
+
+    REQUIRE_FALSE(connection.write_command_with_response(jutta_command_t::GET_TYPE, std::chrono::milliseconds{20}));
+    // The response arrives after the deadline:
+    loopback.inject_rx(encode("ty:LATE\r\n"));
+    respond = true;
+    std::optional<jutta_proto::JuttaConnection::Response> result = connection.write_command_with_response(jutta_command_t::GET_TYPE, std::chrono::milliseconds{1000});
+    REQUIRE(result);
+    REQUIRE(result->view() == "ty:EF532M V02.03\r\n");
+
+    const RttEstimator::CommandStats stats = connection.get_rtt_stats(jutta_command_t::GET_TYPE);
+    REQUIRE(stats.timeouts == 1);
+    REQUIRE(stats.lateReplies == 1);
+    REQUIRE(stats.replies == 1);
+}
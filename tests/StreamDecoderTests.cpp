@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/LineFramer.hpp"
+#include "jutta_proto/StreamDecoder.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using jutta_proto::tests::encode;
+
+namespace {
+std::string decode(jutta_proto::StreamDecoder& decoder, const std::vector<uint8_t>& wire) {
+    std::vector<uint8_t> out;
+    decoder.feed(wire, out);
+    return std::string(out.begin(), out.end());
+}
+}  // namespace
+
+TEST_CASE("Aligned stream decodes without realigning", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    REQUIRE(decode(decoder, encode("ty:EF532M V02.03\r\nok:\r\n")) == "ty:EF532M V02.03\r\nok:\r\n");
+    REQUIRE(decoder.get_stats().realignments == 0);
+    REQUIRE(decoder.get_stats().discardedBytes == 0);
+}
+
+TEST_CASE("Dropped byte only garbles the current message", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    std::vector<uint8_t> wire = encode("AB\r\n");
+    // Drop the second byte of the 'B' quad:
+    wire.erase(wire.begin() + 5);
+    const std::vector<uint8_t> next = encode("CD\r\n");
+    wire.insert(wire.end(), next.begin(), next.end());
+
+    // The garbage decoded from the misaligned terminator gets removed again:
+    REQUIRE(decode(decoder, wire) == "A\r\nCD\r\n");
+    REQUIRE(decoder.get_stats().realignments == 1);
+    REQUIRE(decoder.buffered() == 0);
+}
+
+TEST_CASE("Inserted byte only garbles the current message", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    std::vector<uint8_t> wire = encode("AB\r\n");
+    // Insert a byte with a valid wire bit layout after the 'A' quad:
+    wire.insert(wire.begin() + 4, encode("A").front());
+    const std::vector<uint8_t> next = encode("CD\r\n");
+    wire.insert(wire.end(), next.begin(), next.end());
+
+    const std::string result = decode(decoder, wire);
+    REQUIRE(decoder.get_stats().realignments == 1);
+    REQUIRE(result.size() == 8);
+    REQUIRE(result.starts_with("A"));
+    REQUIRE(result.ends_with("\r\nCD\r\n"));
+}
+
+TEST_CASE("Realigning works across feed calls", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    std::vector<uint8_t> wire = encode("AB\r\nCD\r\n");
+    wire.erase(wire.begin() + 5);
+    std::vector<uint8_t> out;
+    for (uint8_t b : wire) {
+        decoder.feed(std::span<const uint8_t>(&b, 1), out);
+    }
+    // The garbage appended by earlier calls gets taken back as well:
+    const std::string result(out.begin(), out.end());
+    REQUIRE(decoder.get_stats().realignments == 1);
+    REQUIRE(result == "A\r\nCD\r\n");
+}
+
+TEST_CASE("Misaligned terminator split across feed calls yields clean frames", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    jutta_proto::LineFramer framer;
+    std::vector<uint8_t> wire = encode("AB\r\n");
+    wire.erase(wire.begin() + 5);
+    const std::vector<uint8_t> next = encode("CD\r\n");
+    wire.insert(wire.end(), next.begin(), next.end());
+
+    // Split inside the misaligned terminator, after the garbage quads got decoded:
+    const std::span<const uint8_t> span(wire);
+    decoder.feed(span.first(10), framer.input());
+    REQUIRE_FALSE(framer.next());
+    decoder.feed(span.subspan(10), framer.input());
+    REQUIRE(framer.next() == "A\r\n");
+    REQUIRE(framer.next() == "CD\r\n");
+    REQUIRE_FALSE(framer.next());
+    REQUIRE(decoder.get_stats().realignments == 1);
+}
+
+TEST_CASE("Terminator pattern inside aligned data recovers on the next terminator", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    // The encoded "4(0" contains the encoded "\r\n" one wire byte off the quad boundaries:
+    const std::string result = decode(decoder, encode("x4(0yz\r\nCD\r\n"));
+    REQUIRE(decoder.get_stats().realignments == 2);
+    REQUIRE(result.starts_with("x\r\n"));
+    REQUIRE(result.ends_with("\r\nCD\r\n"));
+}
+
+TEST_CASE("Line noise discards the affected quad", "[decoder]") {
+    jutta_proto::StreamDecoder decoder;
+    std::vector<uint8_t> wire = encode("AB\r\n");
+    wire[5] = 0x00;
+    REQUIRE(decode(decoder, wire) == "A\r\n");
+    REQUIRE(decoder.get_stats().invalidBytes == 1);
+    REQUIRE(decoder.get_stats().discardedBytes == 4);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "jutta_proto/JuttaCodec.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//---------------------------------------------------------------------------
+namespace jutta_proto::tests {
+//---------------------------------------------------------------------------
+/**
+ * Returns the wire bytes for the given decoded data.
+ **/
+inline std::vector<uint8_t> encode(std::string_view data) {
+    // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+    return encode_block(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+}
+
+/**
+ * Returns true in case the given quad is the encoded "\n" ending each message.
+ **/
+inline bool is_terminator(std::span<const uint8_t> quad) {
+    static const std::vector<uint8_t> TERMINATOR = encode("\n");
+    return std::equal(quad.begin(), quad.end(), TERMINATOR.begin(), TERMINATOR.end());
+}
+
+/**
+ * Simulates a coffee maker, that responds with the given response once a message ends.
+ * Everything written gets dropped, without allocating once the first message got answered.
+ **/
+inline void make_responder(serial::LoopbackConnection& loopback, std::string_view response) {
+    std::vector<uint8_t> tx;
+    tx.reserve(1024);
+    loopback.set_responder([&loopback, tx = std::move(tx), wire = encode(response)](std::span<const uint8_t> quad) mutable {
+        if (is_terminator(quad)) {
+            loopback.take_tx(tx);
+            tx.clear();
+            loopback.inject_rx(wire);
+        }
+    });
+}
+
+/**
+ * Simulates a coffee maker, that invokes respond with each decoded message (including the "\r\n") once it ends.
+ * The returned data gets send back, in case it is not empty.
+ **/
+inline void make_responder(serial::LoopbackConnection& loopback, std::function<std::string(std::string_view)>&& respond) {
+    loopback.set_responder([&loopback, respond = std::move(respond)](std::span<const uint8_t> quad) {
+        if (!is_terminator(quad)) {
+            return;
+        }
+        std::vector<uint8_t> tx;
+        loopback.take_tx(tx);
+        std::vector<uint8_t> decoded(tx.size() / WIRE_QUAD_SIZE);
+        decode_block(tx, decoded);
+        // NOLINTNEXTLINE (cppcoreguidelines-pro-type-reinterpret-cast)
+        const std::string response = respond(std::string_view(reinterpret_cast<const char*>(decoded.data()), decoded.size()));
+        if (!response.empty()) {
+            loopback.inject_rx(encode(response));
+        }
+    });
+}
+//---------------------------------------------------------------------------
+}  // namespace jutta_proto::tests
+//---------------------------------------------------------------------------
@@ -0,0 +1,102 @@
+#include <catch2/catch.hpp>
+
+#include "TestHelpers.hpp"
+#include "jutta_proto/JuttaConnection.hpp"
+#include "jutta_proto/TraceReplayer.hpp"
+#include "jutta_proto/WireCapture.hpp"
+#include "serial/LoopbackConnection.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using jutta_proto::capture_direction_t;
+using jutta_proto::capture_layer_t;
+using jutta_proto::replay_mode_t;
+using jutta_proto::TraceEvent;
+using jutta_proto::TraceReplayer;
+using jutta_proto::tests::encode;
+
+namespace {
+std::string snoop_path(const std::string& name) { return std::string(JUTTA_PROTO_SOURCE_DIR) + "/protocol_snoops/" + name; }
+
+size_t count_events(const TraceReplayer& replayer, capture_direction_t direction) {
+    const std::vector<TraceEvent>& events = replayer.get_events();
+    return static_cast<size_t>(std::count_if(events.begin(), events.end(), [direction](const TraceEvent& event) { return event.direction == direction; }));
+}
+
+/**
+ * Replays the given trace as fast as possible and returns all frames the subscriber of the router received.
+ **/
+std::vector<std::string> replay_frames(const TraceReplayer& replayer, TraceReplayer::Stats& stats) {
+    jutta_proto::BasicJuttaConnection<serial::LoopbackConnection> connection;
+    connection.init();
+    std::vector<std::string> frames;
+    static_cast<void>(connection.get_router().subscribe("", [&frames](std::string_view frame) { frames.emplace_back(frame); }));
+    stats = replayer.replay(connection, replay_mode_t::AS_FAST_AS_POSSIBLE);
+    return frames;
+}
+}  // namespace
+
+TEST_CASE("Keep alive snoop gets imported", "[replay]") {
+    const TraceReplayer replayer = TraceReplayer::from_snoop(snoop_path("snoop_keep_alive.txt"));
+    REQUIRE(replayer.get_events().size() == 60);
+    REQUIRE(count_events(replayer, capture_direction_t::TX) == 0);
+
+    TraceReplayer::Stats stats;
+    const std::vector<std::string> frames = replay_frames(replayer, stats);
+    REQUIRE(stats.rxEvents == 60);
+    REQUIRE(stats.frames == 24);
+    // All of them are '&' keep alive frames:
+    REQUIRE(frames.size() == 24);
+    REQUIRE(std::all_of(frames.begin(), frames.end(), [](const std::string& frame) { return frame.starts_with('&') && frame.ends_with("\r\n"); }));
+}
+
+TEST_CASE("Key exchange transcript gets imported", "[replay]") {
+    const TraceReplayer replayer = TraceReplayer::from_snoop(snoop_path("keyexchange.md"));
+    REQUIRE(replayer.get_events().size() == 16);
+    REQUIRE(count_events(replayer, capture_direction_t::TX) == 8);
+    REQUIRE(count_events(replayer, capture_direction_t::RX) == 8);
+
+    TraceReplayer::Stats stats;
+    const std::vector<std::string> frames = replay_frames(replayer, stats);
+    REQUIRE(stats.txEvents == 8);
+    REQUIRE(stats.rxEvents == 8);
+    // Some messages of the transcript got written down without their terminator, so they merge with the next one:
+    REQUIRE(frames == std::vector<std::string>{"ty:EF532M V02.03\r\n", "ty:EF532M V02.03@t1\r\n", "@T2:010001B228\r\n", "@T3:3BDEEF532M V02.03\r\n"});
+}
+
+TEST_CASE("Wire capture replays the same frames", "[replay]") {
+    const std::string path = (std::filesystem::temp_directory_path() / "jutta_proto_replay.jcap").string();
+    jutta_proto::WireCapture capture;
+    capture.open(path);
+    const std::vector<uint8_t> request = encode("TY:\r\n");
+    // Longer than a single record and a frame split across two reads:
+    const std::vector<uint8_t> response = encode("ty:EF532M V02.03\r\n&abc");
+    const std::vector<uint8_t> rest = encode("def\r\n");
+    capture.record(capture_direction_t::TX, capture_layer_t::WIRE, request, 1000);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, response, 2000);
+    capture.record(capture_direction_t::RX, capture_layer_t::DECODED, std::vector<uint8_t>{'t', 'y'}, 2000);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, rest, 3000);
+    capture.close();
+
+    const TraceReplayer replayer = TraceReplayer::from_capture(path);
+    std::filesystem::remove(path);
+    const std::vector<TraceEvent>& events = replayer.get_events();
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].direction == capture_direction_t::TX);
+    REQUIRE(events[0].wire == request);
+    REQUIRE(events[1].direction == capture_direction_t::RX);
+    REQUIRE(events[1].wire == response);
+    REQUIRE(events[1].offset == std::chrono::nanoseconds{1000});
+    REQUIRE(events[2].wire == rest);
+
+    TraceReplayer::Stats stats;
+    const std::vector<std::string> frames = replay_frames(replayer, stats);
+    REQUIRE(stats.txEvents == 1);
+    REQUIRE(stats.rxEvents == 2);
+    REQUIRE(stats.rxBytes == response.size() + rest.size());
+    REQUIRE(frames == std::vector<std::string>{"ty:EF532M V02.03\r\n", "&abcdef\r\n"});
+}
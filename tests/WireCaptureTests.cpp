@@ -0,0 +1,127 @@
+#include <catch2/catch.hpp>
+
+#include "jutta_proto/WireCapture.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <numeric>
+#include <span>
+#include <string>
+#include <vector>
+
+using jutta_proto::capture_direction_t;
+using jutta_proto::capture_layer_t;
+using jutta_proto::CaptureRecord;
+using jutta_proto::WireCapture;
+
+namespace {
+std::vector<uint8_t> make_data(size_t size, uint8_t first = 0) {
+    std::vector<uint8_t> data(size);
+    std::iota(data.begin(), data.end(), first);
+    return data;
+}
+
+std::vector<CaptureRecord> drain_all(WireCapture& capture) {
+    std::vector<CaptureRecord> result;
+    static_cast<void>(capture.drain([&result](const CaptureRecord& rec) { result.push_back(rec); }));
+    return result;
+}
+
+std::string temp_path(const std::string& name) { return (std::filesystem::temp_directory_path() / ("jutta_proto_" + name + ".jcap")).string(); }
+}  // namespace
+
+TEST_CASE("Capture ring wraps around", "[capture]") {
+    WireCapture capture(4);
+    REQUIRE(capture.capacity() == 4);
+    // Fill and drain it a couple of times, so the positions wrap around the ring:
+    for (uint8_t i = 0; i < 10; i++) {
+        capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(3, i), i);
+        capture.record(capture_direction_t::TX, capture_layer_t::DECODED, make_data(1, i), i);
+        capture.record(capture_direction_t::RX, capture_layer_t::DECODED, make_data(2, i), i);
+        const std::vector<CaptureRecord> records = drain_all(capture);
+        REQUIRE(records.size() == 3);
+        REQUIRE(records[0].timestamp == i);
+        REQUIRE(records[0].direction == capture_direction_t::RX);
+        REQUIRE(records[0].layer == capture_layer_t::WIRE);
+        REQUIRE(std::vector<uint8_t>(records[0].payload().begin(), records[0].payload().end()) == make_data(3, i));
+        REQUIRE(records[1].direction == capture_direction_t::TX);
+        REQUIRE(records[1].layer == capture_layer_t::DECODED);
+        REQUIRE(records[2].size == 2);
+    }
+    REQUIRE(capture.get_stats().records == 30);
+    REQUIRE(capture.get_stats().dropped == 0);
+}
+
+TEST_CASE("Capture drops data that does not fit completely", "[capture]") {
+    WireCapture capture(4);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(CaptureRecord::PAYLOAD_SIZE * 2), 1);
+    // Needs three records, but only two are free:
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(CaptureRecord::PAYLOAD_SIZE * 2 + 1), 2);
+    REQUIRE(capture.get_stats().records == 2);
+    REQUIRE(capture.get_stats().dropped == 3);
+
+    // Still fits:
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(CaptureRecord::PAYLOAD_SIZE * 2), 3);
+    const std::vector<CaptureRecord> records = drain_all(capture);
+    REQUIRE(records.size() == 4);
+    REQUIRE(records[1].timestamp == 1);
+    REQUIRE(records[2].timestamp == 3);
+    REQUIRE(capture.get_stats().dropped == 3);
+}
+
+TEST_CASE("Capture splits long data into records sharing one timestamp", "[capture]") {
+    WireCapture capture(8);
+    const std::vector<uint8_t> data = make_data(CaptureRecord::PAYLOAD_SIZE * 2 + 5);
+    capture.record(capture_direction_t::TX, capture_layer_t::WIRE, data, 42);
+    const std::vector<CaptureRecord> records = drain_all(capture);
+    REQUIRE(records.size() == 3);
+    std::vector<uint8_t> joined;
+    for (const CaptureRecord& rec : records) {
+        REQUIRE(rec.timestamp == 42);
+        REQUIRE(rec.direction == capture_direction_t::TX);
+        joined.insert(joined.end(), rec.payload().begin(), rec.payload().end());
+    }
+    REQUIRE(records[0].size == CaptureRecord::PAYLOAD_SIZE);
+    REQUIRE(records[2].size == 5);
+    REQUIRE(joined == data);
+}
+
+TEST_CASE("Capture file round trip", "[capture]") {
+    const std::string path = temp_path("round_trip");
+    WireCapture capture(8);
+    capture.open(path);
+    capture.record(capture_direction_t::TX, capture_layer_t::DECODED, make_data(5), 1);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(CaptureRecord::PAYLOAD_SIZE + 1), 2);
+    REQUIRE(capture.flush() == 3);
+    capture.close();
+    REQUIRE(capture.get_stats().flushed == 3);
+
+    const std::vector<CaptureRecord> records = WireCapture::read_file(path);
+    REQUIRE(records.size() == 3);
+    REQUIRE(records[0].timestamp == 1);
+    REQUIRE(records[0].direction == capture_direction_t::TX);
+    REQUIRE(records[0].layer == capture_layer_t::DECODED);
+    REQUIRE(std::vector<uint8_t>(records[0].payload().begin(), records[0].payload().end()) == make_data(5));
+    REQUIRE(records[1].timestamp == 2);
+    REQUIRE(records[1].direction == capture_direction_t::RX);
+    REQUIRE(records[1].layer == capture_layer_t::WIRE);
+    REQUIRE(records[1].size == CaptureRecord::PAYLOAD_SIZE);
+    REQUIRE(records[2].size == 1);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Capture file reading ignores a truncated last record", "[capture]") {
+    const std::string path = temp_path("truncated");
+    WireCapture capture(8);
+    capture.open(path);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(4), 1);
+    capture.record(capture_direction_t::RX, capture_layer_t::WIRE, make_data(4), 2);
+    capture.close();
+
+    // Cut off the last two data bytes, like after getting killed while flushing:
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 2);
+    const std::vector<CaptureRecord> records = WireCapture::read_file(path);
+    REQUIRE(records.size() == 1);
+    REQUIRE(records[0].timestamp == 1);
+    std::filesystem::remove(path);
+}